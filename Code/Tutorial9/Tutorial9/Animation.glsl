@@ -0,0 +1,42 @@
+// procedural animation evaluated from per-object parameters and a single time uniform, see Animation3D
+// u_animation columns: (rotation axis, rotation speed), (orbit axis, orbit speed), (oscillation direction, oscillation frequency), (orbit radius, oscillation amplitude, phase, 0)
+uniform highp mat4 u_animation;
+uniform highp float u_time;
+
+mat4 animationRotation(vec3 axis, float angle) {
+	float c = cos(angle);
+	float s = sin(angle);
+	vec3 t = (1.0 - c) * axis;
+	return mat4(
+		t.x * axis.x + c, t.x * axis.y + s * axis.z, t.x * axis.z - s * axis.y, 0.0,
+		t.y * axis.x - s * axis.z, t.y * axis.y + c, t.y * axis.z + s * axis.x, 0.0,
+		t.z * axis.x + s * axis.y, t.z * axis.y - s * axis.x, t.z * axis.z + c, 0.0,
+		0.0, 0.0, 0.0, 1.0);
+}
+
+mat4 animationTranslation(vec3 offset) {
+	return mat4(
+		1.0, 0.0, 0.0, 0.0,
+		0.0, 1.0, 0.0, 0.0,
+		0.0, 0.0, 1.0, 0.0,
+		offset, 1.0);
+}
+
+// oscillation * orbit rotation * orbit offset * rotation, which matches Animation3D::getMatrix
+mat4 animationMatrix(mat4 animation) {
+	vec4 rotation = animation[0];
+	vec4 orbit = animation[1];
+	vec4 oscillation = animation[2];
+	float t = u_time + animation[3].z;
+
+	vec3 perpendicular = normalize(cross(orbit.xyz, abs(orbit.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0)));
+
+	return animationTranslation(oscillation.xyz * animation[3].y * sin(oscillation.w * t))
+		* animationRotation(orbit.xyz, orbit.w * t)
+		* animationTranslation(perpendicular * animation[3].x)
+		* animationRotation(rotation.xyz, rotation.w * t);
+}
+
+mat4 animationMatrix() {
+	return animationMatrix(u_animation);
+}
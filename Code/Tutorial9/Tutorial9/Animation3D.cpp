@@ -0,0 +1,134 @@
+#include "Animation3D.h"
+#include <QtMath>
+
+/*
+Description:
+	This function is a constructor, the default animation keeps the object still;
+Input:
+	@ void parameter: void;
+*/
+Animation3D::Animation3D() :
+	rotationAxis(0.0f, 1.0f, 0.0f), rotationSpeed(0.0f),
+	orbitAxis(0.0f, 1.0f, 0.0f), orbitRadius(0.0f), orbitSpeed(0.0f),
+	oscillationDirection(0.0f, 1.0f, 0.0f), oscillationAmplitude(0.0f), oscillationFrequency(0.0f),
+	phase(0.0f) {
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+Animation3D::~Animation3D() {
+}
+
+/*
+Description:
+	This function is used to set the rotation of the object around its own origin;
+Input:
+	@ const QVector3D& axis: the rotation axis;
+	@ float speed: the angular speed in radians per second;
+Output:
+	@ void returnValue: void;
+*/
+void Animation3D::setRotation(const QVector3D& axis, float speed) {
+	rotationAxis = axis.normalized();
+	rotationSpeed = speed;
+}
+
+/*
+Description:
+	This function is used to set the orbit of the object around its own origin, the object is moved by the radius perpendicular to the axis and circles the axis;
+Input:
+	@ const QVector3D& axis: the orbit axis;
+	@ float radius: the orbit radius;
+	@ float speed: the angular speed in radians per second;
+Output:
+	@ void returnValue: void;
+*/
+void Animation3D::setOrbit(const QVector3D& axis, float radius, float speed) {
+	orbitAxis = axis.normalized();
+	orbitRadius = radius;
+	orbitSpeed = speed;
+}
+
+/*
+Description:
+	This function is used to set the oscillation of the object along a direction;
+Input:
+	@ const QVector3D& direction: the oscillation direction;
+	@ float amplitude: the largest offset along the direction;
+	@ float frequency: the angular frequency in radians per second;
+Output:
+	@ void returnValue: void;
+*/
+void Animation3D::setOscillation(const QVector3D& direction, float amplitude, float frequency) {
+	oscillationDirection = direction.normalized();
+	oscillationAmplitude = amplitude;
+	oscillationFrequency = frequency;
+}
+
+/*
+Description:
+	This function is used to set the phase, which is added to the time, so that objects sharing the same animation are out of step;
+Input:
+	@ float phase: the phase in seconds;
+Output:
+	@ void returnValue: void;
+*/
+void Animation3D::setPhase(float phase) {
+	this->phase = phase;
+}
+
+/*
+Description:
+	This function is used to pack the animation into the u_animation uniform of Animation.glsl;
+	the columns are (rotation axis, rotation speed), (orbit axis, orbit speed), (oscillation direction, oscillation frequency) and (orbit radius, oscillation amplitude, phase, 0);
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the packed parameters;
+*/
+QMatrix4x4 Animation3D::getParameters() const {
+	QMatrix4x4 parameters;
+	parameters.setColumn(0, QVector4D(rotationAxis, rotationSpeed));
+	parameters.setColumn(1, QVector4D(orbitAxis, orbitSpeed));
+	parameters.setColumn(2, QVector4D(oscillationDirection, oscillationFrequency));
+	parameters.setColumn(3, QVector4D(orbitRadius, oscillationAmplitude, phase, 0.0f));
+	return parameters;
+}
+
+/*
+Description:
+	This function is used to evaluate the animation on the CPU, which matches animationMatrix() in Animation.glsl, the object matrix is multiplied by it;
+Input:
+	@ float time: the time in seconds;
+Output:
+	@ QMatrix4x4 returnValue: the animation matrix;
+*/
+QMatrix4x4 Animation3D::getMatrix(float time) const {
+	float t = time + phase;
+
+	// the same perpendicular as the shader, so that the orbit starts at the same point
+	QVector3D perpendicular = QVector3D::crossProduct(orbitAxis, qAbs(orbitAxis.x()) < 0.9f ? QVector3D(1.0f, 0.0f, 0.0f) : QVector3D(0.0f, 1.0f, 0.0f)).normalized();
+
+	QMatrix4x4 matrix;
+	matrix.translate(oscillationDirection * oscillationAmplitude * qSin(oscillationFrequency * t));
+	matrix.rotate(qRadiansToDegrees(orbitSpeed * t), orbitAxis);
+	matrix.translate(perpendicular * orbitRadius);
+	matrix.rotate(qRadiansToDegrees(rotationSpeed * t), rotationAxis);
+	return matrix;
+}
+
+/*
+Description:
+	This function is used to check whether the animation moves the object at all, an object with an inactive animation looks the same at any time;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the object is moved by the animation;
+*/
+bool Animation3D::isActive() const {
+	return rotationSpeed != 0.0f || (orbitRadius != 0.0f && orbitSpeed != 0.0f) || (oscillationAmplitude != 0.0f && oscillationFrequency != 0.0f);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <qvector3d.h>
+#include <qmatrix4x4.h>
+
+class Animation3D {
+public:
+	Animation3D();
+	~Animation3D();
+
+	void setRotation(const QVector3D& axis, float speed);
+	void setOrbit(const QVector3D& axis, float radius, float speed);
+	void setOscillation(const QVector3D& direction, float amplitude, float frequency);
+	void setPhase(float phase);
+	QMatrix4x4 getParameters() const;
+	QMatrix4x4 getMatrix(float time) const;
+	bool isActive() const;
+
+private:
+	QVector3D rotationAxis;
+	float rotationSpeed;
+	QVector3D orbitAxis;
+	float orbitRadius;
+	float orbitSpeed;
+	QVector3D oscillationDirection;
+	float oscillationAmplitude;
+	float oscillationFrequency;
+	float phase;
+};
+
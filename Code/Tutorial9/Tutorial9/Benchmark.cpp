@@ -0,0 +1,318 @@
+#include "Benchmark.h"
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include <qelapsedtimer.h>
+#include <qthread.h>
+#include <QtMath>
+#include <float.h>
+
+/*
+Description:
+	This function is used to build a deterministic hierarchy in a store, every node has a different translation and rotation, and each parent has four children;
+Input:
+	@ TransformStore& store: the store;
+	@ int nodeCount: the amount of nodes;
+Output:
+	@ QVector<int> returnValue: the handles of the nodes, the first one is the root;
+*/
+static QVector<int> buildHierarchy(TransformStore& store, int nodeCount) {
+	QVector<int> handles;
+	handles.reserve(nodeCount);
+	for (int i = 0; i < nodeCount; i++) {
+		int handle = store.create();
+		store.translate(handle, QVector3D(qSin(i * 0.37f), qCos(i * 0.11f), 0.1f * (i % 7)));
+		store.rotate(handle, QQuaternion::fromAxisAndAngle(QVector3D(1.0f, (i % 5) * 0.5f, 0.25f).normalized(), (i % 360) * 1.0f));
+		store.scale(handle, 1.0f + 0.001f * (i % 3));
+		if (i > 0)
+			store.setParent(handle, handles[(i - 1) / 4]);
+		handles.append(handle);
+	}
+	return handles;
+}
+
+/*
+Description:
+	This function is used to get the largest element-wise difference between a QMatrix4x4 and a Matrix4;
+Input:
+	@ const QMatrix4x4& a: the matrix of the QMatrix4x4 path;
+	@ const Matrix4& b: the matrix of the SimdMath path;
+Output:
+	@ float returnValue: the largest absolute difference;
+*/
+static float maxDifference(const QMatrix4x4& a, const Matrix4& b) {
+	float difference = 0.0f;
+	for (int k = 0; k < 16; k++)
+		difference = qMax(difference, qAbs(a.constData()[k] - b.m[k]));
+	return difference;
+}
+
+/*
+Description:
+	This function is used to write one line of the math kernel report;
+Input:
+	@ QTextStream& output: the stream the report is written to;
+	@ const char* name: the name of the kernel;
+	@ qint64 qtNanoseconds: the time of the QMatrix4x4 path;
+	@ qint64 simdNanoseconds: the time of the SimdMath path;
+	@ qint64 itemCount: the amount of items processed by each path;
+	@ float difference: the largest difference between the results of the two paths;
+Output:
+	@ void returnValue: void;
+*/
+static void reportKernel(QTextStream& output, const char* name, qint64 qtNanoseconds, qint64 simdNanoseconds, qint64 itemCount, float difference) {
+	double qtRate = qtNanoseconds / (double)itemCount;
+	double simdRate = simdNanoseconds / (double)itemCount;
+	output << "  " << name << ": QMatrix4x4 " << qtRate << " ns, SimdMath " << simdRate << " ns, speedup " << (qtRate / simdRate) << ", max difference " << difference << "\n";
+}
+
+/*
+Description:
+	This function is used to run all the benchmarks, which is selected by the --benchmark command line argument;
+Input:
+	@ QTextStream& output: the stream the report is written to;
+Output:
+	@ void returnValue: void;
+*/
+void Benchmark::run(QTextStream& output) {
+	runTransformUpdate(output);
+	runMathKernels(output);
+	output.flush();
+}
+
+/*
+Description:
+	This function is used to measure the world matrix update of hierarchies of several sizes from one thread up to the ideal thread count, so the report shows how the update scales with the node count;
+	the root is rotated before every update, so every node is recomputed, and the result of each thread count is compared bit by bit with the serial update;
+Input:
+	@ QTextStream& output: the stream the report is written to;
+Output:
+	@ void returnValue: void;
+*/
+void Benchmark::runTransformUpdate(QTextStream& output) {
+	const int nodeCounts[] = { 4096, 32768, 262144 };
+	const QQuaternion spin = QQuaternion::fromAxisAndAngle(0.0f, 1.0f, 0.0f, 1.0f);
+
+	QVector<int> threadCounts;
+	for (int threads = 1; threads < QThread::idealThreadCount(); threads *= 2)
+		threadCounts.append(threads);
+	threadCounts.append(qMax(QThread::idealThreadCount(), 1));
+
+	for (int n = 0; n < int(sizeof(nodeCounts) / sizeof(nodeCounts[0])); n++) {
+		// every size updates about as many nodes in total, so the small hierarchies are not lost in the timer resolution
+		const int nodeCount = nodeCounts[n];
+		const int iterations = 20 * (262144 / nodeCount);
+
+		output << "transform update, " << nodeCount << " nodes, " << iterations << " iterations\n";
+
+		// serial reference
+		TransformStore reference;
+		QVector<int> referenceHandles = buildHierarchy(reference, nodeCount);
+		reference.update();
+
+		QElapsedTimer timer;
+		timer.start();
+		for (int i = 0; i < iterations; i++) {
+			reference.rotate(referenceHandles[0], spin);
+			reference.update();
+		}
+		double serialSeconds = timer.nsecsElapsed() / 1e9;
+		output << "  serial:    " << (nodeCount * (double)iterations / serialSeconds / 1e6) << " M nodes/s, " << (serialSeconds / iterations * 1e6) << " us per update\n";
+
+		for (int t = 0; t < threadCounts.size(); t++) {
+			JobSystem jobSystem(threadCounts[t] - 1);
+			TransformStore store(&jobSystem);
+			QVector<int> handles = buildHierarchy(store, nodeCount);
+			store.update();
+			jobSystem.resetStatistics();
+
+			timer.restart();
+			for (int i = 0; i < iterations; i++) {
+				store.rotate(handles[0], spin);
+				store.update();
+			}
+			double seconds = timer.nsecsElapsed() / 1e9;
+
+			bool identical = true;
+			for (int i = 0; i < nodeCount && identical; i++)
+				identical = memcmp(store.getWorldMatrix(handles[i]).constData(), reference.getWorldMatrix(referenceHandles[i]).constData(), 16 * sizeof(float)) == 0;
+
+			// the share of the jobs taken from another queue, and the deepest any queue became
+			JobSystem::Statistics statistics = jobSystem.getStatistics();
+			int maxQueueDepth = 0;
+			for (int i = 0; i < statistics.maxQueueDepths.size(); i++) maxQueueDepth = qMax(maxQueueDepth, statistics.maxQueueDepths[i]);
+			double stealRate = statistics.executedJobs ? statistics.stolenJobs / (double)statistics.executedJobs : 0.0;
+
+			output << "  " << threadCounts[t] << " threads: " << (nodeCount * (double)iterations / seconds / 1e6) << " M nodes/s, speedup " << (serialSeconds / seconds) << ", " << (identical ? "bit-identical" : "MISMATCH")
+				<< ", " << statistics.executedJobs << " jobs, " << (stealRate * 100.0) << "% stolen, " << statistics.failedSteals << " failed steals, max queue depth " << maxQueueDepth << "\n";
+		}
+	}
+}
+
+/*
+Description:
+	This function is used to measure the batched kernels of SimdMath against the same work done with QMatrix4x4, the results of the two paths are compared to show the precision;
+Input:
+	@ QTextStream& output: the stream the report is written to;
+Output:
+	@ void returnValue: void;
+*/
+void Benchmark::runMathKernels(QTextStream& output) {
+	const int count = 65536;
+	const int iterations = 20;
+	const qint64 itemCount = (qint64)count * iterations;
+
+#ifdef SIMD_MATH_USE_SSE
+	output << "math kernels (SSE), " << count << " items, " << iterations << " iterations, time per item\n";
+#else
+	output << "math kernels (scalar), " << count << " items, " << iterations << " iterations, time per item\n";
+#endif
+
+	// deterministic inputs
+	QVector<QVector3D> translations(count);
+	QVector<QQuaternion> rotations(count);
+	QVector<float> scales(count);
+	QVector<QVector4D> spheres(count);
+	QVector<QVector3D> minimums(count);
+	QVector<QVector3D> maximums(count);
+	for (int i = 0; i < count; i++) {
+		translations[i] = QVector3D(qSin(i * 0.37f), qCos(i * 0.11f), 0.1f * (i % 7));
+		rotations[i] = QQuaternion::fromAxisAndAngle(QVector3D(1.0f, (i % 5) * 0.5f, 0.25f).normalized(), (i % 360) * 1.0f);
+		scales[i] = 1.0f + 0.001f * (i % 3);
+		spheres[i] = QVector4D(0.01f * (i % 13), 0.02f * (i % 11), 0.03f * (i % 7), 1.0f + 0.1f * (i % 5));
+		minimums[i] = QVector3D(-1.0f, -0.5f * (1 + i % 3), -0.25f);
+		maximums[i] = QVector3D(1.0f + 0.1f * (i % 4), 0.5f, 0.25f * (1 + i % 2));
+	}
+
+	QVector<QMatrix4x4> qtMatrices(count);
+	QVector<QMatrix4x4> qtResults(count);
+	QVector<Matrix4> matrices(count);
+	QVector<Matrix4> results(count);
+	QVector<QVector4D> qtSpheres(count);
+	QVector<QVector4D> resultSpheres(count);
+	QVector<QVector3D> qtMinimums(count), qtMaximums(count);
+	QVector<QVector3D> resultMinimums(count), resultMaximums(count);
+
+	QElapsedTimer timer;
+	qint64 qtTime, simdTime;
+	float difference;
+
+	// quaternion to matrix, composed with the translation and the scale
+	timer.start();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++) {
+			QMatrix4x4& m = qtMatrices[i];
+			m.setToIdentity();
+			m.translate(translations[i]);
+			m.rotate(rotations[i]);
+			m.scale(scales[i]);
+		}
+	}
+	qtTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int n = 0; n < iterations; n++)
+		SimdMath::composeAffine(translations.constData(), rotations.constData(), scales.constData(), matrices.data(), count);
+	simdTime = timer.nsecsElapsed();
+
+	difference = 0.0f;
+	for (int i = 0; i < count; i++)
+		difference = qMax(difference, maxDifference(qtMatrices[i], matrices[i]));
+	reportKernel(output, "compose  ", qtTime, simdTime, itemCount, difference);
+
+	// affine multiply, each matrix with its neighbour
+	timer.restart();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++)
+			qtResults[i] = qtMatrices[i] * qtMatrices[count - 1 - i];
+	}
+	qtTime = timer.nsecsElapsed();
+
+	QVector<Matrix4> reversed(count);
+	for (int i = 0; i < count; i++)
+		reversed[i] = matrices[count - 1 - i];
+	timer.restart();
+	for (int n = 0; n < iterations; n++)
+		SimdMath::multiplyAffine(matrices.constData(), reversed.constData(), results.data(), count);
+	simdTime = timer.nsecsElapsed();
+
+	difference = 0.0f;
+	for (int i = 0; i < count; i++)
+		difference = qMax(difference, maxDifference(qtResults[i], results[i]));
+	reportKernel(output, "multiply ", qtTime, simdTime, itemCount, difference);
+
+	// affine inverse
+	timer.restart();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++)
+			qtResults[i] = qtMatrices[i].inverted();
+	}
+	qtTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int n = 0; n < iterations; n++)
+		SimdMath::inverseAffine(matrices.constData(), results.data(), count);
+	simdTime = timer.nsecsElapsed();
+
+	difference = 0.0f;
+	for (int i = 0; i < count; i++)
+		difference = qMax(difference, maxDifference(qtResults[i], results[i]));
+	reportKernel(output, "inverse  ", qtTime, simdTime, itemCount, difference);
+
+	// bounding spheres
+	timer.restart();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++) {
+			const QMatrix4x4& m = qtMatrices[i];
+			float longest = qMax(m.column(0).toVector3D().lengthSquared(), qMax(m.column(1).toVector3D().lengthSquared(), m.column(2).toVector3D().lengthSquared()));
+			qtSpheres[i] = QVector4D(m.map(spheres[i].toVector3D()), spheres[i].w() * qSqrt(longest));
+		}
+	}
+	qtTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int n = 0; n < iterations; n++)
+		SimdMath::transformSpheres(matrices.constData(), spheres.constData(), resultSpheres.data(), count);
+	simdTime = timer.nsecsElapsed();
+
+	difference = 0.0f;
+	for (int i = 0; i < count; i++) {
+		for (int k = 0; k < 4; k++)
+			difference = qMax(difference, qAbs(qtSpheres[i][k] - resultSpheres[i][k]));
+	}
+	reportKernel(output, "spheres  ", qtTime, simdTime, itemCount, difference);
+
+	// bounding boxes, the QMatrix4x4 path maps the eight corners
+	timer.restart();
+	for (int n = 0; n < iterations; n++) {
+		for (int i = 0; i < count; i++) {
+			const QMatrix4x4& m = qtMatrices[i];
+			QVector3D low(FLT_MAX, FLT_MAX, FLT_MAX), high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (int corner = 0; corner < 8; corner++) {
+				QVector3D point = m.map(QVector3D(
+					(corner & 1) ? maximums[i].x() : minimums[i].x(),
+					(corner & 2) ? maximums[i].y() : minimums[i].y(),
+					(corner & 4) ? maximums[i].z() : minimums[i].z()));
+				low = QVector3D(qMin(low.x(), point.x()), qMin(low.y(), point.y()), qMin(low.z(), point.z()));
+				high = QVector3D(qMax(high.x(), point.x()), qMax(high.y(), point.y()), qMax(high.z(), point.z()));
+			}
+			qtMinimums[i] = low;
+			qtMaximums[i] = high;
+		}
+	}
+	qtTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int n = 0; n < iterations; n++)
+		SimdMath::transformBoxes(matrices.constData(), minimums.constData(), maximums.constData(), resultMinimums.data(), resultMaximums.data(), count);
+	simdTime = timer.nsecsElapsed();
+
+	difference = 0.0f;
+	for (int i = 0; i < count; i++) {
+		for (int k = 0; k < 3; k++) {
+			difference = qMax(difference, qAbs(qtMinimums[i][k] - resultMinimums[i][k]));
+			difference = qMax(difference, qAbs(qtMaximums[i][k] - resultMaximums[i][k]));
+		}
+	}
+	reportKernel(output, "boxes    ", qtTime, simdTime, itemCount, difference);
+}
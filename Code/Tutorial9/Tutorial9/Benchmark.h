@@ -0,0 +1,12 @@
+#pragma once
+#include <qtextstream.h>
+
+class Benchmark {
+public:
+	static void run(QTextStream& output);
+
+private:
+	static void runTransformUpdate(QTextStream& output);
+	static void runMathKernels(QTextStream& output);
+};
+
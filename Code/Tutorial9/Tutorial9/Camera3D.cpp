@@ -7,8 +7,6 @@ Input:
 	@ void parameter: void;
 */
 Camera3D::Camera3D() {
-	this->s = 1.0;
-	g.setToIdentity();
 }
 
 /*
@@ -20,7 +18,7 @@ Output:
 	@ void returnValue: void;
 */
 void Camera3D::rotate(const QQuaternion& r) {
-	this->r = r * this->r;
+	transform.rotate(r);
 }
 
 /*
@@ -32,7 +30,7 @@ Output:
 	@ void returnValue: void;
 */
 void Camera3D::translate(const QVector3D& t) {
-	this->t += t;
+	transform.translate(t);
 }
 
 /*
@@ -44,7 +42,7 @@ Output:
 	@ void returnValue: void;
 */
 void Camera3D::scale(const float& s) {
-	this->s *= s;
+	transform.scale(s);
 }
 
 /*
@@ -56,7 +54,19 @@ Output:
 	@ void returnValue: void;
 */
 void Camera3D::setGlobalTransform(const QMatrix4x4& g) {
-	this->g = g;
+	transform.setGlobalTransform(g);
+}
+
+/*
+Description:
+	This function is used to attach the camera to the transform of its parent, so that its world matrix follows the parent;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void Camera3D::setParentTransform(Transform3D* parent) {
+	transform.setParent(parent);
 }
 
 /*
@@ -72,10 +82,58 @@ void Camera3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* funct
 
 	if (functions != 0) return;
 
-	viewMatrix.setToIdentity();
-	viewMatrix.translate(t);
-	viewMatrix.rotate(r);
-	viewMatrix.scale(s);
-	viewMatrix = viewMatrix * g.inverted();
+	updateViewMatrix();
 	shaderProgram->setUniformValue("u_viewMatrix", viewMatrix);
 }
+
+/*
+Description:
+	This function is used to compute the view matrix from the current transform without drawing, f. ex. to capture it for a frame drawn on another thread;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Camera3D::updateViewMatrix() {
+	// the parent matrix is always affine, so the cheaper affine inverse is enough
+	viewMatrix = transform.getLocalMatrix() * Transform3D::affineInverse(transform.getParentMatrix());
+}
+
+
+/*
+Description:
+	This function is used to draw the depth of the camera, the camera has no geometry, so nothing is drawn in the depth prepass;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void Camera3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	(void)shaderProgram;
+	(void)functions;
+}
+
+/*
+Description:
+	This function is used to record the draws of the camera, the camera has no geometry, so nothing is recorded;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void Camera3D::record(CommandBuffer* commands) {
+	(void)commands;
+}
+
+/*
+Description:
+	This function is used to get the view matrix computed by the last call of Camera3D::draw(QOpenGLShaderProgram*, QOpenGLFunctions*) or Camera3D::updateViewMatrix();
+Input:
+	@ void parameter: void;
+Output:
+	@ const QMatrix4x4& returnValue: the view matrix;
+*/
+const QMatrix4x4& Camera3D::getViewMatrix() const {
+	return viewMatrix;
+}
@@ -10,13 +10,15 @@ public:
 	void translate(const QVector3D& t);
 	void scale(const float& s);
 	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
 	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions = 0);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions = 0);
+	void record(CommandBuffer* commands);
+	void updateViewMatrix();
+	const QMatrix4x4& getViewMatrix() const;
 
 private:
-	QQuaternion r;
-	QVector3D t;
-	float s;
-	QMatrix4x4 g;
+	Transform3D transform;
 
 	QMatrix4x4 viewMatrix;
 };
@@ -0,0 +1,231 @@
+#include "CommandBuffer.h"
+#include "SimpleObject3D.h"
+#include "ShaderLibrary.h"
+#include "Prefab3D.h"
+#include "GLStateCache.h"
+#include <algorithm>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ JobSystem* jobSystem: the job system whose threads record the commands;
+*/
+CommandBuffer::CommandBuffer(JobSystem* jobSystem) :
+	jobSystem(jobSystem), depthPass(true) {
+	threadCommands.resize(jobSystem->getThreadCount());
+}
+
+/*
+Description:
+	This function is used to drop the commands of the last frame before recording a new one, the lists keep their capacity, so a frame of the same size allocates nothing;
+Input:
+	@ bool depthPass: true if the drawables record the depth prepass as well;
+Output:
+	@ void returnValue: void;
+*/
+void CommandBuffer::reset(bool depthPass) {
+	this->depthPass = depthPass;
+	for (int i = 0; i < threadCommands.size(); i++)
+		threadCommands[i].resize(0);
+	commands.resize(0);
+}
+
+/*
+Description:
+	This function is used to record a command into the list of the calling thread, which may be called by all the threads of the job system at once;
+Input:
+	@ const DrawCommand& command: the command;
+Output:
+	@ void returnValue: void;
+*/
+void CommandBuffer::record(const DrawCommand& command) {
+	threadCommands[jobSystem->getThreadIndex()].append(command);
+}
+
+/*
+Description:
+	This function is used to merge the lists of all the threads into one list sorted by pass and by the state to bind, after all the threads have finished recording;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void CommandBuffer::merge() {
+	int count = 0;
+	for (int i = 0; i < threadCommands.size(); i++)
+		count += threadCommands[i].size();
+
+	commands.resize(0);
+	commands.reserve(count);
+	for (int i = 0; i < threadCommands.size(); i++)
+		commands += threadCommands[i];
+
+	std::sort(commands.begin(), commands.end(), lessThan);
+}
+
+/*
+Description:
+	This function is used to replay the merged commands of a pass, the buffers and the instances are only bound when they differ from the command before, the texture binds are filtered by the state cache,
+	in the color pass only the commands whose material matches the variant of the shader program are drawn, an OpenGL context is supposed to be current;
+Input:
+	@ int pass: the pass, see DrawCommand::Pass;
+	@ QOpenGLShaderProgram* shaderProgram: the bound shader program including Transform.glsl and Animation.glsl;
+Output:
+	@ void returnValue: void;
+*/
+void CommandBuffer::replay(int pass, QOpenGLShaderProgram* shaderProgram) {
+	bool colorPass = pass == DrawCommand::ColorPass;
+	int verLoc = shaderProgram->attributeLocation("a_position");
+	int texLoc = colorPass ? shaderProgram->attributeLocation("a_texcoord") : -1;
+	int normLoc = colorPass ? shaderProgram->attributeLocation("a_normal") : -1;
+	if (colorPass) shaderProgram->setUniformValue("u_texture", 0);
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	GeometryArena* arena = ResourceCache::getDefault()->getGeometryArena();
+	GeometryArena::Block* boundBlock = 0;
+	Prefab3D* boundPrefab = 0;
+
+	for (int i = 0; i < commands.size(); i++) {
+		const DrawCommand& command = commands[i];
+		if (command.pass != pass) continue;
+
+		// objects are drawn once per shader variant, only the matching variant draws the object
+		if (colorPass && !ShaderLibrary::isCompatible(shaderProgram, command.material->getShaderFeatures())) continue;
+
+		if (colorPass) {
+			if (command.texture != 0) cache->bindTexture(0, command.texture);
+
+			// the diffuse maps of one size share a texture array, a draw only changes the layer
+			if (command.textureArray >= 0) {
+				ResourceCache::getDefault()->getTextureArrays()->bind(command.textureArray, 0);
+				shaderProgram->setUniformValue("u_textureLayer", command.textureLayer);
+			}
+			shaderProgram->setUniformValue("u_materialProperty.diffuseColor", command.diffuseColor);
+			shaderProgram->setUniformValue("u_materialProperty.ambienceColor", command.ambienceColor);
+			shaderProgram->setUniformValue("u_materialProperty.specularColor", command.specularColor);
+			shaderProgram->setUniformValue("u_materialProperty.shinnes", command.shinnes);
+		}
+
+		shaderProgram->setUniformValue("u_transformIndex", command.transformIndex);
+		if (command.transformIndex < 0) shaderProgram->setUniformValue("u_modelMatrix", command.modelMatrix);
+		shaderProgram->setUniformValue("u_animation", command.animation);
+
+		if (command.prefab != boundPrefab) {
+			if (command.prefab != 0) command.prefab->bindInstances(shaderProgram);
+			else shaderProgram->setUniformValue("u_instanceCount", 0);
+			boundPrefab = command.prefab;
+		}
+
+		// the geometries of a block share its buffers, so the buffers are only bound when the block changes
+		GeometryArena::Block* block = arena->getBlock(command.geometry->allocation.block);
+		if (block != boundBlock) {
+			// the depth prepass reads the position-only stream, the color pass the interleaved vertices
+			if (colorPass) {
+				cache->bindBuffer(block->vertexBuffer);
+
+				int offset = 0;
+				shaderProgram->enableAttributeArray(verLoc);
+				shaderProgram->setAttributeBuffer(verLoc, GL_FLOAT, offset, 3, sizeof(Vertex));
+
+				offset += sizeof(QVector3D);
+				shaderProgram->enableAttributeArray(texLoc);
+				shaderProgram->setAttributeBuffer(texLoc, GL_FLOAT, offset, 2, sizeof(Vertex));
+
+				offset += sizeof(QVector2D);
+				shaderProgram->enableAttributeArray(normLoc);
+				shaderProgram->setAttributeBuffer(normLoc, GL_FLOAT, offset, 3, sizeof(Vertex));
+			}
+			else {
+				cache->bindBuffer(block->positionBuffer);
+				shaderProgram->enableAttributeArray(verLoc);
+				shaderProgram->setAttributeBuffer(verLoc, GL_FLOAT, 0, 3, sizeof(QVector3D));
+			}
+			cache->bindBuffer(block->indexBuffer);
+			boundBlock = block;
+		}
+
+		arena->drawElements(command.geometry->allocation, command.instanceCount);
+	}
+
+	if (boundPrefab != 0) shaderProgram->setUniformValue("u_instanceCount", 0);
+}
+
+/*
+Description:
+	This function is used to check whether the drawables record the depth prepass as well;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the depth prepass is recorded;
+*/
+bool CommandBuffer::isDepthPassRecorded() const {
+	return depthPass;
+}
+
+/*
+Description:
+	This function is used to get the job system whose threads record the commands, containers split the recording of their children on it;
+Input:
+	@ void parameter: void;
+Output:
+	@ JobSystem* returnValue: the job system;
+*/
+JobSystem* CommandBuffer::getJobSystem() const {
+	return jobSystem;
+}
+
+/*
+Description:
+	This function is used to get the merged commands, which can be inspected without an OpenGL context;
+Input:
+	@ void parameter: void;
+Output:
+	@ const QVector<DrawCommand>& returnValue: the commands sorted by CommandBuffer::lessThan(const DrawCommand&, const DrawCommand&);
+*/
+const QVector<DrawCommand>& CommandBuffer::getCommands() const {
+	return commands;
+}
+
+/*
+Description:
+	This function is used to get the amount of commands a thread has recorded since the last reset, which shows how the recording was spread over the threads;
+Input:
+	@ int thread: the thread index, see JobSystem::getThreadIndex();
+Output:
+	@ int returnValue: the amount of commands;
+*/
+int CommandBuffer::getRecordedCount(int thread) const {
+	return threadCommands[thread].size();
+}
+
+/*
+Description:
+	This function is used to get the amount of per-thread lists;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of lists;
+*/
+int CommandBuffer::getThreadCount() const {
+	return threadCommands.size();
+}
+
+/*
+Description:
+	This function is used to order two commands by pass, instances, texture, texture array, geometry block, geometry and drawable, so that commands sharing state are replayed one after another;
+Input:
+	@ const DrawCommand& a: a command;
+	@ const DrawCommand& b: another command;
+Output:
+	@ bool returnValue: true if a is replayed before b;
+*/
+bool CommandBuffer::lessThan(const DrawCommand& a, const DrawCommand& b) {
+	if (a.pass != b.pass) return a.pass < b.pass;
+	if (a.prefab != b.prefab) return (quintptr)a.prefab < (quintptr)b.prefab;
+	if (a.texture != b.texture) return (quintptr)a.texture < (quintptr)b.texture;
+	if (a.textureArray != b.textureArray) return a.textureArray < b.textureArray;
+	if (a.geometry->allocation.block != b.geometry->allocation.block) return a.geometry->allocation.block < b.geometry->allocation.block;
+	if (a.geometry != b.geometry) return (quintptr)a.geometry < (quintptr)b.geometry;
+	return a.order < b.order;
+}
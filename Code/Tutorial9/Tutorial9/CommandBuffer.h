@@ -0,0 +1,73 @@
+#pragma once
+#include <qvector.h>
+#include <qvector3d.h>
+#include <qmatrix4x4.h>
+#include <qopengltexture.h>
+#include <qopenglshaderprogram.h>
+#include "ResourceCache.h"
+#include "Material.h"
+#include "JobSystem.h"
+
+class Prefab3D;
+
+// a draw recorded by a drawable, it only names the resources to bind and holds copies of the uniforms, so it is recorded without an OpenGL context
+struct DrawCommand {
+	enum Pass { DepthPass, ColorPass };
+
+	DrawCommand() :
+		pass(ColorPass), geometry(0), texture(0), textureArray(-1), textureLayer(0), material(0), shinnes(0.0f), transformIndex(-1), prefab(0), instanceCount(1), order(0) {
+	};
+
+	int pass;
+	ResourceCache::Geometry* geometry;
+	QOpenGLTexture* texture;
+	// the texture array and the layer of the diffuse map when the diffuse maps are packed into texture arrays
+	int textureArray;
+	int textureLayer;
+
+	// the material chooses the shader variant, its uniforms are copied when the command is recorded
+	const Material* material;
+	QVector3D diffuseColor;
+	QVector3D ambienceColor;
+	QVector3D specularColor;
+	float shinnes;
+
+	// the handle of the world matrix resolved on the GPU, or -1 to use the model matrix
+	int transformIndex;
+	QMatrix4x4 modelMatrix;
+	QMatrix4x4 animation;
+
+	// the prefab whose instance matrices are bound, 0 for a single copy
+	Prefab3D* prefab;
+	int instanceCount;
+
+	// the handle of the transform of the drawable, it orders commands of equal state, so the merged list does not depend on the threads
+	int order;
+};
+
+// the draws of a frame, recorded by all the threads of a job system at once into one list per thread, then merged and replayed by the thread owning the context
+class CommandBuffer {
+public:
+	CommandBuffer(JobSystem* jobSystem = JobSystem::getDefault());
+	void reset(bool depthPass);
+	void record(const DrawCommand& command);
+	void merge();
+	void replay(int pass, QOpenGLShaderProgram* shaderProgram);
+	bool isDepthPassRecorded() const;
+	JobSystem* getJobSystem() const;
+	const QVector<DrawCommand>& getCommands() const;
+	int getRecordedCount(int thread) const;
+	int getThreadCount() const;
+
+	static bool lessThan(const DrawCommand& a, const DrawCommand& b);
+
+private:
+	Q_DISABLE_COPY(CommandBuffer)
+
+	JobSystem* jobSystem;
+
+	// one list per thread index of the job system, the workers and the threads that are not workers, a thread only appends to its own list, so recording takes no lock
+	QVector<QVector<DrawCommand> > threadCommands;
+	QVector<DrawCommand> commands;
+	bool depthPass;
+};
@@ -0,0 +1,595 @@
+#include "FrameGraph.h"
+#include "GLStateCache.h"
+#include <algorithm>
+
+/*
+Description:
+	This function is a constructor, no texture is created before the first compile;
+Input:
+	@ void parameter: void;
+*/
+FrameGraph::FrameGraph() :
+	functions(0) {
+}
+
+/*
+Description:
+	This function is a destructor, an OpenGL context is supposed to be current;
+Input:
+	@ void patameter: void;
+*/
+FrameGraph::~FrameGraph() {
+	if (functions == 0) return;
+
+	for (QHash<QByteArray, GLuint>::iterator i = framebuffers.begin(); i != framebuffers.end(); ++i)
+		functions->glDeleteFramebuffers(1, &i.value());
+	for (int i = 0; i < textures.size(); i++)
+		functions->glDeleteTextures(1, &textures[i].texture);
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to drop the passes and the resources of the last frame, the textures are kept for the next compile;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::reset() {
+	resources.clear();
+	passes.clear();
+	order.clear();
+}
+
+/*
+Description:
+	This function is used to declare a transient texture, which is only created when a pass kept by the compile uses it;
+Input:
+	@ const QString& name: the name of the texture;
+	@ const TextureDesc& desc: the size and the format;
+Output:
+	@ int returnValue: the resource;
+*/
+int FrameGraph::createTexture(const QString& name, const TextureDesc& desc) {
+	Resource resource;
+	resource.name = name;
+	resource.type = Texture;
+	resource.desc = desc;
+	resource.framebuffer = 0;
+	resource.physical = -1;
+	resource.firstUse = resource.lastUse = -1;
+	resources.append(resource);
+	return resources.size() - 1;
+}
+
+/*
+Description:
+	This function is used to declare a resource the graph does not manage, such as the draw commands written by a compute shader, it only orders the passes using it;
+Input:
+	@ const QString& name: the name of the resource;
+Output:
+	@ int returnValue: the resource;
+*/
+int FrameGraph::createBuffer(const QString& name) {
+	int resource = createTexture(name, TextureDesc());
+	resources[resource].type = Buffer;
+	return resource;
+}
+
+/*
+Description:
+	This function is used to declare a framebuffer created outside of the graph, such as the one of QOpenGLWidget, whatever is written to it is seen outside, so its writers are never culled;
+Input:
+	@ const QString& name: the name of the framebuffer;
+	@ GLuint framebuffer: the framebuffer;
+	@ int width: the width in pixels;
+	@ int height: the height in pixels;
+Output:
+	@ int returnValue: the resource;
+*/
+int FrameGraph::importFramebuffer(const QString& name, GLuint framebuffer, int width, int height) {
+	int resource = createTexture(name, TextureDesc(width, height, GL_RGBA8));
+	resources[resource].type = Framebuffer;
+	resources[resource].framebuffer = framebuffer;
+	return resource;
+}
+
+/*
+Description:
+	This function is used to declare a pass, the function is called by execute() with the framebuffer of the pass bound;
+Input:
+	@ const QString& name: the name of the pass;
+	@ const std::function<void()>& execute: the function drawing the pass;
+Output:
+	@ int returnValue: the pass;
+*/
+int FrameGraph::addPass(const QString& name, const std::function<void()>& execute) {
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.viewportWidth = pass.viewportHeight = 0;
+	pass.sideEffect = false;
+	passes.append(pass);
+	return passes.size() - 1;
+}
+
+/*
+Description:
+	This function is used to declare that a pass reads a resource, it reads what the passes declared before wrote, a pass drawing over the content of a target reads it as well,
+	a transient texture or buffer no pass declared before wrote is read from the first pass declared after that writes it, so a producer may be declared after its consumer;
+Input:
+	@ int pass: the pass;
+	@ int resource: the resource;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::read(int pass, int resource) {
+	if (!passes[pass].reads.contains(resource)) passes[pass].reads.append(resource);
+}
+
+/*
+Description:
+	This function is used to declare that a pass writes a resource, the textures and the framebuffer written are the target of the pass;
+Input:
+	@ int pass: the pass;
+	@ int resource: the resource;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::write(int pass, int resource) {
+	if (!passes[pass].writes.contains(resource)) passes[pass].writes.append(resource);
+}
+
+/*
+Description:
+	This function is used to declare that a pass reads a texture through the attachments of its target, such as a depth buffer tested against with the depth writes off,
+	the texture is attached beside the textures the pass writes, but its content is not changed, so the pass is not a writer of it;
+Input:
+	@ int pass: the pass;
+	@ int resource: the resource;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::attach(int pass, int resource) {
+	read(pass, resource);
+	if (!passes[pass].attachments.contains(resource)) passes[pass].attachments.append(resource);
+}
+
+/*
+Description:
+	This function is used to draw a pass to the lower left region of its target, such as a scene drawn at a scale into textures sized for the largest scale, so they are not created again when the scale changes;
+Input:
+	@ int pass: the pass;
+	@ int width: the width of the region in pixels;
+	@ int height: the height of the region in pixels;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::setViewport(int pass, int width, int height) {
+	passes[pass].viewportWidth = width;
+	passes[pass].viewportHeight = height;
+}
+
+/*
+Description:
+	This function is used to keep a pass whose result is used outside of the frame, such as the depth kept for the next frame;
+Input:
+	@ int pass: the pass;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::setSideEffect(int pass) {
+	passes[pass].sideEffect = true;
+}
+
+/*
+Description:
+	This function is used to cull the passes not contributing to a framebuffer or a side effect, order the others by their dependencies and give the transient textures their memory,
+	an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the passes could be ordered, false if they depend on each other in a cycle;
+*/
+bool FrameGraph::compile() {
+	if (functions == 0) functions = GLStateCache::getDefault()->getFunctions();
+	order.clear();
+
+	// the first writer of a transient resource produces it for the passes reading it before, an imported framebuffer already has its content
+	QVector<int> firstWriter(resources.size(), -1);
+	for (int p = passes.size() - 1; p >= 0; p--) {
+		for (int i = 0; i < passes[p].writes.size(); i++) {
+			int r = passes[p].writes[i];
+			if (resources[r].type != Framebuffer) firstWriter[r] = p;
+		}
+	}
+
+	// a read depends on the last writer declared before it, or on the first writer after it for a resource not written yet,
+	// a write on the last writer and on the readers since, so no pass overwrites what another one still reads
+	QVector<QVector<int> > successors(passes.size());
+	QVector<QVector<int> > producers(passes.size());
+	QVector<int> lastWriter(resources.size(), -1);
+	QVector<QVector<int> > readers(resources.size());
+	QVector<QVector<int> > earlyReaders(resources.size());
+	for (int p = 0; p < passes.size(); p++) {
+		const Pass& pass = passes[p];
+		for (int i = 0; i < pass.reads.size(); i++) {
+			int r = pass.reads[i];
+			int producer = lastWriter[r] >= 0 ? lastWriter[r] : firstWriter[r];
+			if (producer >= 0 && producer != p) {
+				successors[producer].append(p);
+				producers[p].append(producer);
+			}
+
+			// a pass reading before the first writer reads its result, so it only becomes a reader once the first writer is reached
+			if (lastWriter[r] >= 0 || producer < 0) readers[r].append(p);
+			else if (producer != p) earlyReaders[r].append(p);
+		}
+		for (int i = 0; i < pass.writes.size(); i++) {
+			int r = pass.writes[i];
+			if (lastWriter[r] >= 0 && lastWriter[r] != p) successors[lastWriter[r]].append(p);
+			for (int k = 0; k < readers[r].size(); k++) {
+				if (readers[r][k] != p) successors[readers[r][k]].append(p);
+			}
+			readers[r].clear();
+			if (lastWriter[r] < 0) readers[r] = earlyReaders[r];
+			lastWriter[r] = p;
+		}
+	}
+
+	// the passes writing a framebuffer or with a side effect are kept, and the passes producing what a kept pass reads
+	QVector<bool> kept(passes.size(), false);
+	QVector<int> stack;
+	for (int p = 0; p < passes.size(); p++) {
+		bool output = passes[p].sideEffect;
+		for (int i = 0; i < passes[p].writes.size() && !output; i++)
+			output = resources[passes[p].writes[i]].type == Framebuffer;
+		if (output) {
+			kept[p] = true;
+			stack.append(p);
+		}
+	}
+	while (!stack.isEmpty()) {
+		int p = stack.takeLast();
+		for (int i = 0; i < producers[p].size(); i++) {
+			int producer = producers[p][i];
+			if (kept[producer]) continue;
+			kept[producer] = true;
+			stack.append(producer);
+		}
+	}
+
+	// the kept passes are ordered by their dependencies, a pass ready earlier in the declaration goes first
+	QVector<int> waiting(passes.size(), 0);
+	int keptCount = 0;
+	for (int p = 0; p < passes.size(); p++) {
+		if (!kept[p]) continue;
+		keptCount++;
+		for (int i = 0; i < successors[p].size(); i++)
+			waiting[successors[p][i]]++;
+	}
+	QVector<int> ready;
+	for (int p = 0; p < passes.size(); p++) {
+		if (kept[p] && waiting[p] == 0) ready.append(p);
+	}
+	while (!ready.isEmpty()) {
+		int first = std::min_element(ready.begin(), ready.end()) - ready.begin();
+		int p = ready[first];
+		ready.remove(first);
+		order.append(p);
+		for (int i = 0; i < successors[p].size(); i++) {
+			int successor = successors[p][i];
+			if (kept[successor] && --waiting[successor] == 0) ready.append(successor);
+		}
+	}
+	if (order.size() != keptCount) {
+		order.clear();
+		return false;
+	}
+
+	assignTextures();
+	return true;
+}
+
+/*
+Description:
+	This function is used to run the kept passes in order, the target of a pass is bound before it runs, the viewport is set when the region drawn changes, the whole target unless the pass set a viewport;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::execute() {
+	GLStateCache* cache = GLStateCache::getDefault();
+	int viewportWidth = -1, viewportHeight = -1;
+
+	for (int i = 0; i < order.size(); i++) {
+		const Resource* target = getTarget(order[i]);
+		if (target != 0) {
+			cache->bindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer(order[i]));
+			const Pass& pass = passes[order[i]];
+			int width = pass.viewportWidth > 0 ? pass.viewportWidth : target->desc.width;
+			int height = pass.viewportHeight > 0 ? pass.viewportHeight : target->desc.height;
+			if (width != viewportWidth || height != viewportHeight) {
+				viewportWidth = width;
+				viewportHeight = height;
+				functions->glViewport(0, 0, viewportWidth, viewportHeight);
+			}
+		}
+
+		passes[order[i]].execute();
+	}
+}
+
+/*
+Description:
+	This function is used to get the framebuffer a pass draws to, such as for a pass copying from the target of another one, which is valid from the compile to the end of the frame;
+Input:
+	@ int pass: the pass;
+Output:
+	@ GLuint returnValue: the framebuffer of the transient textures written or attached by the pass or the imported framebuffer written by it, 0 for a pass with neither;
+*/
+GLuint FrameGraph::getTargetFramebuffer(int pass) {
+	const Resource* target = getTarget(pass);
+	if (target == 0) return 0;
+	if (target->type == Framebuffer) return target->framebuffer;
+
+	QVector<int> physicals;
+	QVector<int> attached = passes[pass].writes + passes[pass].attachments;
+	for (int i = 0; i < attached.size(); i++) {
+		if (resources[attached[i]].type == Texture) physicals.append(resources[attached[i]].physical);
+	}
+	return getFramebuffer(physicals);
+}
+
+/*
+Description:
+	This function is used to get the texture holding a transient texture, which is valid from the compile to the end of the frame;
+Input:
+	@ int resource: the resource;
+Output:
+	@ GLuint returnValue: the texture, 0 for a resource without one or a texture of a culled pass;
+*/
+GLuint FrameGraph::getTexture(int resource) const {
+	if (resource < 0 || resource >= resources.size() || resources[resource].physical < 0) return 0;
+	return textures[resources[resource].physical].texture;
+}
+
+/*
+Description:
+	This function is used to get the amount of passes kept by the last compile;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of passes;
+*/
+int FrameGraph::getPassCount() const {
+	return order.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of passes culled by the last compile;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of passes;
+*/
+int FrameGraph::getCulledPassCount() const {
+	return passes.size() - order.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of textures the transient textures are placed in;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of textures;
+*/
+int FrameGraph::getTextureCount() const {
+	return textures.size();
+}
+
+/*
+Description:
+	This function is used to get the memory of the textures the transient textures are placed in;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 FrameGraph::getTextureBytes() const {
+	qint64 bytes = 0;
+	for (int i = 0; i < textures.size(); i++)
+		bytes += getBytes(textures[i].desc);
+	return bytes;
+}
+
+/*
+Description:
+	This function is used to get the memory the transient textures used by the last compile would take without sharing, to compare with getTextureBytes();
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 FrameGraph::getRequestedBytes() const {
+	qint64 bytes = 0;
+	for (int i = 0; i < resources.size(); i++) {
+		if (resources[i].type == Texture && resources[i].physical >= 0) bytes += getBytes(resources[i].desc);
+	}
+	return bytes;
+}
+
+/*
+Description:
+	This function is used to find the target of a pass, a pass writing or attaching transient textures draws to a framebuffer of them, a pass writing an imported framebuffer to it;
+Input:
+	@ int pass: the pass;
+Output:
+	@ const Resource* returnValue: a transient texture written or attached, or the imported framebuffer written, 0 for a pass with neither, such as a compute pass;
+*/
+const FrameGraph::Resource* FrameGraph::getTarget(int pass) const {
+	const Resource* target = 0;
+	QVector<int> attached = passes[pass].writes + passes[pass].attachments;
+	for (int i = 0; i < attached.size(); i++) {
+		const Resource& resource = resources[attached[i]];
+		if (resource.type == Texture && resource.physical >= 0) return &resource;
+		if (resource.type == Framebuffer && target == 0) target = &resource;
+	}
+	return target;
+}
+
+/*
+Description:
+	This function is used to estimate the memory of a texture;
+Input:
+	@ const TextureDesc& desc: the size and the format;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 FrameGraph::getBytes(const TextureDesc& desc) {
+	int pixelBytes = 4;
+	switch (desc.format) {
+	case GL_R8: pixelBytes = 1; break;
+	case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: pixelBytes = 2; break;
+	case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: pixelBytes = 8; break;
+	case GL_RGBA32F: pixelBytes = 16; break;
+	}
+	return qint64(desc.width) * desc.height * pixelBytes;
+}
+
+/*
+Description:
+	This function is used to check whether a format is attached as depth;
+Input:
+	@ GLenum format: the internal format;
+Output:
+	@ bool returnValue: true for a depth or depth and stencil format;
+*/
+bool FrameGraph::isDepthFormat(GLenum format) {
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F ||
+		format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+/*
+Description:
+	This function is used to give every transient texture of the kept passes a texture of the pool, a texture is shared by transient textures of one description whose passes do not overlap,
+	the textures of the pool no graph needs any more are deleted;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void FrameGraph::assignTextures() {
+	for (int i = 0; i < order.size(); i++) {
+		const Pass& pass = passes[order[i]];
+		for (int k = 0; k < pass.reads.size() + pass.writes.size(); k++) {
+			Resource& resource = resources[k < pass.reads.size() ? pass.reads[k] : pass.writes[k - pass.reads.size()]];
+			if (resource.type != Texture) continue;
+			if (resource.firstUse < 0) resource.firstUse = i;
+			resource.lastUse = i;
+		}
+	}
+
+	QVector<int> transients;
+	for (int r = 0; r < resources.size(); r++) {
+		if (resources[r].type == Texture && resources[r].firstUse >= 0) transients.append(r);
+	}
+	std::sort(transients.begin(), transients.end(), [this](int a, int b) { return resources[a].firstUse < resources[b].firstUse; });
+
+	for (int i = 0; i < textures.size(); i++) {
+		textures[i].busyUntil = -1;
+		textures[i].used = false;
+	}
+
+	// a texture is free for a transient texture after the last pass of the one before
+	for (int i = 0; i < transients.size(); i++) {
+		Resource& resource = resources[transients[i]];
+		int physical = -1;
+		for (int t = 0; t < textures.size() && physical < 0; t++) {
+			if (textures[t].desc == resource.desc && textures[t].busyUntil < resource.firstUse) physical = t;
+		}
+
+		if (physical < 0) {
+			PhysicalTexture texture;
+			texture.desc = resource.desc;
+			functions->glGenTextures(1, &texture.texture);
+			GLStateCache::getDefault()->bindTexture(0, GL_TEXTURE_2D, texture.texture);
+			functions->glTexStorage2D(GL_TEXTURE_2D, 1, resource.desc.format, resource.desc.width, resource.desc.height);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, isDepthFormat(resource.desc.format) ? GL_NEAREST : GL_LINEAR);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, isDepthFormat(resource.desc.format) ? GL_NEAREST : GL_LINEAR);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			textures.append(texture);
+			physical = textures.size() - 1;
+		}
+
+		textures[physical].busyUntil = resource.lastUse;
+		textures[physical].used = true;
+		resource.physical = physical;
+	}
+
+	// the textures no transient texture is placed in are deleted, the others move down, so the resources are given their new indices
+	QVector<int> remap(textures.size(), -1);
+	int kept = 0;
+	for (int i = 0; i < textures.size(); i++) {
+		if (textures[i].used) {
+			remap[i] = kept;
+			textures[kept++] = textures[i];
+		}
+		else functions->glDeleteTextures(1, &textures[i].texture);
+	}
+	if (kept == textures.size()) return;
+
+	textures.resize(kept);
+	for (int i = 0; i < transients.size(); i++)
+		resources[transients[i]].physical = remap[resources[transients[i]].physical];
+
+	// the names of the deleted textures may be reused, so the framebuffers, which are found by the names of their textures, are created again
+	for (QHash<QByteArray, GLuint>::iterator i = framebuffers.begin(); i != framebuffers.end(); ++i)
+		functions->glDeleteFramebuffers(1, &i.value());
+	framebuffers.clear();
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to get the framebuffer with a set of textures of the pool attached, the framebuffer is created on the first use;
+Input:
+	@ const QVector<int>& physicals: the textures of the pool;
+Output:
+	@ GLuint returnValue: the framebuffer;
+*/
+GLuint FrameGraph::getFramebuffer(const QVector<int>& physicals) {
+	QByteArray key;
+	for (int i = 0; i < physicals.size(); i++)
+		key.append((const char*)&textures[physicals[i]].texture, sizeof(GLuint));
+
+	QHash<QByteArray, GLuint>::const_iterator found = framebuffers.constFind(key);
+	if (found != framebuffers.constEnd()) return found.value();
+
+	GLuint framebuffer = 0;
+	functions->glGenFramebuffers(1, &framebuffer);
+	GLStateCache::getDefault()->bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	QVector<GLenum> drawBuffers;
+	for (int i = 0; i < physicals.size(); i++) {
+		const PhysicalTexture& texture = textures[physicals[i]];
+		GLenum attachment;
+		if (texture.desc.format == GL_DEPTH24_STENCIL8 || texture.desc.format == GL_DEPTH32F_STENCIL8) attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+		else if (isDepthFormat(texture.desc.format)) attachment = GL_DEPTH_ATTACHMENT;
+		else {
+			attachment = GL_COLOR_ATTACHMENT0 + drawBuffers.size();
+			drawBuffers.append(attachment);
+		}
+		functions->glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture.texture, 0);
+	}
+	if (drawBuffers.isEmpty()) functions->glDrawBuffer(GL_NONE);
+	else functions->glDrawBuffers(drawBuffers.size(), drawBuffers.constData());
+
+	framebuffers.insert(key, framebuffer);
+	return framebuffer;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <qvector.h>
+#include <qhash.h>
+#include <qstring.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include <functional>
+
+// the passes of a frame, declared with the resources they read and write, the graph is built again every frame,
+// passes whose results nobody uses are culled, the others are ordered by their dependencies, and the transient textures
+// of passes that are never alive at the same time share one texture, so adding passes adds little memory
+class FrameGraph {
+public:
+	// a texture only alive during the frame, it is created by the graph and attached to the framebuffer of the passes writing it
+	struct TextureDesc {
+		TextureDesc() : width(0), height(0), format(GL_RGBA8) {};
+		TextureDesc(int width, int height, GLenum format) : width(width), height(height), format(format) {};
+		bool operator==(const TextureDesc& other) const { return width == other.width && height == other.height && format == other.format; };
+		int width;
+		int height;
+		GLenum format;
+	};
+
+	FrameGraph();
+	~FrameGraph();
+	void reset();
+	int createTexture(const QString& name, const TextureDesc& desc);
+	int createBuffer(const QString& name);
+	int importFramebuffer(const QString& name, GLuint framebuffer, int width, int height);
+	int addPass(const QString& name, const std::function<void()>& execute);
+	void read(int pass, int resource);
+	void write(int pass, int resource);
+	void attach(int pass, int resource);
+	void setViewport(int pass, int width, int height);
+	void setSideEffect(int pass);
+	bool compile();
+	void execute();
+	GLuint getTargetFramebuffer(int pass);
+	GLuint getTexture(int resource) const;
+	int getPassCount() const;
+	int getCulledPassCount() const;
+	int getTextureCount() const;
+	qint64 getTextureBytes() const;
+	qint64 getRequestedBytes() const;
+
+private:
+	Q_DISABLE_COPY(FrameGraph)
+
+	enum ResourceType { Texture, Buffer, Framebuffer };
+
+	struct Resource {
+		QString name;
+		ResourceType type;
+		TextureDesc desc;
+		GLuint framebuffer;
+		// the physical texture of a transient texture, and the positions of the first and the last pass using it in the order
+		int physical;
+		int firstUse;
+		int lastUse;
+	};
+
+	struct Pass {
+		QString name;
+		std::function<void()> execute;
+		QVector<int> reads;
+		QVector<int> writes;
+		// the textures attached to the target without being written, such as a depth buffer only tested against
+		QVector<int> attachments;
+		// the region of the target drawn from the lower left corner, 0 for the whole target
+		int viewportWidth;
+		int viewportHeight;
+		bool sideEffect;
+	};
+
+	// a texture of the pool, kept between frames while a graph needs a texture of its description
+	struct PhysicalTexture {
+		GLuint texture;
+		TextureDesc desc;
+		// the position of the last pass of the transient texture using it, -1 before the first
+		int busyUntil;
+		bool used;
+	};
+
+	const Resource* getTarget(int pass) const;
+	static qint64 getBytes(const TextureDesc& desc);
+	static bool isDepthFormat(GLenum format);
+	void assignTextures();
+	GLuint getFramebuffer(const QVector<int>& physicals);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+
+	QVector<Resource> resources;
+	QVector<Pass> passes;
+
+	// the passes kept by the last compile, in the order they are executed
+	QVector<int> order;
+
+	QVector<PhysicalTexture> textures;
+	// the framebuffers by the textures attached to them, they are deleted with any of their textures
+	QHash<QByteArray, GLuint> framebuffers;
+};
@@ -0,0 +1,347 @@
+#include "GLStateCache.h"
+#include <qopenglcontext.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+GLStateCache::GLStateCache() :
+	functions(0), issuedCount(0), elidedCount(0), lastIssuedCount(0), lastElidedCount(0) {
+}
+
+/*
+Description:
+	This function is used to get the OpenGL functions of the current context, all the drawing code uses the cache of this context afterwards, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::init() {
+	functions = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_3_Compatibility>();
+	if (functions != 0) functions->initializeOpenGLFunctions();
+	invalidate();
+}
+
+/*
+Description:
+	This function is used to start a frame, the counts of the frame before are kept and the state is forgotten, since the context may have been used by Qt in between;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::beginFrame() {
+	lastIssuedCount = issuedCount;
+	lastElidedCount = elidedCount;
+	issuedCount = 0;
+	elidedCount = 0;
+	invalidate();
+}
+
+/*
+Description:
+	This function is used to forget the state, after code outside of the cache changed it, or after objects were deleted, whose names may be reused by new objects;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::invalidate() {
+	states.clear();
+}
+
+/*
+Description:
+	This function is used to bind a shader program;
+Input:
+	@ QOpenGLShaderProgram* program: the shader program, 0 to bind none;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::useProgram(QOpenGLShaderProgram* program) {
+	if (!change(getKey(Program), program != 0 ? program->programId() : 0)) return;
+
+	if (program != 0) program->bind();
+	else functions->glUseProgram(0);
+}
+
+/*
+Description:
+	This function is used to bind a vertex array object, the index buffer belongs to the vertex array, so it becomes unknown;
+Input:
+	@ GLuint vertexArray: the vertex array object;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindVertexArray(GLuint vertexArray) {
+	if (!change(getKey(VertexArray), vertexArray)) return;
+
+	functions->glBindVertexArray(vertexArray);
+	states.remove(getKey(Buffer, GL_ELEMENT_ARRAY_BUFFER));
+}
+
+/*
+Description:
+	This function is used to bind a buffer to a target;
+Input:
+	@ GLenum target: the target, such as GL_ARRAY_BUFFER;
+	@ GLuint buffer: the buffer, 0 to bind none;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+	if (!change(getKey(Buffer, target), buffer)) return;
+	functions->glBindBuffer(target, buffer);
+}
+
+/*
+Description:
+	This function is used to bind a buffer to the target of its type, instead of QOpenGLBuffer::bind();
+Input:
+	@ QOpenGLBuffer& buffer: the buffer;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindBuffer(QOpenGLBuffer& buffer) {
+	bindBuffer(buffer.type(), buffer.bufferId());
+}
+
+/*
+Description:
+	This function is used to bind a buffer to an indexed target, which binds it to the generic target as well;
+Input:
+	@ GLenum target: the target, such as GL_SHADER_STORAGE_BUFFER;
+	@ GLuint index: the binding point;
+	@ GLuint buffer: the buffer;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	if (!change(getKey(IndexedBuffer, target, index), buffer)) return;
+
+	functions->glBindBufferBase(target, index, buffer);
+	states.insert(getKey(Buffer, target), buffer);
+}
+
+/*
+Description:
+	This function is used to bind a texture to a texture unit, the active unit is only changed when a texture is bound;
+Input:
+	@ int unit: the texture unit;
+	@ GLenum target: the target, such as GL_TEXTURE_2D;
+	@ GLuint texture: the texture, 0 to bind none;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindTexture(int unit, GLenum target, GLuint texture) {
+	if (!change(getKey(Texture, target, unit), texture)) return;
+
+	activeTexture(unit);
+	functions->glBindTexture(target, texture);
+}
+
+/*
+Description:
+	This function is used to bind a texture to a texture unit, instead of QOpenGLTexture::bind(uint);
+Input:
+	@ int unit: the texture unit;
+	@ QOpenGLTexture* texture: the texture;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindTexture(int unit, QOpenGLTexture* texture) {
+	bindTexture(unit, texture->target(), texture->textureId());
+}
+
+/*
+Description:
+	This function is used to bind a framebuffer, GL_FRAMEBUFFER binds both the draw and the read framebuffer;
+Input:
+	@ GLenum target: the target;
+	@ GLuint framebuffer: the framebuffer;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer) {
+	if (target == GL_FRAMEBUFFER) {
+		quint64 draw = getKey(Framebuffer, GL_DRAW_FRAMEBUFFER), read = getKey(Framebuffer, GL_READ_FRAMEBUFFER);
+		if (states.contains(draw) && states.contains(read) && states.value(draw) == framebuffer && states.value(read) == framebuffer) {
+			elidedCount++;
+			return;
+		}
+		states.insert(draw, framebuffer);
+		states.insert(read, framebuffer);
+		issuedCount++;
+	}
+	else if (!change(getKey(Framebuffer, target), framebuffer)) return;
+
+	functions->glBindFramebuffer(target, framebuffer);
+}
+
+/*
+Description:
+	This function is used to enable a capability;
+Input:
+	@ GLenum capability: the capability, such as GL_DEPTH_TEST;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::enable(GLenum capability) {
+	if (!change(getKey(Capability, capability), 1)) return;
+	functions->glEnable(capability);
+}
+
+/*
+Description:
+	This function is used to disable a capability;
+Input:
+	@ GLenum capability: the capability, such as GL_DEPTH_TEST;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::disable(GLenum capability) {
+	if (!change(getKey(Capability, capability), 0)) return;
+	functions->glDisable(capability);
+}
+
+/*
+Description:
+	This function is used to set the depth test function;
+Input:
+	@ GLenum function: the function, such as GL_LESS;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::depthFunc(GLenum function) {
+	if (!change(getKey(DepthFunc), function)) return;
+	functions->glDepthFunc(function);
+}
+
+/*
+Description:
+	This function is used to enable or disable depth writes;
+Input:
+	@ bool enabled: true to write depth;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::depthMask(bool enabled) {
+	if (!change(getKey(DepthMask), enabled)) return;
+	functions->glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+/*
+Description:
+	This function is used to enable or disable color writes, all the channels at once;
+Input:
+	@ bool enabled: true to write color;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::colorMask(bool enabled) {
+	if (!change(getKey(ColorMask), enabled)) return;
+
+	GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+	functions->glColorMask(mask, mask, mask, mask);
+}
+
+/*
+Description:
+	This function is used to get the OpenGL functions, for the calls that do not change the cached state;
+Input:
+	@ void parameter: void;
+Output:
+	@ QOpenGLFunctions_4_3_Compatibility* returnValue: the OpenGL functions;
+*/
+QOpenGLFunctions_4_3_Compatibility* GLStateCache::getFunctions() const {
+	return functions;
+}
+
+/*
+Description:
+	This function is used to get the amount of state changes sent to OpenGL by the last frame;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of calls;
+*/
+int GLStateCache::getIssuedCount() const {
+	return lastIssuedCount;
+}
+
+/*
+Description:
+	This function is used to get the amount of state changes dropped by the last frame, since the state was set already;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of calls;
+*/
+int GLStateCache::getElidedCount() const {
+	return lastElidedCount;
+}
+
+/*
+Description:
+	This function is used to get the cache of the context the application draws with, the drawing is done by one thread at a time, so the cache is not locked;
+Input:
+	@ void parameter: void;
+Output:
+	@ GLStateCache* returnValue: the default cache;
+*/
+GLStateCache* GLStateCache::getDefault() {
+	static GLStateCache cache;
+	return &cache;
+}
+
+/*
+Description:
+	This function is used to build the key of a piece of state;
+Input:
+	@ State state: the kind of state;
+	@ GLenum target: the target or capability, 0 if there is none;
+	@ GLuint index: the texture unit or the binding point, 0 if there is none;
+Output:
+	@ quint64 returnValue: the key;
+*/
+quint64 GLStateCache::getKey(State state, GLenum target, GLuint index) {
+	return (quint64(state) << 48) | (quint64(target & 0xffffffff) << 16) | quint64(index & 0xffff);
+}
+
+/*
+Description:
+	This function is used to record a new value of a piece of state and count the call;
+Input:
+	@ quint64 key: the key of the state;
+	@ quint64 value: the new value;
+Output:
+	@ bool returnValue: true if the value differs from the known one, or none is known, so the call is sent to OpenGL;
+*/
+bool GLStateCache::change(quint64 key, quint64 value) {
+	QHash<quint64, quint64>::iterator known = states.find(key);
+	if (known != states.end() && known.value() == value) {
+		elidedCount++;
+		return false;
+	}
+
+	if (known != states.end()) known.value() = value;
+	else states.insert(key, value);
+	issuedCount++;
+	return true;
+}
+
+/*
+Description:
+	This function is used to select the texture unit the texture calls apply to;
+Input:
+	@ int unit: the texture unit;
+Output:
+	@ void returnValue: void;
+*/
+void GLStateCache::activeTexture(int unit) {
+	if (!change(getKey(ActiveTexture), unit)) return;
+	functions->glActiveTexture(GL_TEXTURE0 + unit);
+}
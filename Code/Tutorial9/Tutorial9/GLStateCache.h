@@ -0,0 +1,56 @@
+#pragma once
+#include <qhash.h>
+#include <qopenglbuffer.h>
+#include <qopengltexture.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+
+// a thin layer between the drawing code and OpenGL, which remembers the bound program, vertex array, buffers, textures, framebuffers and the enable bits
+// of the context, a call that would not change the state is dropped and counted, the state is forgotten at the start of a frame, since Qt may change it in between
+class GLStateCache {
+public:
+	GLStateCache();
+	void init();
+	void beginFrame();
+	void invalidate();
+
+	void useProgram(QOpenGLShaderProgram* program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBuffer(QOpenGLBuffer& buffer);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindTexture(int unit, GLenum target, GLuint texture);
+	void bindTexture(int unit, QOpenGLTexture* texture);
+	void bindFramebuffer(GLenum target, GLuint framebuffer);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void depthFunc(GLenum function);
+	void depthMask(bool enabled);
+	void colorMask(bool enabled);
+
+	QOpenGLFunctions_4_3_Compatibility* getFunctions() const;
+	int getIssuedCount() const;
+	int getElidedCount() const;
+
+	static GLStateCache* getDefault();
+
+private:
+	Q_DISABLE_COPY(GLStateCache)
+
+	enum State { Program, VertexArray, Buffer, IndexedBuffer, ActiveTexture, Texture, Framebuffer, Capability, DepthFunc, DepthMask, ColorMask };
+
+	static quint64 getKey(State state, GLenum target = 0, GLuint index = 0);
+	bool change(quint64 key, quint64 value);
+	void activeTexture(int unit);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+
+	// the known state of the context, a missing key is unknown and always set
+	QHash<quint64, quint64> states;
+
+	// the calls of the frame so far, and of the frame before
+	int issuedCount;
+	int elidedCount;
+	int lastIssuedCount;
+	int lastElidedCount;
+};
@@ -0,0 +1,492 @@
+#include "GeometryArena.h"
+#include "SimpleObject3D.h"
+#include "GLStateCache.h"
+#include <algorithm>
+
+/*
+Description:
+	This function is a constructor, no buffer is created before the first allocation;
+Input:
+	@ int blockVertices: the amount of vertices of a block;
+	@ int blockIndices: the amount of indices of a block;
+*/
+GeometryArena::GeometryArena(int blockVertices, int blockIndices) :
+	functions(0), blockVertices(blockVertices), blockIndices(blockIndices), allocationCount(0), movedBytes(0) {
+}
+
+/*
+Description:
+	This function is a destructor, the buffers are expected to be destroyed with their last allocation;
+Input:
+	@ void patameter: void;
+*/
+GeometryArena::~GeometryArena() {
+	for (int i = 0; i < blocks.size(); i++)
+		delete blocks[i].block;
+}
+
+/*
+Description:
+	This function is used to allocate the ranges of a mesh and upload its vertices and indices, a block that has the space only in pieces is compacted first,
+	a new block is only added when no block has enough space, a mesh larger than a block gets a block of its own, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ Allocation* allocation: the allocation to fill, which must stay at its address until it is freed, since a compaction moves its ranges;
+	@ const Vertex* vertices: the interleaved vertices;
+	@ const QVector3D* positions: the positions of the vertices for the position-only stream;
+	@ int vertexCount: the amount of vertices;
+	@ const GLuint* indices: the indices, relative to the first vertex of the mesh;
+	@ int indexCount: the amount of indices;
+Output:
+	@ bool returnValue: true if the mesh is allocated;
+*/
+bool GeometryArena::allocate(Allocation* allocation, const Vertex* vertices, const QVector3D* positions, int vertexCount, const GLuint* indices, int indexCount) {
+	if (functions == 0) {
+		functions = GLStateCache::getDefault()->getFunctions();
+		if (functions == 0) return false;
+	}
+
+	allocation->vertexCount = vertexCount;
+	allocation->indexCount = indexCount;
+
+	int block = -1;
+	for (int i = 0; i < blocks.size() && block < 0; i++) {
+		if (blocks[i].block != 0 && place(i, allocation)) block = i;
+	}
+
+	// the free space of a block may be enough in total but split into pieces too small
+	for (int i = 0; i < blocks.size() && block < 0; i++) {
+		const BlockState& state = blocks[i];
+		if (state.block == 0 || state.vertices.getFreeCount() < vertexCount || state.indices.getFreeCount() < indexCount) continue;
+		compact(i);
+		if (place(i, allocation)) block = i;
+	}
+
+	if (block < 0) {
+		block = addBlock(qMax(blockVertices, vertexCount), qMax(blockIndices, indexCount));
+		if (!place(block, allocation)) return false;
+	}
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	Block* buffers = blocks[block].block;
+	cache->bindBuffer(buffers->vertexBuffer);
+	buffers->vertexBuffer.write(allocation->baseVertex * sizeof(Vertex), vertices, vertexCount * sizeof(Vertex));
+	cache->bindBuffer(buffers->positionBuffer);
+	buffers->positionBuffer.write(allocation->baseVertex * sizeof(QVector3D), positions, vertexCount * sizeof(QVector3D));
+	cache->bindBuffer(buffers->indexBuffer);
+	buffers->indexBuffer.write(allocation->firstIndex * sizeof(GLuint), indices, indexCount * sizeof(GLuint));
+
+	blocks[block].allocations.append(allocation);
+	allocationCount++;
+	return true;
+}
+
+/*
+Description:
+	This function is used to give the ranges of a mesh back to its block, a block left without meshes is destroyed, an OpenGL context is supposed to be current;
+Input:
+	@ Allocation* allocation: the allocation;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::free(Allocation* allocation) {
+	if (allocation->block < 0 || allocation->block >= blocks.size()) return;
+
+	BlockState& state = blocks[allocation->block];
+	int index = state.allocations.indexOf(allocation);
+	if (index < 0) return;
+
+	state.allocations[index] = state.allocations.last();
+	state.allocations.removeLast();
+	state.vertices.free(allocation->baseVertex, allocation->vertexCount);
+	state.indices.free(allocation->firstIndex, allocation->indexCount);
+	allocation->block = -1;
+	allocationCount--;
+
+	if (state.allocations.isEmpty()) {
+		state.block->vertexBuffer.destroy();
+		state.block->positionBuffer.destroy();
+		state.block->indexBuffer.destroy();
+		GLStateCache::getDefault()->invalidate();
+		delete state.block;
+		state = BlockState();
+	}
+}
+
+/*
+Description:
+	This function is used to compact the blocks whose free space is split into pieces, the ranges are moved on the GPU and the allocations are updated, which is cheap when nothing is fragmented;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of blocks compacted;
+*/
+int GeometryArena::defragment() {
+	int compacted = 0;
+	for (int i = 0; i < blocks.size(); i++) {
+		if (blocks[i].block == 0 || !isFragmented(blocks[i])) continue;
+		compact(i);
+		compacted++;
+	}
+	return compacted;
+}
+
+/*
+Description:
+	This function is used to draw the triangles of a mesh from the bound buffers of its block, more than one instance needs an instanced draw call;
+Input:
+	@ const Allocation& allocation: the allocation of the mesh;
+	@ int instanceCount: the amount of instances;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::drawElements(const Allocation& allocation, int instanceCount) {
+	if (functions == 0) return;
+
+	const void* offset = reinterpret_cast<const void*>(allocation.firstIndex * sizeof(GLuint));
+	if (instanceCount == 1)
+		functions->glDrawElementsBaseVertex(GL_TRIANGLES, allocation.indexCount, GL_UNSIGNED_INT, offset, allocation.baseVertex);
+	else if (instanceCount > 1)
+		functions->glDrawElementsInstancedBaseVertex(GL_TRIANGLES, allocation.indexCount, GL_UNSIGNED_INT, offset, instanceCount, allocation.baseVertex);
+}
+
+/*
+Description:
+	This function is used to get the buffers of a block;
+Input:
+	@ int index: the block index of an allocation;
+Output:
+	@ Block* returnValue: the block, 0 for an index without a block;
+*/
+GeometryArena::Block* GeometryArena::getBlock(int index) const {
+	if (index < 0 || index >= blocks.size()) return 0;
+	return blocks[index].block;
+}
+
+/*
+Description:
+	This function is used to get the amount of blocks, which is the amount of buffers of each stream;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of blocks;
+*/
+int GeometryArena::getBlockCount() const {
+	int count = 0;
+	for (int i = 0; i < blocks.size(); i++) {
+		if (blocks[i].block != 0) count++;
+	}
+	return count;
+}
+
+/*
+Description:
+	This function is used to get the amount of meshes allocated;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of allocations;
+*/
+int GeometryArena::getAllocationCount() const {
+	return allocationCount;
+}
+
+/*
+Description:
+	This function is used to measure the fragmentation of the vertex ranges, which is the share of the free vertices outside of the largest free range of their block;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the fragmentation from 0 to 1;
+*/
+float GeometryArena::getFragmentation() const {
+	qint64 free = 0, largest = 0;
+	for (int i = 0; i < blocks.size(); i++) {
+		if (blocks[i].block == 0) continue;
+		free += blocks[i].vertices.getFreeCount();
+		largest += blocks[i].vertices.getLargestRange();
+	}
+	return free > 0 ? 1.0f - float(largest) / float(free) : 0.0f;
+}
+
+/*
+Description:
+	This function is used to get the amount of bytes moved by the compactions so far;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 GeometryArena::getMovedBytes() const {
+	return movedBytes;
+}
+
+/*
+Description:
+	This function is used to create the buffers of a block, an empty slot left by a destroyed block is reused;
+Input:
+	@ int vertexCapacity: the amount of vertices;
+	@ int indexCapacity: the amount of indices;
+Output:
+	@ int returnValue: the block index;
+*/
+int GeometryArena::addBlock(int vertexCapacity, int indexCapacity) {
+	int index = 0;
+	while (index < blocks.size() && blocks[index].block != 0)
+		index++;
+	if (index == blocks.size()) blocks.append(BlockState());
+
+	Block* block = new Block;
+	block->vertexCapacity = vertexCapacity;
+	block->indexCapacity = indexCapacity;
+
+	block->vertexBuffer.create();
+	GLStateCache::getDefault()->bindBuffer(block->vertexBuffer);
+	block->vertexBuffer.allocate(vertexCapacity * sizeof(Vertex));
+
+	block->positionBuffer.create();
+	GLStateCache::getDefault()->bindBuffer(block->positionBuffer);
+	block->positionBuffer.allocate(vertexCapacity * sizeof(QVector3D));
+
+	block->indexBuffer.create();
+	GLStateCache::getDefault()->bindBuffer(block->indexBuffer);
+	block->indexBuffer.allocate(indexCapacity * sizeof(GLuint));
+
+	BlockState& state = blocks[index];
+	state.block = block;
+	state.vertices.reset(vertexCapacity, 0);
+	state.indices.reset(indexCapacity, 0);
+	return index;
+}
+
+/*
+Description:
+	This function is used to take the ranges of an allocation from the free lists of a block, nothing is taken unless both ranges fit;
+Input:
+	@ int block: the block index;
+	@ Allocation* allocation: the allocation holding the amount of vertices and indices;
+Output:
+	@ bool returnValue: true if both ranges are taken;
+*/
+bool GeometryArena::place(int block, Allocation* allocation) {
+	BlockState& state = blocks[block];
+	int baseVertex = state.vertices.allocate(allocation->vertexCount);
+	if (baseVertex < 0) return false;
+
+	int firstIndex = state.indices.allocate(allocation->indexCount);
+	if (firstIndex < 0) {
+		state.vertices.free(baseVertex, allocation->vertexCount);
+		return false;
+	}
+
+	allocation->block = block;
+	allocation->baseVertex = baseVertex;
+	allocation->firstIndex = firstIndex;
+	return true;
+}
+
+/*
+Description:
+	This function is used to check whether the free space of a block is split into pieces, which is when its largest free range holds less than half of it;
+Input:
+	@ const BlockState& state: the block;
+Output:
+	@ bool returnValue: true if the block is worth compacting;
+*/
+bool GeometryArena::isFragmented(const BlockState& state) const {
+	if (state.vertices.getRangeCount() > 1 && 2 * state.vertices.getLargestRange() < state.vertices.getFreeCount()) return true;
+	if (state.indices.getRangeCount() > 1 && 2 * state.indices.getLargestRange() < state.indices.getFreeCount()) return true;
+	return false;
+}
+
+/*
+Description:
+	This function is used to move the meshes of a block to its start, the ranges are copied into new buffers on the GPU, so that the free space becomes a single range at the end;
+Input:
+	@ int block: the block index;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::compact(int block) {
+	BlockState& state = blocks[block];
+	Block* source = state.block;
+
+	Block* target = new Block;
+	target->vertexCapacity = source->vertexCapacity;
+	target->indexCapacity = source->indexCapacity;
+	QOpenGLBuffer* buffers[] = { &target->vertexBuffer, &target->positionBuffer, &target->indexBuffer };
+	int bytes[] = { (int)(target->vertexCapacity * sizeof(Vertex)), (int)(target->vertexCapacity * sizeof(QVector3D)), (int)(target->indexCapacity * sizeof(GLuint)) };
+	for (int i = 0; i < 3; i++) {
+		buffers[i]->create();
+		GLStateCache::getDefault()->bindBuffer(*buffers[i]);
+		buffers[i]->allocate(bytes[i]);
+	}
+
+	// the meshes keep their order, so a block compacted again moves nothing
+	QVector<Allocation*> allocations = state.allocations;
+	std::sort(allocations.begin(), allocations.end(), [](const Allocation* a, const Allocation* b) { return a->baseVertex < b->baseVertex; });
+	int vertexCount = 0;
+	for (int i = 0; i < allocations.size(); i++) {
+		Allocation* allocation = allocations[i];
+		copyRange(source->vertexBuffer, target->vertexBuffer, allocation->baseVertex * sizeof(Vertex), vertexCount * sizeof(Vertex), allocation->vertexCount * sizeof(Vertex));
+		copyRange(source->positionBuffer, target->positionBuffer, allocation->baseVertex * sizeof(QVector3D), vertexCount * sizeof(QVector3D), allocation->vertexCount * sizeof(QVector3D));
+		allocation->baseVertex = vertexCount;
+		vertexCount += allocation->vertexCount;
+	}
+
+	std::sort(allocations.begin(), allocations.end(), [](const Allocation* a, const Allocation* b) { return a->firstIndex < b->firstIndex; });
+	int indexCount = 0;
+	for (int i = 0; i < allocations.size(); i++) {
+		Allocation* allocation = allocations[i];
+		copyRange(source->indexBuffer, target->indexBuffer, allocation->firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), allocation->indexCount * sizeof(GLuint));
+		allocation->firstIndex = indexCount;
+		indexCount += allocation->indexCount;
+	}
+
+	state.vertices.reset(target->vertexCapacity, vertexCount);
+	state.indices.reset(target->indexCapacity, indexCount);
+
+	source->vertexBuffer.destroy();
+	source->positionBuffer.destroy();
+	source->indexBuffer.destroy();
+	GLStateCache::getDefault()->invalidate();
+	delete source;
+	state.block = target;
+}
+
+/*
+Description:
+	This function is used to copy a range of bytes between two buffers on the GPU;
+Input:
+	@ QOpenGLBuffer& source: the buffer read;
+	@ QOpenGLBuffer& target: the buffer written;
+	@ int sourceOffset: the offset in the source in bytes;
+	@ int targetOffset: the offset in the target in bytes;
+	@ int bytes: the amount of bytes;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::copyRange(QOpenGLBuffer& source, QOpenGLBuffer& target, int sourceOffset, int targetOffset, int bytes) {
+	if (bytes <= 0) return;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(GL_COPY_READ_BUFFER, source.bufferId());
+	cache->bindBuffer(GL_COPY_WRITE_BUFFER, target.bufferId());
+	functions->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, targetOffset, bytes);
+	movedBytes += bytes;
+}
+
+/*
+Description:
+	This function is used to set the free list to a single range behind the used part of a buffer;
+Input:
+	@ int capacity: the size of the buffer in elements;
+	@ int used: the amount of elements in use from the start;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::FreeList::reset(int capacity, int used) {
+	ranges.resize(0);
+	if (used < capacity) {
+		Range range = { used, capacity - used };
+		ranges.append(range);
+	}
+}
+
+/*
+Description:
+	This function is used to take a range from the first free range large enough;
+Input:
+	@ int count: the amount of elements;
+Output:
+	@ int returnValue: the offset of the range, -1 if no free range is large enough;
+*/
+int GeometryArena::FreeList::allocate(int count) {
+	if (count <= 0) return 0;
+
+	for (int i = 0; i < ranges.size(); i++) {
+		Range& range = ranges[i];
+		if (range.count < count) continue;
+
+		int offset = range.offset;
+		range.offset += count;
+		range.count -= count;
+		if (range.count == 0) ranges.remove(i);
+		return offset;
+	}
+	return -1;
+}
+
+/*
+Description:
+	This function is used to give a range back, it is merged with the free ranges it touches;
+Input:
+	@ int offset: the offset of the range;
+	@ int count: the amount of elements;
+Output:
+	@ void returnValue: void;
+*/
+void GeometryArena::FreeList::free(int offset, int count) {
+	if (count <= 0) return;
+
+	int index = std::lower_bound(ranges.begin(), ranges.end(), offset, [](const Range& range, int offset) { return range.offset < offset; }) - ranges.begin();
+
+	bool mergePrevious = index > 0 && ranges[index - 1].offset + ranges[index - 1].count == offset;
+	bool mergeNext = index < ranges.size() && offset + count == ranges[index].offset;
+
+	if (mergePrevious && mergeNext) {
+		ranges[index - 1].count += count + ranges[index].count;
+		ranges.remove(index);
+	}
+	else if (mergePrevious)
+		ranges[index - 1].count += count;
+	else if (mergeNext) {
+		ranges[index].offset = offset;
+		ranges[index].count += count;
+	}
+	else {
+		Range range = { offset, count };
+		ranges.insert(index, range);
+	}
+}
+
+/*
+Description:
+	This function is used to get the amount of free elements;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of elements;
+*/
+int GeometryArena::FreeList::getFreeCount() const {
+	int count = 0;
+	for (int i = 0; i < ranges.size(); i++)
+		count += ranges[i].count;
+	return count;
+}
+
+/*
+Description:
+	This function is used to get the size of the largest free range, which is the largest allocation that fits;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of elements;
+*/
+int GeometryArena::FreeList::getLargestRange() const {
+	int largest = 0;
+	for (int i = 0; i < ranges.size(); i++)
+		largest = qMax(largest, ranges[i].count);
+	return largest;
+}
+
+/*
+Description:
+	This function is used to get the amount of free ranges;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of ranges;
+*/
+int GeometryArena::FreeList::getRangeCount() const {
+	return ranges.size();
+}
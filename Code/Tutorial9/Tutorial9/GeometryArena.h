@@ -0,0 +1,88 @@
+#pragma once
+#include <qvector.h>
+#include <qvector3d.h>
+#include <qopenglbuffer.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+
+struct Vertex;
+
+// carves the vertex and index ranges of all the meshes out of a few large buffers, so that meshes share their buffers and are drawn with a base vertex,
+// the free ranges of a block are kept in a sorted free list, neighbouring ranges are merged when freed, and a fragmented block is compacted on the GPU
+class GeometryArena {
+public:
+	// the ranges of one mesh, the indices are relative to its first vertex
+	struct Allocation {
+		Allocation() : block(-1), baseVertex(0), vertexCount(0), firstIndex(0), indexCount(0) {};
+		int block;
+		int baseVertex;
+		int vertexCount;
+		int firstIndex;
+		int indexCount;
+	};
+
+	// the buffers shared by the meshes of a block, the position-only stream has the same vertex ranges as the interleaved one
+	struct Block {
+		Block() : indexBuffer(QOpenGLBuffer::IndexBuffer), vertexCapacity(0), indexCapacity(0) {};
+		QOpenGLBuffer vertexBuffer;
+		QOpenGLBuffer positionBuffer;
+		QOpenGLBuffer indexBuffer;
+		int vertexCapacity;
+		int indexCapacity;
+	};
+
+	GeometryArena(int blockVertices = 256 * 1024, int blockIndices = 1024 * 1024);
+	~GeometryArena();
+	bool allocate(Allocation* allocation, const Vertex* vertices, const QVector3D* positions, int vertexCount, const GLuint* indices, int indexCount);
+	void free(Allocation* allocation);
+	int defragment();
+	void drawElements(const Allocation& allocation, int instanceCount);
+	Block* getBlock(int index) const;
+	int getBlockCount() const;
+	int getAllocationCount() const;
+	float getFragmentation() const;
+	qint64 getMovedBytes() const;
+
+private:
+	Q_DISABLE_COPY(GeometryArena)
+
+	// the free ranges of a buffer, sorted by offset, no two ranges touch
+	class FreeList {
+	public:
+		void reset(int capacity, int used);
+		int allocate(int count);
+		void free(int offset, int count);
+		int getFreeCount() const;
+		int getLargestRange() const;
+		int getRangeCount() const;
+
+	private:
+		struct Range {
+			int offset;
+			int count;
+		};
+		QVector<Range> ranges;
+	};
+
+	struct BlockState {
+		BlockState() : block(0) {};
+		Block* block;
+		FreeList vertices;
+		FreeList indices;
+		QVector<Allocation*> allocations;
+	};
+
+	int addBlock(int vertexCapacity, int indexCapacity);
+	bool place(int block, Allocation* allocation);
+	bool isFragmented(const BlockState& state) const;
+	void compact(int block);
+	void copyRange(QOpenGLBuffer& source, QOpenGLBuffer& target, int sourceOffset, int targetOffset, int bytes);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+
+	// a destroyed block leaves an empty slot, so the block index of the other allocations stays valid
+	QVector<BlockState> blocks;
+	int blockVertices;
+	int blockIndices;
+	int allocationCount;
+	qint64 movedBytes;
+};
@@ -1,4 +1,5 @@
 #include "Group3D.h"
+#include "CommandBuffer.h"
 
 /*
 Description:
@@ -7,95 +8,66 @@ Input:
 	@ void parameter: void;
 */
 Group3D::Group3D() {
-	this->s = 1.0;
 }
 
 /*
 Description:
-	This function is used to rotate all the objects in a group, which calls Object3D::rotate(const QQuaternion&) for object rotation;
+	This function is used to rotate the group, the world matrices of the objects in the group are updated lazily when they are drawn;
 Input:
 	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
 Output:
 	@ void returnValue: void;
 */
 void Group3D::rotate(const QQuaternion& r) {
-	this->r = r * this->r;
-
-	QMatrix4x4 localMatrix;
-	localMatrix.setToIdentity();
-	localMatrix.translate(t);
-	localMatrix.rotate(r);
-	localMatrix.scale(s);
-	localMatrix = g * localMatrix;
-
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->setGlobalTransform(localMatrix);
+	transform.rotate(r);
 }
 
 /*
 Description:
-	This function is used to translate all the objects in a group, which calls Object3D::translate(const QVector3D&) for object translation;
+	This function is used to translate the group, the world matrices of the objects in the group are updated lazily when they are drawn;
 Input:
 	@ const QVector3D& t: a translation vector;
 Output:
 	@ void returnValue: void;
 */
 void Group3D::translate(const QVector3D& t) {
-	this->t += t;
-
-	QMatrix4x4 localMatrix;
-	localMatrix.setToIdentity();
-	localMatrix.translate(t);
-	localMatrix.rotate(r);
-	localMatrix.scale(s);
-	localMatrix = g * localMatrix;
-
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->setGlobalTransform(localMatrix);
+	transform.translate(t);
 }
 
 /*
 Description:
-	This function is used to scale all the objects in a group, which calls Object3D::scale(const float&) for object scaling;
+	This function is used to scale the group, the world matrices of the objects in the group are updated lazily when they are drawn;
 Input:
 	@ const float& s: a scalar;
 Output:
 	@ void returnValue: void;
 */
 void Group3D::scale(const float& s) {
-	this->s *= s;
-
-	QMatrix4x4 localMatrix;
-	localMatrix.setToIdentity();
-	localMatrix.translate(t);
-	localMatrix.rotate(r);
-	localMatrix.scale(s);
-	localMatrix = g * localMatrix;
-
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->setGlobalTransform(localMatrix);
+	transform.scale(s);
 }
 
 /*
 Description:
-	This function is used to set the global transform for all the objects in a group, which calls Object3D::setGlobalTransform(const QMatrix4x4&) for setting global transform;
+	This function is used to set the global transform for the group, which is used while the group has no parent;
 Input:
 	@ const QMatrix4x4& g: a global transformation;
 Output:
 	@ void returnValue: void;
 */
 void Group3D::setGlobalTransform(const QMatrix4x4& g) {
-	this->g = g;
-
-	QMatrix4x4 localMatrix;
-	localMatrix.setToIdentity();
-	localMatrix.translate(t);
-	localMatrix.rotate(r);
-	localMatrix.scale(s);
-	localMatrix = g * localMatrix;
+	transform.setGlobalTransform(g);
+}
 
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->setGlobalTransform(localMatrix);
+/*
+Description:
+	This function is used to attach the group to the transform of its parent, so that its world matrix follows the parent;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::setParentTransform(Transform3D* parent) {
+	transform.setParent(parent);
 }
 
 /*
@@ -115,23 +87,22 @@ void Group3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functi
 
 /*
 Description:
-	This function is used to add object into the group list. An initialization of its position is necessary;
+	This function is used to add object into the group list, the object is attached to the transform of the group, an object already in the group is not added again;
 Input:
 	@ Transformational * object: a given object;
 Output:
-	@ void returnValue: void;
+	@ SlotHandle returnValue: the handle of the object in the group;
 */
-void Group3D::addObject(Transformational* object) {
-	objects.append(object);
+SlotHandle Group3D::addObject(Transformational* object) {
+	if (!object) return SlotHandle();
 
-	QMatrix4x4 localMatrix;
-	localMatrix.setToIdentity();
-	localMatrix.translate(t);
-	localMatrix.rotate(r);
-	localMatrix.scale(s);
-	localMatrix = g * localMatrix;
+	QHash<Transformational*, SlotHandle>::const_iterator found = objectHandles.constFind(object);
+	if (found != objectHandles.constEnd()) return found.value();
 
-	objects[objects.size() - 1]->setGlobalTransform(localMatrix);
+	SlotHandle handle = objects.insert(object);
+	objectHandles.insert(object, handle);
+	object->setParentTransform(&transform);
+	return handle;
 }
 
 /*
@@ -143,17 +114,139 @@ Output:
 	@ void returnValue: void;
 */
 void Group3D::delObject(Transformational* object) {
-	objects.removeAll(object);
+	QHash<Transformational*, SlotHandle>::iterator found = objectHandles.find(object);
+	if (found == objectHandles.end()) return;
+
+	objects.remove(found.value());
+	objectHandles.erase(found);
+	object->setParentTransform(0);
 }
 
 /*
 Description:
-	This function is used to delete an object by its index;
+	This function is used to delete an object by its index, the last object takes the index of the deleted one;
 Input:
 	@ const int& index: an given index of objects;
 Output:
 	@ void returnValue: void;
 */
 void Group3D::delObject(const int& index) {
-	objects.remove(index);
+	if (index < 0 || index >= objects.size()) return;
+	delObject(objects[index]);
+}
+
+/*
+Description:
+	This function is used to delete an object by its handle, a stale handle is ignored;
+Input:
+	@ const SlotHandle& handle: the handle of the object;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::delObject(const SlotHandle& handle) {
+	Transformational* const* object = objects.get(handle);
+	if (object) delObject(*object);
+}
+
+/*
+Description:
+	This function is used to get an object by its handle;
+Input:
+	@ const SlotHandle& handle: the handle of the object;
+Output:
+	@ Transformational* returnValue: the object, 0 if the handle is stale;
+*/
+Transformational* Group3D::getObject(const SlotHandle& handle) const {
+	Transformational* const* object = objects.get(handle);
+	return object ? *object : 0;
+}
+
+/*
+Description:
+	This function is used to get total amount of objects in the group;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the total amount of objects;
+*/
+int Group3D::getCount() const {
+	return objects.size();
+}
+
+/*
+Description:
+	This function is used to draw the depth of all the objects in a group, which calls Object3D::drawDepth(QOpenGLShaderProgram*, QOpenGLFunctions*);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	for (int i = 0; i < objects.size(); i++) {
+		objects[i]->drawDepth(shaderProgram, functions);
+	}
+}
+
+/*
+Description:
+	This function is used to draw a number of instances of all the objects in a group at once, which calls Transformational::drawInstanced(QOpenGLShaderProgram*, QOpenGLFunctions*, int);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	for (int i = 0; i < objects.size(); i++) {
+		objects[i]->drawInstanced(shaderProgram, functions, instanceCount);
+	}
+}
+
+/*
+Description:
+	This function is used to draw the depth of a number of instances of all the objects in a group at once, which calls Transformational::drawDepthInstanced(QOpenGLShaderProgram*, QOpenGLFunctions*, int);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	for (int i = 0; i < objects.size(); i++) {
+		objects[i]->drawDepthInstanced(shaderProgram, functions, instanceCount);
+	}
+}
+
+/*
+Description:
+	This function is used to record the draws of all the objects in a group, the objects are recorded in parallel on the job system of the command buffer;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::record(CommandBuffer* commands) {
+	commands->getJobSystem()->parallelFor(0, objects.size(), 1, [this, commands](int first, int last) {
+		for (int i = first; i < last; i++)
+			objects[i]->record(commands);
+	});
+}
+
+/*
+Description:
+	This function is used to record the draws of a number of instances of all the objects in a group, the objects are recorded in parallel on the job system of the command buffer;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+	@ Prefab3D* prefab: the prefab whose instance matrices are bound;
+Output:
+	@ void returnValue: void;
+*/
+void Group3D::recordInstanced(CommandBuffer* commands, Prefab3D* prefab) {
+	commands->getJobSystem()->parallelFor(0, objects.size(), 1, [this, commands, prefab](int first, int last) {
+		for (int i = first; i < last; i++)
+			objects[i]->recordInstanced(commands, prefab);
+	});
 }
@@ -1,26 +1,37 @@
 #pragma once
 #include "Transformational.h"
 #include "SimpleObject3D.h"
+#include "SlotMap.h"
+#include "ObjectPool.h"
+#include <qhash.h>
 
-class Group3D : public Transformational {
+class Group3D : public Transformational, public PoolAllocated<Group3D> {
 public:
 	Group3D();
 	void rotate(const QQuaternion& r);
 	void translate(const QVector3D& t);
 	void scale(const float& s);
 	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
 	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void record(CommandBuffer* commands);
+	void recordInstanced(CommandBuffer* commands, Prefab3D* prefab);
 
-	void addObject(Transformational* object);
+	SlotHandle addObject(Transformational* object);
 	void delObject(Transformational* object);
 	void delObject(const int& index);
+	void delObject(const SlotHandle& handle);
+	Transformational* getObject(const SlotHandle& handle) const;
+	int getCount() const;
 
 private:
-	QQuaternion r;
-	QVector3D t;
-	float s;
-	QMatrix4x4 g;
+	Transform3D transform;
 
-	QVector<Transformational*> objects;
+	// the group does not own its objects, the handle of each object is kept so that it is removed by its pointer in constant time
+	SlotMap<Transformational*> objects;
+	QHash<Transformational*, SlotHandle> objectHandles;
 };
 
@@ -0,0 +1,20 @@
+// one object of the GPU-driven path, which matches IndirectRenderer::Object (std430)
+struct IndirectObject {
+	mat4 model;
+	mat4 instance;
+	mat4 animation;
+	// the bounding sphere in object space, (center, radius), grown by the reach of the animation
+	vec4 bounds;
+	// the material, the shinnes is kept in the w component of the diffuse color
+	vec4 diffuseColor;
+	vec4 ambienceColor;
+	vec4 specularColor;
+	// (index count, first index, base vertex, transform slot), the model matrix is used when the slot is -1
+	ivec4 mesh;
+	// (texture layer, 0, 0, 0), the layer of the diffuse map when the diffuse maps are packed into texture arrays
+	ivec4 texture;
+};
+
+layout(std430, binding = 0) readonly buffer IndirectObjects {
+	IndirectObject objects[];
+};
\ No newline at end of file
@@ -0,0 +1,559 @@
+#include "IndirectRenderer.h"
+#include "GLStateCache.h"
+#include "SimpleObject3D.h"
+#include "ShaderLibrary.h"
+#include "Prefab3D.h"
+#include <algorithm>
+#include <string.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+IndirectRenderer::IndirectRenderer() :
+	cullShader(0), pyramidShader(0), functions(0), uploadedCount(0), objectCapacity(0), drawCallCount(0),
+	occlusionCulling(true), depthValid(false), depthWidth(0), depthHeight(0), pyramidLevels(0), capturedWidth(0), capturedHeight(0), capturedLevels(0), depthFramebuffer(0), depthTexture(0), pyramidTexture(0) {
+}
+
+/*
+Description:
+	This function is a destructor, an OpenGL context is supposed to be current;
+Input:
+	@ void patameter: void;
+*/
+IndirectRenderer::~IndirectRenderer() {
+	if (functions != 0) {
+		functions->glDeleteFramebuffers(1, &depthFramebuffer);
+		functions->glDeleteTextures(1, &depthTexture);
+		functions->glDeleteTextures(1, &pyramidTexture);
+	}
+
+	QOpenGLBuffer* buffers[] = { &objectBuffer, &commandBuffer, &objectIndexBuffer };
+	for (int i = 0; i < 3; i++) {
+		if (buffers[i]->isCreated())
+			buffers[i]->destroy();
+	}
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to create the object and command buffers, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ QOpenGLShaderProgram* cullShader: the compute shader culling the objects, see Cull.csh;
+	@ QOpenGLShaderProgram* pyramidShader: the compute shader building the depth pyramid, see DepthPyramid.csh;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::init(QOpenGLShaderProgram* cullShader, QOpenGLShaderProgram* pyramidShader) {
+	this->cullShader = cullShader;
+	this->pyramidShader = pyramidShader;
+
+	functions = GLStateCache::getDefault()->getFunctions();
+	if (functions == 0) return;
+
+	objectBuffer.create();
+	objectBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	commandBuffer.create();
+	commandBuffer.setUsagePattern(QOpenGLBuffer::DynamicCopy);
+	objectIndexBuffer.create();
+}
+
+/*
+Description:
+	This function is used to gather the objects of a frame from the merged commands of the color pass, the instances of a prefab become objects of their own,
+	the objects are grouped into buckets of equal shader variant, texture and geometry block, diffuse maps packed into one texture array share a bucket, only the objects changed since the last frame are uploaded;
+Input:
+	@ const CommandBuffer* commands: the merged commands of the frame;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::update(const CommandBuffer* commands) {
+	drawCallCount = 0;
+	uploadedCount = 0;
+	if (functions == 0) return;
+
+	const QVector<DrawCommand>& list = commands->getCommands();
+
+	// the bucket of every command, and the amount of objects of every bucket,
+	// the key packs the texture id, the feature bits, the texture array and the geometry block into one integer, so no string is built per command
+	QHash<quint64, int> bucketIndices;
+	QVector<int> commandBuckets(list.size(), -1);
+	buckets.resize(0);
+	for (int i = 0; i < list.size(); i++) {
+		const DrawCommand& command = list[i];
+		if (command.pass != DrawCommand::ColorPass) continue;
+
+		int block = command.geometry->allocation.block;
+		quint32 features = command.material->getShaderFeatureMask();
+		int array = command.textureArray + 1;
+		quint64 textureId = command.texture != 0 ? command.texture->textureId() : 0;
+		quint64 key = (textureId << 32) | (quint64(features) << 24) | (quint64(array) << 16) | quint64(block);
+
+		// a value too large for its bits would share a key with another bucket, such a command searches the buckets instead
+		bool packed = features <= 0xff && array >= 0 && array <= 0xff && block >= 0 && block <= 0xffff;
+		int bucket = -1;
+		if (packed)
+			bucket = bucketIndices.value(key, -1);
+		else {
+			for (int b = 0; b < buckets.size() && bucket < 0; b++) {
+				const Bucket& other = buckets[b];
+				if (other.texture == command.texture && other.featureMask == features && other.textureArray == command.textureArray && other.block == block)
+					bucket = b;
+			}
+		}
+		if (bucket < 0) {
+			Bucket created = { command.material->getShaderFeatures(), features, command.texture, command.textureArray, block, 0, 0 };
+			bucket = buckets.size();
+			buckets.append(created);
+			if (packed) bucketIndices.insert(key, bucket);
+		}
+		commandBuckets[i] = bucket;
+		buckets[bucket].count += command.prefab != 0 ? command.prefab->getInstanceMatrices().size() : 1;
+	}
+
+	// the buckets of a block are made consecutive, so the depth prepass draws each block with one call
+	QVector<int> order(buckets.size());
+	for (int b = 0; b < buckets.size(); b++)
+		order[b] = b;
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return buckets[a].block < buckets[b].block; });
+
+	QVector<Bucket> sorted(buckets.size());
+	QVector<int> remap(buckets.size());
+	for (int b = 0; b < order.size(); b++) {
+		sorted[b] = buckets[order[b]];
+		remap[order[b]] = b;
+	}
+	buckets = sorted;
+	for (int i = 0; i < commandBuckets.size(); i++) {
+		if (commandBuckets[i] >= 0) commandBuckets[i] = remap[commandBuckets[i]];
+	}
+
+	int objectCount = 0;
+	for (int b = 0; b < buckets.size(); b++) {
+		buckets[b].first = objectCount;
+		objectCount += buckets[b].count;
+		buckets[b].count = 0;
+	}
+	objects.resize(objectCount);
+
+	for (int i = 0; i < list.size(); i++) {
+		if (commandBuckets[i] < 0) continue;
+		const DrawCommand& command = list[i];
+		Bucket& bucket = buckets[commandBuckets[i]];
+		const GeometryArena::Allocation& mesh = command.geometry->allocation;
+
+		// the animation rotates the object around its origin, the orbit and the oscillation move it by at most their radius and amplitude
+		QVector4D extent = command.animation.column(3);
+		float reach = qAbs(extent.x()) + qAbs(extent.y()) * command.animation.column(2).toVector3D().length();
+
+		Object object;
+		object.model = SimdMath::fromQMatrix(command.modelMatrix);
+		object.instance = SimdMath::identity();
+		object.animation = SimdMath::fromQMatrix(command.animation);
+		object.bounds[0] = object.bounds[1] = object.bounds[2] = 0.0f;
+		object.bounds[3] = command.geometry->radius + reach;
+		for (int c = 0; c < 3; c++) {
+			object.diffuseColor[c] = command.diffuseColor[c];
+			object.ambienceColor[c] = command.ambienceColor[c];
+			object.specularColor[c] = command.specularColor[c];
+		}
+		object.diffuseColor[3] = command.shinnes;
+		object.ambienceColor[3] = object.specularColor[3] = 0.0f;
+		object.mesh[0] = mesh.indexCount;
+		object.mesh[1] = mesh.firstIndex;
+		object.mesh[2] = mesh.baseVertex;
+		object.mesh[3] = command.transformIndex;
+		object.texture[0] = command.textureLayer;
+		object.texture[1] = object.texture[2] = object.texture[3] = 0;
+
+		if (command.prefab == 0) {
+			objects[bucket.first + bucket.count++] = object;
+			continue;
+		}
+		const QVector<Matrix4>& instances = command.prefab->getInstanceMatrices();
+		for (int k = 0; k < instances.size(); k++) {
+			object.instance = instances[k];
+			objects[bucket.first + bucket.count++] = object;
+		}
+	}
+
+	// the draw commands are written by the culling, the object indices are the identity, read through the base instance of each draw
+	GLStateCache* cache = GLStateCache::getDefault();
+	if (objectCount > objectCapacity) {
+		objectCapacity = qMax(objectCount, 2 * objectCapacity);
+		QVector<GLint> identity(objectCapacity);
+		for (int i = 0; i < objectCapacity; i++)
+			identity[i] = i;
+
+		cache->bindBuffer(objectBuffer);
+		objectBuffer.allocate(objectCapacity * sizeof(Object));
+		cache->bindBuffer(commandBuffer);
+		commandBuffer.allocate(objectCapacity * sizeof(DrawElementsIndirectCommand));
+		cache->bindBuffer(objectIndexBuffer);
+		objectIndexBuffer.allocate(identity.constData(), identity.size() * sizeof(GLint));
+		uploadedObjects.clear();
+	}
+
+	// most objects are the same from frame to frame, only the runs that changed are uploaded, a short gap is cheaper to upload again than to issue another call
+	bool all = uploadedObjects.isEmpty();
+	if (all) uploadedObjects.resize(objectCapacity);
+	const int maxGap = 4;
+	int runBegin = -1;
+	int runEnd = -1;
+	cache->bindBuffer(objectBuffer);
+	for (int i = 0; i <= objectCount; i++) {
+		bool changed = i < objectCount && (all || memcmp(uploadedObjects.constData() + i, objects.constData() + i, sizeof(Object)) != 0);
+		if (runBegin >= 0 && (i == objectCount || (changed && i - runEnd > maxGap))) {
+			memcpy(uploadedObjects.data() + runBegin, objects.constData() + runBegin, (runEnd - runBegin) * sizeof(Object));
+			objectBuffer.write(runBegin * sizeof(Object), objects.constData() + runBegin, (runEnd - runBegin) * sizeof(Object));
+			runBegin = -1;
+		}
+		if (!changed) continue;
+
+		uploadedCount++;
+		if (runBegin < 0)
+			runBegin = i;
+		runEnd = i + 1;
+	}
+}
+
+/*
+Description:
+	This function is used to cull the objects on the GPU and write their draw commands, an object outside of the frustum, or behind the depth of the previous frame, draws no instance;
+Input:
+	@ const QMatrix4x4& viewProjectionMatrix: the view projection matrix of the frame;
+	@ TransformBuffer* transformBuffer: the world matrices of the objects whose transform is resolved on the GPU;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::cull(const QMatrix4x4& viewProjectionMatrix, TransformBuffer* transformBuffer) {
+	if (functions == 0 || cullShader == 0 || objects.isEmpty()) return;
+
+	// the planes of the frustum from the rows of the view projection matrix, normalized so that the distance to a sphere center is in world units
+	QVector4D planes[6];
+	QVector4D w = viewProjectionMatrix.row(3);
+	for (int i = 0; i < 3; i++) {
+		planes[2 * i] = w + viewProjectionMatrix.row(i);
+		planes[2 * i + 1] = w - viewProjectionMatrix.row(i);
+	}
+	for (int i = 0; i < 6; i++)
+		planes[i] = planes[i] / planes[i].toVector3D().length();
+
+	bool occlusion = occlusionCulling && depthValid;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->useProgram(cullShader);
+	cullShader->setUniformValue("u_objectCount", objects.size());
+	cullShader->setUniformValueArray("u_frustumPlanes", planes, 6);
+	transformBuffer->bind(cullShader);
+
+	cache->bindTexture(textureUnit, GL_TEXTURE_2D, occlusion ? pyramidTexture : 0);
+	cullShader->setUniformValue("u_depthPyramid", textureUnit);
+	cullShader->setUniformValue("u_occlusionCulling", occlusion ? 1 : 0);
+	cullShader->setUniformValue("u_previousViewProjectionMatrix", previousViewProjectionMatrix);
+	functions->glUniform2i(cullShader->uniformLocation("u_pyramidSize"), capturedWidth, capturedHeight);
+	cullShader->setUniformValue("u_pyramidLevels", capturedLevels);
+
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer.bufferId());
+	functions->glDispatchCompute((objects.size() + 63) / 64, 1, 1);
+
+	// the commands are read as indirect draws, the objects by the vertex shader
+	functions->glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/*
+Description:
+	This function is used to draw the culled objects, the depth prepass draws the buckets of each geometry block with one call, the color pass draws each bucket matching the variant of the shader program with one call;
+Input:
+	@ int pass: the pass, see DrawCommand::Pass;
+	@ QOpenGLShaderProgram* shaderProgram: the bound shader program built from Indirect.vsh;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::draw(int pass, QOpenGLShaderProgram* shaderProgram) {
+	if (functions == 0 || objects.isEmpty()) return;
+	bool colorPass = pass == DrawCommand::ColorPass;
+
+	// one index per instance, a draw of one instance reads the index at its base instance
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(objectIndexBuffer);
+	int objectLoc = shaderProgram->attributeLocation("a_objectIndex");
+	if (objectLoc >= 0) {
+		functions->glEnableVertexAttribArray(objectLoc);
+		functions->glVertexAttribIPointer(objectLoc, 1, GL_INT, 0, 0);
+		functions->glVertexAttribDivisor(objectLoc, 1);
+	}
+
+	cache->bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer.bufferId());
+	if (colorPass) shaderProgram->setUniformValue("u_texture", 0);
+
+	GeometryArena* arena = ResourceCache::getDefault()->getGeometryArena();
+	GeometryArena::Block* boundBlock = 0;
+	for (int b = 0; b < buckets.size(); b++) {
+		const Bucket& bucket = buckets[b];
+		if (colorPass && !ShaderLibrary::isCompatible(shaderProgram, bucket.features)) continue;
+
+		GeometryArena::Block* block = arena->getBlock(bucket.block);
+		if (block != boundBlock) {
+			bindBlock(block, shaderProgram);
+			boundBlock = block;
+		}
+
+		if (!colorPass) {
+			// the material does not matter for depth, the buckets of a block are consecutive, so all of them are drawn at once
+			int count = bucket.count;
+			while (b + 1 < buckets.size() && buckets[b + 1].block == bucket.block)
+				count += buckets[++b].count;
+			functions->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(bucket.first * sizeof(DrawElementsIndirectCommand)), count, 0);
+		}
+		else {
+			// the objects of a bucket with a texture array read their layers from the object buffer
+			if (bucket.texture != 0) cache->bindTexture(0, bucket.texture);
+			else if (bucket.textureArray >= 0) ResourceCache::getDefault()->getTextureArrays()->bind(bucket.textureArray, 0);
+			functions->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(bucket.first * sizeof(DrawElementsIndirectCommand)), bucket.count, 0);
+		}
+		drawCallCount++;
+	}
+
+	if (objectLoc >= 0) {
+		functions->glVertexAttribDivisor(objectLoc, 0);
+		functions->glDisableVertexAttribArray(objectLoc);
+	}
+}
+
+/*
+Description:
+	This function is used to keep the depth of the frame for the occlusion culling of the next frame, the depth is copied and reduced to a max-depth pyramid, which is done after the opaque geometry is drawn,
+	the copy and the pyramid are sized for the framebuffer, and only the lower left region the frame was drawn to is reduced, so a scene drawn at a changing scale keeps them;
+Input:
+	@ GLuint framebuffer: the framebuffer the frame is drawn to;
+	@ int width: the width of the region drawn in pixels;
+	@ int height: the height of the region drawn in pixels;
+	@ int targetWidth: the width of the framebuffer in pixels;
+	@ int targetHeight: the height of the framebuffer in pixels;
+	@ const QMatrix4x4& viewProjectionMatrix: the view projection matrix of the frame;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::captureDepth(GLuint framebuffer, int width, int height, int targetWidth, int targetHeight, const QMatrix4x4& viewProjectionMatrix) {
+	if (functions == 0 || pyramidShader == 0) return;
+
+	if (targetWidth != depthWidth || targetHeight != depthHeight) resizeDepth(targetWidth, targetHeight);
+	if (depthTexture == 0) return;
+	width = qBound(1, width, depthWidth);
+	height = qBound(1, height, depthHeight);
+	capturedLevels = 1;
+	while ((qMax(width, height) >> capturedLevels) > 0)
+		capturedLevels++;
+
+	// the framebuffer of the frame is bound again afterwards, instead of asking OpenGL which one was bound
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	cache->bindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+	functions->glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	cache->bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	// level 0 copies the depth, every other level reduces the level before
+	cache->useProgram(pyramidShader);
+	pyramidShader->setUniformValue("u_source", textureUnit);
+	pyramidShader->setUniformValue("u_target", 0);
+	int sourceSize = pyramidShader->uniformLocation("u_sourceSize");
+	int targetSize = pyramidShader->uniformLocation("u_targetSize");
+	int sourceWidth = width, sourceHeight = height;
+	int levelWidth = width, levelHeight = height;
+	for (int level = 0; level < capturedLevels; level++) {
+		cache->bindTexture(textureUnit, GL_TEXTURE_2D, level == 0 ? depthTexture : pyramidTexture);
+
+		pyramidShader->setUniformValue("u_sourceLevel", level - 1);
+		functions->glUniform2i(sourceSize, sourceWidth, sourceHeight);
+		functions->glUniform2i(targetSize, levelWidth, levelHeight);
+		functions->glBindImageTexture(0, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		functions->glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		functions->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+		levelWidth = qMax(levelWidth / 2, 1);
+		levelHeight = qMax(levelHeight / 2, 1);
+	}
+	functions->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+	capturedWidth = width;
+	capturedHeight = height;
+	depthValid = true;
+	previousViewProjectionMatrix = viewProjectionMatrix;
+}
+
+/*
+Description:
+	This function is used to enable the culling against the depth of the previous frame, the frustum culling is always done;
+Input:
+	@ bool enabled: true to enable the occlusion culling;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::setOcclusionCulling(bool enabled) {
+	occlusionCulling = enabled;
+}
+
+/*
+Description:
+	This function is used to check whether the objects are culled against the depth of the previous frame;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the occlusion culling is enabled;
+*/
+bool IndirectRenderer::isOcclusionCulling() const {
+	return occlusionCulling;
+}
+
+/*
+Description:
+	This function is used to get the amount of objects of the last frame, before culling;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of objects;
+*/
+int IndirectRenderer::getObjectCount() const {
+	return objects.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of buckets of the last frame, each bucket is drawn with one call per pass;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of buckets;
+*/
+int IndirectRenderer::getBucketCount() const {
+	return buckets.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of multi draw calls of the last frame over all the passes and variants;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of draw calls;
+*/
+int IndirectRenderer::getDrawCallCount() const {
+	return drawCallCount;
+}
+
+/*
+Description:
+	This function is used to get the amount of objects uploaded by the last update, which is 0 while nothing drawn by the path changes;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of objects;
+*/
+int IndirectRenderer::getUploadedCount() const {
+	return uploadedCount;
+}
+
+/*
+Description:
+	This function is used to read back the amount of objects the last culling left visible, which waits for the GPU, so it is meant for tests and not for every frame;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of objects drawing an instance;
+*/
+int IndirectRenderer::getVisibleCount() {
+	if (functions == 0 || objects.isEmpty()) return 0;
+
+	QVector<DrawElementsIndirectCommand> commands(objects.size());
+	GLStateCache::getDefault()->bindBuffer(commandBuffer);
+	commandBuffer.read(0, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+
+	int count = 0;
+	for (int i = 0; i < commands.size(); i++) {
+		if (commands[i].instanceCount != 0) count++;
+	}
+	return count;
+}
+
+/*
+Description:
+	This function is used to bind the interleaved vertices and the indices of a geometry block, the draws address their meshes in it by the first index and the base vertex;
+Input:
+	@ GeometryArena::Block* block: the block;
+	@ QOpenGLShaderProgram* shaderProgram: the bound shader program;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::bindBlock(GeometryArena::Block* block, QOpenGLShaderProgram* shaderProgram) {
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(block->vertexBuffer);
+
+	int offset = 0;
+	int verLoc = shaderProgram->attributeLocation("a_position");
+	shaderProgram->enableAttributeArray(verLoc);
+	shaderProgram->setAttributeBuffer(verLoc, GL_FLOAT, offset, 3, sizeof(Vertex));
+
+	offset += sizeof(QVector3D);
+	int texLoc = shaderProgram->attributeLocation("a_texcoord");
+	shaderProgram->enableAttributeArray(texLoc);
+	shaderProgram->setAttributeBuffer(texLoc, GL_FLOAT, offset, 2, sizeof(Vertex));
+
+	offset += sizeof(QVector2D);
+	int normLoc = shaderProgram->attributeLocation("a_normal");
+	shaderProgram->enableAttributeArray(normLoc);
+	shaderProgram->setAttributeBuffer(normLoc, GL_FLOAT, offset, 3, sizeof(Vertex));
+
+	cache->bindBuffer(block->indexBuffer);
+}
+
+/*
+Description:
+	This function is used to create the depth copy and the depth pyramid for a framebuffer size, the depth copy matches the combined depth and stencil buffer of QOpenGLWidget, so it can be blitted;
+Input:
+	@ int width: the width in pixels;
+	@ int height: the height in pixels;
+Output:
+	@ void returnValue: void;
+*/
+void IndirectRenderer::resizeDepth(int width, int height) {
+	depthWidth = width;
+	depthHeight = height;
+	depthValid = false;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	functions->glDeleteTextures(1, &depthTexture);
+	functions->glDeleteTextures(1, &pyramidTexture);
+	cache->invalidate();
+	depthTexture = pyramidTexture = 0;
+	if (width <= 0 || height <= 0) return;
+
+	pyramidLevels = 1;
+	while ((qMax(width, height) >> pyramidLevels) > 0)
+		pyramidLevels++;
+
+	functions->glGenTextures(1, &depthTexture);
+	cache->bindTexture(textureUnit, GL_TEXTURE_2D, depthTexture);
+	functions->glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	functions->glGenTextures(1, &pyramidTexture);
+	cache->bindTexture(textureUnit, GL_TEXTURE_2D, pyramidTexture);
+	functions->glTexStorage2D(GL_TEXTURE_2D, pyramidLevels, GL_R32F, width, height);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	if (depthFramebuffer == 0) functions->glGenFramebuffers(1, &depthFramebuffer);
+	cache->bindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+	functions->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <qvector.h>
+#include <qhash.h>
+#include <qstringlist.h>
+#include <qmatrix4x4.h>
+#include <qopenglbuffer.h>
+#include <qopengltexture.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include "CommandBuffer.h"
+#include "TransformBuffer.h"
+#include "SimdMath.h"
+
+// the GPU-driven path, the meshes are drawn from the blocks of the geometry arena, a compute shader culls the objects against the frustum and the depth of the previous frame,
+// and every material bucket is drawn with one glMultiDrawElementsIndirect
+class IndirectRenderer {
+public:
+	IndirectRenderer();
+	~IndirectRenderer();
+	void init(QOpenGLShaderProgram* cullShader, QOpenGLShaderProgram* pyramidShader);
+	void update(const CommandBuffer* commands);
+	void cull(const QMatrix4x4& viewProjectionMatrix, TransformBuffer* transformBuffer);
+	void draw(int pass, QOpenGLShaderProgram* shaderProgram);
+	void captureDepth(GLuint framebuffer, int width, int height, int targetWidth, int targetHeight, const QMatrix4x4& viewProjectionMatrix);
+	void setOcclusionCulling(bool enabled);
+	bool isOcclusionCulling() const;
+	int getObjectCount() const;
+	int getBucketCount() const;
+	int getDrawCallCount() const;
+	int getUploadedCount() const;
+	int getVisibleCount();
+
+	static const int textureUnit = 6;
+
+private:
+	Q_DISABLE_COPY(IndirectRenderer)
+
+	// one object per draw, matches struct IndirectObject in IndirectObjects.glsl (std430)
+	struct Object {
+		Matrix4 model;
+		Matrix4 instance;
+		Matrix4 animation;
+		float bounds[4];
+		float diffuseColor[4];
+		float ambienceColor[4];
+		float specularColor[4];
+		GLint mesh[4];
+		GLint texture[4];
+	};
+
+	// matches DrawElementsIndirectCommand, written by Cull.csh
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// the objects drawn with one state, they are consecutive in the object buffer
+	struct Bucket {
+		QStringList features;
+		quint32 featureMask;
+		QOpenGLTexture* texture;
+		int textureArray;
+		int block;
+		int first;
+		int count;
+	};
+
+	void bindBlock(GeometryArena::Block* block, QOpenGLShaderProgram* shaderProgram);
+	void resizeDepth(int width, int height);
+
+	QOpenGLShaderProgram* cullShader;
+	QOpenGLShaderProgram* pyramidShader;
+	QOpenGLFunctions_4_3_Compatibility* functions;
+
+	QVector<Object> objects;
+	QVector<Bucket> buckets;
+
+	// a CPU copy of the object buffer, only the runs of objects that differ from it are uploaded, an empty copy is uploaded in full
+	QVector<Object> uploadedObjects;
+	int uploadedCount;
+	QOpenGLBuffer objectBuffer;
+	QOpenGLBuffer commandBuffer;
+	QOpenGLBuffer objectIndexBuffer;
+	int objectCapacity;
+	int drawCallCount;
+
+	// the depth of the previous frame and its max-depth pyramid, sized for the target, and the region of them the previous frame was drawn to
+	bool occlusionCulling;
+	bool depthValid;
+	int depthWidth;
+	int depthHeight;
+	int pyramidLevels;
+	int capturedWidth;
+	int capturedHeight;
+	int capturedLevels;
+	GLuint depthFramebuffer;
+	GLuint depthTexture;
+	GLuint pyramidTexture;
+	QMatrix4x4 previousViewProjectionMatrix;
+};
@@ -0,0 +1,574 @@
+#include "JobSystem.h"
+#include <qhash.h>
+
+// the queue owned by the current thread when it is a worker
+static thread_local int currentQueue = 0;
+static thread_local JobSystem* currentSystem = 0;
+
+// the systems alive by their serial numbers, a serial is never reused, unlike the address of a system
+static QMutex systemsMutex;
+static QHash<int, JobSystem*> systems;
+static QAtomicInt nextSerial(1);
+
+// the queues given to the current thread by the systems it is not a worker of, by the serials of the systems, they are handed back to the systems still alive when the thread finishes
+struct JobSystemThread {
+	~JobSystemThread();
+	QVector<QPair<int, int> > queues;
+};
+static thread_local JobSystemThread externalThread;
+
+/*
+Description:
+	This function is a destructor, which hands the queues of a finishing thread back to the systems, so a thread started later can use them;
+Input:
+	@ void patameter: void;
+*/
+JobSystemThread::~JobSystemThread() {
+	QMutexLocker locker(&systemsMutex);
+	for (int i = 0; i < queues.size(); i++) {
+		JobSystem* system = systems.value(queues[i].first, 0);
+		if (system != 0) system->releaseThread(queues[i].second);
+	}
+}
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+JobCounter::JobCounter() :
+	count(0) {
+}
+
+/*
+Description:
+	This function is used to check whether all the jobs counted are done;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the count is zero;
+*/
+bool JobCounter::isDone() const {
+	return count.loadAcquire() == 0;
+}
+
+/*
+Description:
+	This function is used to get the amount of jobs counted that are not done yet;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the count;
+*/
+int JobCounter::getCount() const {
+	return count.loadAcquire();
+}
+
+/*
+Description:
+	This function is a constructor, which starts the worker threads, the thread calling JobSystem::parallelFor(int, int, int, const std::function<void(int, int)>&) works as well;
+Input:
+	@ int workerCount: the amount of worker threads;
+*/
+JobSystem::JobSystem(int workerCount) :
+	serial(nextSerial.fetchAndAddRelaxed(1)), sleepingHelpers(0), queuedCount(0), quit(0) {
+	workerCount = qMax(workerCount, 0);
+	for (int i = 0; i < workerCount + maxExternalThreads; i++)
+		queues.append(new JobQueue);
+	activeQueueCount.storeRelease(workerCount);
+	for (int i = 0; i < workerCount; i++) {
+		workers.append(new Worker(this, i));
+		workers.last()->start();
+	}
+
+	QMutexLocker locker(&systemsMutex);
+	systems.insert(serial, this);
+}
+
+/*
+Description:
+	This function is a destructor, which stops the worker threads;
+Input:
+	@ void patameter: void;
+*/
+JobSystem::~JobSystem() {
+	systemsMutex.lock();
+	systems.remove(serial);
+	systemsMutex.unlock();
+
+	quit.storeRelease(1);
+	sleepMutex.lock();
+	wakeCondition.wakeAll();
+	sleepMutex.unlock();
+
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i]->wait();
+		delete workers[i];
+	}
+	for (int i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+/*
+Description:
+	This function is used to run a function over a range of indices on all the threads, it returns after the whole range is done;
+	idle threads steal halves of the ranges still waiting, so uneven work is balanced without a central queue;
+Input:
+	@ int begin: the first index;
+	@ int end: one past the last index;
+	@ int grainSize: the largest range passed to the function at once;
+	@ const std::function<void(int, int)>& function: the function called with a range [begin, end);
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::parallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& function) {
+	if (begin >= end) return;
+	grainSize = qMax(grainSize, 1);
+
+	// small ranges and systems without workers run inline
+	if (workers.isEmpty() || end - begin <= grainSize) {
+		function(begin, end);
+		return;
+	}
+
+	int queueIndex = getQueueIndex();
+
+	QAtomicInt pending(end - begin);
+	Job job = { &function, begin, end, grainSize, &pending, std::function<void()>(), 0 };
+	execute(queueIndex, job);
+
+	// help with the remaining ranges, including those of other callers, until this range is done
+	helpUntilDone(queueIndex, pending);
+}
+
+/*
+Description:
+	This function is used to run a task on any thread of the system, the task may be held back until another counter reaches zero, which chains tasks without blocking a thread;
+Input:
+	@ const std::function<void()>& task: the task;
+	@ JobCounter* signal: the counter counting the task until it is done, 0 for none;
+	@ JobCounter* dependency: the counter that has to reach zero before the task starts, 0 for none;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::run(const std::function<void()>& task, JobCounter* signal, JobCounter* dependency) {
+	if (signal != 0) signal->count.fetchAndAddOrdered(1);
+
+	if (dependency != 0) {
+		QMutexLocker locker(&dependency->mutex);
+		if (dependency->count.loadAcquire() > 0) {
+			dependency->continuations.append(qMakePair(task, signal));
+			return;
+		}
+	}
+
+	Job job = { 0, 0, 0, 1, 0, task, signal };
+	if (workers.isEmpty())
+		execute(getQueueIndex(), job);
+	else
+		push(getQueueIndex(), job);
+}
+
+/*
+Description:
+	This function is used to wait until a counter reaches zero, the calling thread runs jobs meanwhile, and only sleeps when there is none left to run;
+Input:
+	@ JobCounter* counter: the counter;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::wait(JobCounter* counter) {
+	helpUntilDone(getQueueIndex(), counter->count);
+
+	// the last job holds the mutex of the counter while it counts down, so the counter may be destroyed once the mutex is free
+	QMutexLocker locker(&counter->mutex);
+}
+
+/*
+Description:
+	This function is used to get the amount of worker threads;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of worker threads;
+*/
+int JobSystem::getWorkerCount() const {
+	return workers.size();
+}
+
+/*
+Description:
+	This function is used to get the index of the calling thread, below JobSystem::getThreadCount(), so that a thread keeps its own copy of per-thread data without a lock,
+	a thread that is not a worker of the system gets an index of its own the first time it uses the system;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the thread index;
+*/
+int JobSystem::getThreadIndex() const {
+	return getQueueIndex();
+}
+
+/*
+Description:
+	This function is used to get the amount of thread indices, the workers and the threads that are not workers, so that per-thread data can be allocated up front;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of thread indices;
+*/
+int JobSystem::getThreadCount() const {
+	return queues.size();
+}
+
+/*
+Description:
+	This function is used to get the instrumentation of the queues since the last reset, the depths are those of the moment, the queues of threads that are not workers are listed after the workers once they are used;
+Input:
+	@ void parameter: void;
+Output:
+	@ Statistics returnValue: the depth and the maximum depth of each queue, the jobs run, the jobs stolen and the steals that found nothing;
+*/
+JobSystem::Statistics JobSystem::getStatistics() const {
+	Statistics statistics;
+	statistics.executedJobs = 0;
+	statistics.stolenJobs = 0;
+	statistics.failedSteals = 0;
+
+	int activeCount = activeQueueCount.loadAcquire();
+	for (int i = 0; i < activeCount; i++) {
+		JobQueue* queue = queues[i];
+		queue->mutex.lock();
+		statistics.queueDepths.append(queue->jobs.size());
+		queue->mutex.unlock();
+		statistics.maxQueueDepths.append(queue->maxDepth.loadAcquire());
+		statistics.executedJobs += queue->executed.loadAcquire();
+		statistics.stolenJobs += queue->stolen.loadAcquire();
+		statistics.failedSteals += queue->failedSteals.loadAcquire();
+	}
+	return statistics;
+}
+
+/*
+Description:
+	This function is used to restart the instrumentation of the queues;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::resetStatistics() {
+	for (int i = 0; i < queues.size(); i++) {
+		queues[i]->maxDepth.storeRelease(0);
+		queues[i]->executed.storeRelease(0);
+		queues[i]->stolen.storeRelease(0);
+		queues[i]->failedSteals.storeRelease(0);
+	}
+}
+
+/*
+Description:
+	This function is used to get the job system shared by the application, which has one worker less than the ideal thread count;
+Input:
+	@ void parameter: void;
+Output:
+	@ JobSystem* returnValue: the default job system;
+*/
+JobSystem* JobSystem::getDefault() {
+	static JobSystem system;
+	return &system;
+}
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ JobSystem* system: the job system owning the worker;
+	@ int queueIndex: the queue owned by the worker;
+*/
+JobSystem::Worker::Worker(JobSystem* system, int queueIndex) :
+	system(system), queueIndex(queueIndex) {
+}
+
+/*
+Description:
+	This function is used to run jobs until the job system stops, the worker sleeps while there is nothing to run;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::Worker::run() {
+	currentSystem = system;
+	currentQueue = queueIndex;
+
+	while (!system->quit.loadAcquire()) {
+		if (system->runOne(queueIndex)) continue;
+
+		// the queued count is checked under the mutex push() wakes under, so a job pushed meanwhile is never missed and the worker sleeps until there is one
+		system->sleepMutex.lock();
+		if (!system->quit.loadAcquire() && system->queuedCount.loadAcquire() == 0)
+			system->wakeCondition.wait(&system->sleepMutex);
+		system->sleepMutex.unlock();
+	}
+}
+
+/*
+Description:
+	This function is used to push a job to the back of a queue and wake a sleeping worker;
+Input:
+	@ int queueIndex: the queue;
+	@ const Job& job: the job;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::push(int queueIndex, const Job& job) {
+	JobQueue* queue = queues[queueIndex];
+	queue->mutex.lock();
+	queue->jobs.append(job);
+	int depth = queue->jobs.size();
+	queue->mutex.unlock();
+
+	// other threads push to the queue as well, a thread only raises the maximum when no other one raised it meanwhile
+	int maxDepth = queue->maxDepth.loadRelaxed();
+	while (depth > maxDepth && !queue->maxDepth.testAndSetOrdered(maxDepth, depth, maxDepth)) {
+	}
+
+	queuedCount.fetchAndAddOrdered(1);
+	sleepMutex.lock();
+	wakeCondition.wakeOne();
+	// a thread sleeping in a wait may be the only one left to run the job, when all the workers wait as well
+	if (sleepingHelpers > 0) doneCondition.wakeAll();
+	sleepMutex.unlock();
+}
+
+/*
+Description:
+	This function is used to pop the most recent job from the back of a queue;
+Input:
+	@ int queueIndex: the queue;
+	@ Job& job: the job popped;
+Output:
+	@ bool returnValue: true if a job is popped;
+*/
+bool JobSystem::pop(int queueIndex, Job& job) {
+	JobQueue* queue = queues[queueIndex];
+	QMutexLocker locker(&queue->mutex);
+	if (queue->jobs.isEmpty()) return false;
+	job = queue->jobs.last();
+	queue->jobs.removeLast();
+	queuedCount.fetchAndAddRelease(-1);
+	return true;
+}
+
+/*
+Description:
+	This function is used to steal the oldest job from the front of another queue, the queues in use are visited starting from the next one;
+Input:
+	@ int queueIndex: the queue of the thief;
+	@ Job& job: the job stolen;
+Output:
+	@ bool returnValue: true if a job is stolen;
+*/
+bool JobSystem::steal(int queueIndex, Job& job) {
+	int activeCount = activeQueueCount.loadAcquire();
+	for (int i = 1; i < activeCount; i++) {
+		JobQueue* queue = queues[(queueIndex + i) % activeCount];
+		if (!queue->mutex.tryLock()) continue;
+		if (!queue->jobs.isEmpty()) {
+			job = queue->jobs.first();
+			queue->jobs.removeFirst();
+			queue->mutex.unlock();
+			queuedCount.fetchAndAddRelease(-1);
+			queues[queueIndex]->stolen.fetchAndAddRelaxed(1);
+			return true;
+		}
+		queue->mutex.unlock();
+	}
+	queues[queueIndex]->failedSteals.fetchAndAddRelaxed(1);
+	return false;
+}
+
+/*
+Description:
+	This function is used to run one job from the own queue, or a stolen one;
+Input:
+	@ int queueIndex: the queue of the calling thread;
+Output:
+	@ bool returnValue: true if a job is run;
+*/
+bool JobSystem::runOne(int queueIndex) {
+	Job job;
+	if (!pop(queueIndex, job) && !steal(queueIndex, job)) return false;
+	execute(queueIndex, job);
+	return true;
+}
+
+/*
+Description:
+	This function is used to run a job, the upper half of the range is pushed back for thieves until the range fits the grain size;
+Input:
+	@ int queueIndex: the queue of the calling thread;
+	@ Job job: the job;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::execute(int queueIndex, Job job) {
+	queues[queueIndex]->executed.fetchAndAddRelaxed(1);
+
+	if (job.function == 0) {
+		job.task();
+		finish(job.signal);
+		return;
+	}
+
+	while (job.end - job.begin > job.grainSize) {
+		int middle = job.begin + (job.end - job.begin) / 2;
+		Job upper = job;
+		upper.begin = middle;
+		push(queueIndex, upper);
+		job.end = middle;
+	}
+
+	(*job.function)(job.begin, job.end);
+	if (job.pending->fetchAndAddOrdered(-(job.end - job.begin)) == job.end - job.begin)
+		wakeHelpers();
+}
+
+/*
+Description:
+	This function is used to count down the counter of a finished task, the last task of a counter starts the tasks held back by it;
+Input:
+	@ JobCounter* signal: the counter, 0 for none;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::finish(JobCounter* signal) {
+	if (signal == 0) return;
+
+	QVector<QPair<std::function<void()>, JobCounter*> > continuations;
+	signal->mutex.lock();
+	bool done = signal->count.fetchAndAddOrdered(-1) == 1;
+	if (done) continuations.swap(signal->continuations);
+	signal->mutex.unlock();
+	if (done) wakeHelpers();
+
+	// the counters of the tasks held back are already counted up
+	for (int i = 0; i < continuations.size(); i++) {
+		Job job = { 0, 0, 0, 1, 0, continuations[i].first, continuations[i].second };
+		if (workers.isEmpty())
+			execute(getQueueIndex(), job);
+		else
+			push(getQueueIndex(), job);
+	}
+}
+
+/*
+Description:
+	This function is used to run jobs until a count reaches zero, the thread spins for a few rounds when there is no job to run, and then sleeps until a job is pushed or a count reaches zero;
+Input:
+	@ int queueIndex: the queue of the calling thread;
+	@ const QAtomicInt& count: the count waited for;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::helpUntilDone(int queueIndex, const QAtomicInt& count) {
+	int idleRounds = 0;
+	while (count.loadAcquire() > 0) {
+		if (runOne(queueIndex)) {
+			idleRounds = 0;
+			continue;
+		}
+
+		// the last jobs are usually about to finish on other threads, which a short spin catches without the cost of sleeping
+		if (++idleRounds < spinRounds) {
+			QThread::yieldCurrentThread();
+			continue;
+		}
+
+		// the count and the queued jobs are checked under the mutex the finishing and the pushing threads wake under, so no wake is missed
+		sleepMutex.lock();
+		if (count.loadAcquire() > 0 && queuedCount.loadAcquire() == 0) {
+			sleepingHelpers++;
+			doneCondition.wait(&sleepMutex);
+			sleepingHelpers--;
+		}
+		sleepMutex.unlock();
+		idleRounds = 0;
+	}
+}
+
+/*
+Description:
+	This function is used to wake the threads sleeping until a count reaches zero, after a count did, each of them checks its own count;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::wakeHelpers() {
+	sleepMutex.lock();
+	if (sleepingHelpers > 0) doneCondition.wakeAll();
+	sleepMutex.unlock();
+}
+
+/*
+Description:
+	This function is used to get the queue of the calling thread, a thread that is not a worker of the system is given a queue the first time;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the queue index;
+*/
+int JobSystem::getQueueIndex() const {
+	if (currentSystem == this) return currentQueue;
+
+	const QVector<QPair<int, int> >& registered = externalThread.queues;
+	for (int i = 0; i < registered.size(); i++) {
+		if (registered[i].first == serial) return registered[i].second;
+	}
+	return registerThread();
+}
+
+/*
+Description:
+	This function is used to give the calling thread that is not a worker a queue of its own, which it keeps until it finishes,
+	the threads render, simulate and load at once, so none of them may share a queue or the per-thread data of another one;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the queue index;
+*/
+int JobSystem::registerThread() const {
+	QMutexLocker locker(&registerMutex);
+
+	// the queues of finished threads are used again, the jobs they left are still stolen meanwhile, since the queues in use only grow
+	int queueIndex;
+	if (!freeQueues.isEmpty()) {
+		queueIndex = freeQueues.last();
+		freeQueues.removeLast();
+	}
+	else {
+		queueIndex = activeQueueCount.loadAcquire();
+		if (queueIndex >= queues.size())
+			qFatal("JobSystem: more than %d threads that are not workers use the system at once", maxExternalThreads);
+		activeQueueCount.storeRelease(queueIndex + 1);
+	}
+
+	externalThread.queues.append(qMakePair(serial, queueIndex));
+	return queueIndex;
+}
+
+/*
+Description:
+	This function is used to take back the queue of a finished thread that was not a worker;
+Input:
+	@ int queueIndex: the queue;
+Output:
+	@ void returnValue: void;
+*/
+void JobSystem::releaseThread(int queueIndex) const {
+	QMutexLocker locker(&registerMutex);
+	freeQueues.append(queueIndex);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <qthread.h>
+#include <qmutex.h>
+#include <qwaitcondition.h>
+#include <qatomic.h>
+#include <qvector.h>
+#include <qpair.h>
+#include <functional>
+
+// counts the jobs not yet done, a caller waits on it with JobSystem::wait(JobCounter*), and jobs can be held back until it reaches zero
+class JobCounter {
+public:
+	JobCounter();
+	bool isDone() const;
+	int getCount() const;
+
+private:
+	Q_DISABLE_COPY(JobCounter)
+	friend class JobSystem;
+
+	QAtomicInt count;
+
+	// the jobs held back by the counter with the counters they signal, they are queued when the count reaches zero
+	QMutex mutex;
+	QVector<QPair<std::function<void()>, JobCounter*> > continuations;
+};
+
+class JobSystem {
+public:
+	// the instrumentation of the queues since the last reset, a high steal rate or deep queues show unbalanced work
+	struct Statistics {
+		QVector<int> queueDepths;
+		QVector<int> maxQueueDepths;
+		int executedJobs;
+		int stolenJobs;
+		int failedSteals;
+	};
+
+	JobSystem(int workerCount = QThread::idealThreadCount() - 1);
+	~JobSystem();
+	void parallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& function);
+	void run(const std::function<void()>& task, JobCounter* signal = 0, JobCounter* dependency = 0);
+	void wait(JobCounter* counter);
+	int getWorkerCount() const;
+	int getThreadIndex() const;
+	int getThreadCount() const;
+	Statistics getStatistics() const;
+	void resetStatistics();
+
+	static JobSystem* getDefault();
+
+private:
+	Q_DISABLE_COPY(JobSystem)
+	friend struct JobSystemThread;
+
+	// a range of a parallel for, it is split in halves until it is no larger than the grain size, or a single task when there is no function
+	struct Job {
+		const std::function<void(int, int)>* function;
+		int begin;
+		int end;
+		int grainSize;
+		QAtomicInt* pending;
+		std::function<void()> task;
+		JobCounter* signal;
+	};
+
+	// the owner pushes and pops at the back, thieves steal from the front, where the largest ranges are
+	struct JobQueue {
+		QMutex mutex;
+		QVector<Job> jobs;
+
+		QAtomicInt maxDepth;
+		QAtomicInt executed;
+		QAtomicInt stolen;
+		QAtomicInt failedSteals;
+	};
+
+	class Worker : public QThread {
+	public:
+		Worker(JobSystem* system, int queueIndex);
+		void run();
+
+	private:
+		JobSystem* system;
+		int queueIndex;
+	};
+
+	void push(int queueIndex, const Job& job);
+	bool pop(int queueIndex, Job& job);
+	bool steal(int queueIndex, Job& job);
+	bool runOne(int queueIndex);
+	void helpUntilDone(int queueIndex, const QAtomicInt& count);
+	void wakeHelpers();
+	void execute(int queueIndex, Job job);
+	void finish(JobCounter* signal);
+	int getQueueIndex() const;
+	int registerThread() const;
+	void releaseThread(int queueIndex) const;
+
+	// the threads that are not workers, such as the GUI, render and simulation threads, each get one of these queues while they run
+	static const int maxExternalThreads = 16;
+
+	// the workers own the first queues, the threads that are not workers the ones after them in the order they first use the system
+	int serial;
+	QVector<JobQueue*> queues;
+	mutable QAtomicInt activeQueueCount;
+	mutable QMutex registerMutex;
+	mutable QVector<int> freeQueues;
+	QVector<Worker*> workers;
+
+	// the rounds without a job a waiting thread spins before it sleeps
+	static const int spinRounds = 64;
+
+	// idle workers sleep on the wake condition, threads waiting for a count on the done condition, the sleeping helpers are counted under the mutex
+	QMutex sleepMutex;
+	QWaitCondition wakeCondition;
+	QWaitCondition doneCondition;
+	int sleepingHelpers;
+	QAtomicInt queuedCount;
+	QAtomicInt quit;
+};
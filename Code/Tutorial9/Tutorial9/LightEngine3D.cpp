@@ -0,0 +1,376 @@
+#include "LightEngine3D.h"
+#include "GLStateCache.h"
+#include <qvector2d.h>
+#include <QtMath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LIGHT_ENGINE_USE_SSE
+#endif
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+LightEngine3D::LightEngine3D() :
+	functions(0), lightDataTexture(0), clusterDataTexture(0), lightIndexTexture(0) {
+	nearPlane = 0.01f;
+	farPlane = 500.0f;
+	sliceScale = 0.0f;
+	sliceBias = 0.0f;
+	tileWidth = 1.0f;
+	tileHeight = 1.0f;
+
+	clusterData.fill(0, 2 * clusterCountX * clusterCountY * clusterCountZ);
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+LightEngine3D::~LightEngine3D() {
+	if (functions != 0) {
+		functions->glDeleteTextures(1, &lightDataTexture);
+		functions->glDeleteTextures(1, &clusterDataTexture);
+		functions->glDeleteTextures(1, &lightIndexTexture);
+	}
+	if (lightDataBuffer.isCreated())
+		lightDataBuffer.destroy();
+	if (clusterDataBuffer.isCreated())
+		clusterDataBuffer.destroy();
+	if (lightIndexBuffer.isCreated())
+		lightIndexBuffer.destroy();
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to create the buffer textures holding light data, cluster ranges and light indices, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::init() {
+	functions = GLStateCache::getDefault()->getFunctions();
+	if (functions == 0) return;
+
+	lightDataBuffer.create();
+	lightDataBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	clusterDataBuffer.create();
+	clusterDataBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	lightIndexBuffer.create();
+	lightIndexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+
+	functions->glGenTextures(1, &lightDataTexture);
+	functions->glGenTextures(1, &clusterDataTexture);
+	functions->glGenTextures(1, &lightIndexTexture);
+}
+
+/*
+Description:
+	This function is used to append a light to the end of the light list;
+Input:
+	@ const PointLight& light: a point light in world space;
+Output:
+	@ int returnValue: the index of the light;
+*/
+int LightEngine3D::addLight(const PointLight& light) {
+	lights.append(light);
+	return lights.size() - 1;
+}
+
+/*
+Description:
+	This function is used to replace a light in the light list;
+Input:
+	@ int index: index refer to the light;
+	@ const PointLight& light: a point light in world space;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::setLight(int index, const PointLight& light) {
+	if (index < 0 || index >= lights.size()) return;
+	lights[index] = light;
+}
+
+/*
+Description:
+	This function is used to get a light from the light list by its index;
+Input:
+	@ int index: index refer to the light;
+Output:
+	@ const PointLight& returnValue: the light;
+*/
+const PointLight& LightEngine3D::getLight(int index) const {
+	return lights[index];
+}
+
+/*
+Description:
+	This function is used to delete a light by its index;
+Input:
+	@ int index: index refer to the light;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::delLight(int index) {
+	if (index < 0 || index >= lights.size()) return;
+	lights.remove(index);
+}
+
+/*
+Description:
+	This function is used to get total amount of lights in the light list;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the total amount of lights;
+*/
+int LightEngine3D::getCount() const {
+	return lights.size();
+}
+
+/*
+Description:
+	This function is used to build the view-space bounds of every cluster, where the view frustum is split into screen tiles and exponential depth slices;
+Input:
+	@ float verticalAngle: vertical field of view in degrees;
+	@ float aspectRatio: width divided by height;
+	@ float nearPlane: distance to the near plane;
+	@ float farPlane: distance to the far plane;
+	@ int width: framebuffer width in pixels;
+	@ int height: framebuffer height in pixels;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::setProjection(float verticalAngle, float aspectRatio, float nearPlane, float farPlane, int width, int height) {
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	float logRange = qLn(farPlane / nearPlane);
+	sliceScale = clusterCountZ / logRange;
+	sliceBias = -clusterCountZ * qLn(nearPlane) / logRange;
+
+	setTargetSize(width, height);
+
+	float tanY = qTan(qDegreesToRadians(verticalAngle) / 2.0f);
+	float tanX = tanY * aspectRatio;
+
+	int clusterCount = clusterCountX * clusterCountY * clusterCountZ;
+	clusterMinX.resize(clusterCount);
+	clusterMinY.resize(clusterCount);
+	clusterMinZ.resize(clusterCount);
+	clusterMaxX.resize(clusterCount);
+	clusterMaxY.resize(clusterCount);
+	clusterMaxZ.resize(clusterCount);
+
+	for (int z = 0; z < clusterCountZ; z++) {
+		float sliceNear = nearPlane * qPow(farPlane / nearPlane, z / (float)clusterCountZ);
+		float sliceFar = nearPlane * qPow(farPlane / nearPlane, (z + 1) / (float)clusterCountZ);
+		for (int y = 0; y < clusterCountY; y++) {
+			float y0 = (-1.0f + 2.0f * y / clusterCountY) * tanY;
+			float y1 = (-1.0f + 2.0f * (y + 1) / clusterCountY) * tanY;
+			for (int x = 0; x < clusterCountX; x++) {
+				float x0 = (-1.0f + 2.0f * x / clusterCountX) * tanX;
+				float x1 = (-1.0f + 2.0f * (x + 1) / clusterCountX) * tanX;
+
+				int index = (z * clusterCountY + y) * clusterCountX + x;
+				clusterMinX[index] = qMin(x0 * sliceNear, x0 * sliceFar);
+				clusterMaxX[index] = qMax(x1 * sliceNear, x1 * sliceFar);
+				clusterMinY[index] = qMin(y0 * sliceNear, y0 * sliceFar);
+				clusterMaxY[index] = qMax(y1 * sliceNear, y1 * sliceFar);
+				clusterMinZ[index] = -sliceFar;
+				clusterMaxZ[index] = -sliceNear;
+			}
+		}
+	}
+}
+
+/*
+Description:
+	This function is used to set the size of the target the lighting is drawn to, the screen tiles of the clusters are sized from it, which is cheap enough to call every frame;
+Input:
+	@ int width: target width in pixels;
+	@ int height: target height in pixels;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::setTargetSize(int width, int height) {
+	tileWidth = width / (float)clusterCountX;
+	tileHeight = height / (float)clusterCountY;
+}
+
+/*
+Description:
+	This function is used to transform the lights into view space, assign them to clusters on the job system and upload the result to the buffer textures;
+Input:
+	@ const QMatrix4x4& viewMatrix: the view matrix of the current frame;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::update(const QMatrix4x4& viewMatrix) {
+	if (functions == 0 || clusterMinX.isEmpty()) return;
+
+	viewLights.resize(lights.size());
+	lightData.resize(qMax(2 * lights.size(), 1));
+	for (int i = 0; i < lights.size(); i++) {
+		QVector3D position = viewMatrix.map(lights[i].position);
+		viewLights[i] = QVector4D(position, lights[i].radius);
+		lightData[2 * i + 0] = QVector4D(position, lights[i].radius);
+		lightData[2 * i + 1] = QVector4D(lights[i].color * lights[i].power, 0.0f);
+	}
+
+	// each job owns a contiguous range of depth slices, on the job system shared with the transform updates, so the cores are not oversubscribed
+	GLuint* clusters = clusterData.data();
+	JobSystem::getDefault()->parallelFor(0, clusterCountZ, 1, [this, clusters](int first, int last) { assignSlices(first, last, clusters); });
+
+	// concatenate the slices and turn the per-slice offsets into global offsets
+	int total = 0;
+	for (int z = 0; z < clusterCountZ; z++)
+		total += sliceIndices[z].size();
+	lightIndices.resize(qMax(total, 1));
+
+	int base = 0;
+	int clustersPerSlice = clusterCountX * clusterCountY;
+	for (int z = 0; z < clusterCountZ; z++) {
+		for (int i = 0; i < clustersPerSlice; i++)
+			clusters[2 * (z * clustersPerSlice + i)] += base;
+		if (!sliceIndices[z].isEmpty())
+			memcpy(lightIndices.data() + base, sliceIndices[z].constData(), sliceIndices[z].size() * sizeof(GLuint));
+		base += sliceIndices[z].size();
+	}
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(lightDataBuffer);
+	lightDataBuffer.allocate(lightData.constData(), lightData.size() * sizeof(QVector4D));
+	cache->bindBuffer(clusterDataBuffer);
+	clusterDataBuffer.allocate(clusterData.constData(), clusterData.size() * sizeof(GLuint));
+	cache->bindBuffer(lightIndexBuffer);
+	lightIndexBuffer.allocate(lightIndices.constData(), lightIndices.size() * sizeof(GLuint));
+
+	// the buffer textures are attached on the units they are sampled from, so binding them for drawing costs nothing
+	cache->bindTexture(1, GL_TEXTURE_BUFFER, lightDataTexture);
+	functions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightDataBuffer.bufferId());
+	cache->bindTexture(2, GL_TEXTURE_BUFFER, clusterDataTexture);
+	functions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, clusterDataBuffer.bufferId());
+	cache->bindTexture(3, GL_TEXTURE_BUFFER, lightIndexTexture);
+	functions->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, lightIndexBuffer.bufferId());
+}
+
+/*
+Description:
+	This function is used to bind the buffer textures to texture units 1, 2 and 3 and set the cluster parameters for the fragment shader;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::bind(QOpenGLShaderProgram* shaderProgram) {
+	if (functions == 0) return;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindTexture(1, GL_TEXTURE_BUFFER, lightDataTexture);
+	cache->bindTexture(2, GL_TEXTURE_BUFFER, clusterDataTexture);
+	cache->bindTexture(3, GL_TEXTURE_BUFFER, lightIndexTexture);
+
+	shaderProgram->setUniformValue("u_lightData", 1);
+	shaderProgram->setUniformValue("u_clusterData", 2);
+	shaderProgram->setUniformValue("u_lightIndices", 3);
+	shaderProgram->setUniformValue("u_clusterTileSize", QVector2D(tileWidth, tileHeight));
+	shaderProgram->setUniformValue("u_clusterScale", sliceScale);
+	shaderProgram->setUniformValue("u_clusterBias", sliceBias);
+	functions->glUniform3i(shaderProgram->uniformLocation("u_clusterGrid"), clusterCountX, clusterCountY, clusterCountZ);
+}
+
+/*
+Description:
+	This function is used to assign the view-space lights to the clusters of a range of depth slices, where every light sphere is tested against four cluster bounds at a time;
+	the light indices of each slice are grouped by cluster, and at most maxLightsPerCluster lights are kept for each cluster, so the cost per pixel stays bounded;
+Input:
+	@ int firstSlice: the first depth slice of the range;
+	@ int lastSlice: one past the last depth slice of the range;
+	@ GLuint* clusters: the (offset, count) pairs of all the clusters, offsets are relative to the slice;
+Output:
+	@ void returnValue: void;
+*/
+void LightEngine3D::assignSlices(int firstSlice, int lastSlice, GLuint* clusters) {
+	const int clustersPerSlice = clusterCountX * clusterCountY;
+	const QVector4D* spheres = viewLights.constData();
+
+	for (int z = firstSlice; z < lastSlice; z++) {
+		int sliceBase = z * clustersPerSlice;
+		float sliceNear = -clusterMaxZ[sliceBase];
+		float sliceFar = -clusterMinZ[sliceBase];
+
+		// collect (cluster, light) hits of the slice
+		QVector<GLuint>& hits = sliceHits[z];
+		hits.resize(0);
+
+		for (int l = 0; l < viewLights.size(); l++) {
+			float depth = -spheres[l].z();
+			float radius = spheres[l].w();
+			if (depth + radius < sliceNear || depth - radius > sliceFar) continue;
+
+#ifdef LIGHT_ENGINE_USE_SSE
+			__m128 centerX = _mm_set1_ps(spheres[l].x());
+			__m128 centerY = _mm_set1_ps(spheres[l].y());
+			__m128 centerZ = _mm_set1_ps(spheres[l].z());
+			__m128 radiusSquared = _mm_set1_ps(radius * radius);
+			__m128 zero = _mm_setzero_ps();
+			for (int i = 0; i < clustersPerSlice; i += 4) {
+				int index = sliceBase + i;
+				__m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinX[index]), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(&clusterMaxX[index])));
+				__m128 dy = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinY[index]), centerY), _mm_sub_ps(centerY, _mm_loadu_ps(&clusterMaxY[index])));
+				__m128 dz = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinZ[index]), centerZ), _mm_sub_ps(centerZ, _mm_loadu_ps(&clusterMaxZ[index])));
+				dx = _mm_max_ps(dx, zero);
+				dy = _mm_max_ps(dy, zero);
+				dz = _mm_max_ps(dz, zero);
+				__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared));
+				for (int j = 0; j < 4; j++) {
+					if (mask & (1 << j))
+						hits << (GLuint)(i + j) << (GLuint)l;
+				}
+			}
+#else
+			for (int i = 0; i < clustersPerSlice; i++) {
+				int index = sliceBase + i;
+				float dx = qMax(0.0f, qMax(clusterMinX[index] - spheres[l].x(), spheres[l].x() - clusterMaxX[index]));
+				float dy = qMax(0.0f, qMax(clusterMinY[index] - spheres[l].y(), spheres[l].y() - clusterMaxY[index]));
+				float dz = qMax(0.0f, qMax(clusterMinZ[index] - spheres[l].z(), spheres[l].z() - clusterMaxZ[index]));
+				if (dx * dx + dy * dy + dz * dz <= radius * radius)
+					hits << (GLuint)i << (GLuint)l;
+			}
+#endif
+		}
+
+		// counting sort of the hits by cluster, keeping the light order inside each cluster
+		int counts[clustersPerSlice];
+		int offsets[clustersPerSlice];
+		for (int i = 0; i < clustersPerSlice; i++)
+			counts[i] = 0;
+		for (int h = 0; h < hits.size(); h += 2)
+			counts[hits[h]] = qMin(counts[hits[h]] + 1, (int)maxLightsPerCluster);
+
+		int offset = 0;
+		for (int i = 0; i < clustersPerSlice; i++) {
+			offsets[i] = offset;
+			clusters[2 * (sliceBase + i) + 0] = offset;
+			clusters[2 * (sliceBase + i) + 1] = counts[i];
+			offset += counts[i];
+		}
+
+		QVector<GLuint>& indices = sliceIndices[z];
+		indices.resize(offset);
+		for (int h = 0; h < hits.size(); h += 2) {
+			int cluster = hits[h];
+			if (offsets[cluster] < (int)clusters[2 * (sliceBase + cluster)] + counts[cluster])
+				indices[offsets[cluster]++] = hits[h + 1];
+		}
+	}
+}
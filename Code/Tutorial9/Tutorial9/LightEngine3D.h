@@ -0,0 +1,73 @@
+#pragma once
+#include <qvector.h>
+#include <qvector3d.h>
+#include <qvector4d.h>
+#include <qmatrix4x4.h>
+#include <qopenglbuffer.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include "JobSystem.h"
+
+struct PointLight {
+	PointLight() : power(1.0f), radius(1.0f) {};
+	PointLight(QVector3D position, QVector3D color, float power, float radius) :
+		position(position), color(color), power(power), radius(radius) {
+	};
+	QVector3D position;
+	QVector3D color;
+	float power;
+	float radius;
+};
+
+class LightEngine3D {
+public:
+	LightEngine3D();
+	~LightEngine3D();
+	void init();
+	int addLight(const PointLight& light);
+	void setLight(int index, const PointLight& light);
+	const PointLight& getLight(int index) const;
+	void delLight(int index);
+	int getCount() const;
+
+	void setProjection(float verticalAngle, float aspectRatio, float nearPlane, float farPlane, int width, int height);
+	void setTargetSize(int width, int height);
+	void update(const QMatrix4x4& viewMatrix);
+	void bind(QOpenGLShaderProgram* shaderProgram);
+
+	static const int clusterCountX = 16;
+	static const int clusterCountY = 9;
+	static const int clusterCountZ = 24;
+	static const int maxLightsPerCluster = 64;
+
+private:
+	void assignSlices(int firstSlice, int lastSlice, GLuint* clusters);
+
+	QVector<PointLight> lights;
+
+	// view-space lights of the current frame, the sphere of each light is stored as (x, y, z, radius)
+	QVector<QVector4D> viewLights;
+
+	// view-space bounds of each cluster, in structure-of-arrays layout so that four clusters are tested at once
+	QVector<float> clusterMinX, clusterMinY, clusterMinZ;
+	QVector<float> clusterMaxX, clusterMaxY, clusterMaxZ;
+	float nearPlane, farPlane;
+	float sliceScale, sliceBias;
+	float tileWidth, tileHeight;
+
+	// light indices of each slice, grouped by cluster, and the (offset, count) of each cluster inside its slice
+	QVector<GLuint> sliceIndices[clusterCountZ];
+	QVector<GLuint> sliceHits[clusterCountZ];
+	QVector<GLuint> clusterData;
+	QVector<GLuint> lightIndices;
+	QVector<QVector4D> lightData;
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+	QOpenGLBuffer lightDataBuffer;
+	QOpenGLBuffer clusterDataBuffer;
+	QOpenGLBuffer lightIndexBuffer;
+	GLuint lightDataTexture;
+	GLuint clusterDataTexture;
+	GLuint lightIndexTexture;
+};
+
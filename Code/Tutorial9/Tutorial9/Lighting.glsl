@@ -0,0 +1,64 @@
+// clustered phong shading shared by Object.fsh and Indirect.fsh, only the lights assigned to the cluster of a fragment by LightEngine3D are shaded
+struct MaterialProperty {
+	vec3 diffuseColor;
+	vec3 ambienceColor;
+	vec3 specularColor;
+	float shinnes;
+};
+
+#ifndef MAX_CLUSTER_LIGHTS
+#define MAX_CLUSTER_LIGHTS 64
+#endif
+
+// two texels per light, (view-space position, radius) and (color * power, 0)
+uniform samplerBuffer u_lightData;
+// one texel per cluster, (offset, count) into u_lightIndices
+uniform usamplerBuffer u_clusterData;
+uniform usamplerBuffer u_lightIndices;
+uniform ivec3 u_clusterGrid;
+uniform vec2 u_clusterTileSize;
+uniform float u_clusterScale;
+uniform float u_clusterBias;
+
+vec4 shade(vec4 position, vec3 normal, vec4 diffMatColor, MaterialProperty material) {
+
+	vec4 resultColor = vec4(0.0, 0.0, 0.0, 0.0);
+	vec4 eyePosition = vec4(0.0, 0.0, 0.0, 1.0);
+	vec3 eyeVec = normalize(position.xyz - eyePosition.xyz);
+
+	float specularFactor = material.shinnes;
+	float ambientFactor = 0.1;
+
+	vec4 ambientColor = ambientFactor * diffMatColor;
+	resultColor += ambientColor * vec4(material.ambienceColor, 1.0);
+
+	// find the cluster of the fragment, the screen tile from the window position and the depth slice from the view-space depth
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / u_clusterTileSize), ivec2(0), u_clusterGrid.xy - 1);
+	int slice = clamp(int(log(-position.z) * u_clusterScale + u_clusterBias), 0, u_clusterGrid.z - 1);
+	int cluster = (slice * u_clusterGrid.y + tile.y) * u_clusterGrid.x + tile.x;
+	uvec2 range = texelFetch(u_clusterData, cluster).xy;
+
+	// only the lights touching the cluster are shaded
+	uint count = min(range.y, uint(MAX_CLUSTER_LIGHTS));
+	for (uint i = 0u; i < count; i++) {
+		int lightIndex = int(texelFetch(u_lightIndices, int(range.x + i)).x);
+		vec4 lightSphere = texelFetch(u_lightData, 2 * lightIndex);
+		vec4 lightColor = vec4(texelFetch(u_lightData, 2 * lightIndex + 1).rgb, 1.0);
+
+		vec3 lightVec = position.xyz - lightSphere.xyz;
+		float len = length(lightVec);
+		lightVec = lightVec / max(len, 0.0001);
+		vec3 reflectLight = normalize(reflect(lightVec, normal));
+
+		// windowed falloff, reaches zero at the light radius
+		float attenuation = clamp(1.0 - pow(len / lightSphere.w, 4.0), 0.0, 1.0);
+		attenuation *= attenuation;
+
+		vec4 diffColor = diffMatColor * lightColor * attenuation * max(0.0, dot(normal, -lightVec));
+		resultColor += diffColor;
+		vec4 specularColor = lightColor * attenuation * pow(max(0.0, dot(reflectLight, -eyeVec)), specularFactor);
+		resultColor += specularColor * vec4(material.specularColor, 1.0);
+	}
+
+	return resultColor;
+}
@@ -0,0 +1,105 @@
+#include "LinearArena.h"
+#include <stdint.h>
+#include <new>
+
+/*
+Description:
+	This function is a constructor, no memory is allocated until the first allocation;
+Input:
+	@ int blockSize: the default size of a block in bytes;
+*/
+LinearArena::LinearArena(int blockSize) :
+	current(0), end(0), blockSize(qMax(blockSize, 1024)), firstBlockSize(0), usedBytes(0) {
+}
+
+/*
+Description:
+	This function is a destructor, all the blocks are freed at once;
+Input:
+	@ void patameter: void;
+*/
+LinearArena::~LinearArena() {
+	for (int i = 0; i < blocks.size(); i++)
+		::operator delete(blocks[i]);
+}
+
+/*
+Description:
+	This function is used to allocate memory from the current block, a new block is only added when the current one is full;
+Input:
+	@ size_t size: the size in bytes;
+	@ size_t alignment: the alignment in bytes, a power of two;
+Output:
+	@ void* returnValue: the memory;
+*/
+void* LinearArena::allocate(size_t size, size_t alignment) {
+	uintptr_t address = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (current == 0 || address + size > reinterpret_cast<uintptr_t>(end)) {
+		addBlock(qMax(blockSize, size + alignment));
+		address = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+
+	current = reinterpret_cast<char*>(address + size);
+	usedBytes += size;
+	return reinterpret_cast<void*>(address);
+}
+
+/*
+Description:
+	This function is used to free everything allocated from the arena, the first block is kept for the next use;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void LinearArena::reset() {
+	for (int i = 1; i < blocks.size(); i++)
+		::operator delete(blocks[i]);
+	if (blocks.size() > 1)
+		blocks.resize(1);
+
+	current = blocks.isEmpty() ? 0 : blocks[0];
+	end = blocks.isEmpty() ? 0 : blocks[0] + firstBlockSize;
+	usedBytes = 0;
+}
+
+/*
+Description:
+	This function is used to get the amount of bytes allocated from the arena since the last reset;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 LinearArena::getUsedBytes() const {
+	return usedBytes;
+}
+
+/*
+Description:
+	This function is used to get the amount of blocks held by the arena;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of blocks;
+*/
+int LinearArena::getBlockCount() const {
+	return blocks.size();
+}
+
+/*
+Description:
+	This function is used to add a block and make it the current one;
+Input:
+	@ size_t size: the size of the block in bytes;
+Output:
+	@ void returnValue: void;
+*/
+void LinearArena::addBlock(size_t size) {
+	char* block = static_cast<char*>(::operator new(size));
+	if (blocks.isEmpty())
+		firstBlockSize = size;
+	blocks.append(block);
+	current = block;
+	end = block + size;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <qglobal.h>
+#include <qvector.h>
+#include <stddef.h>
+
+// a bump allocator for short-lived scratch data, nothing is freed on its own, everything is freed at once by reset or by the destructor
+class LinearArena {
+public:
+	LinearArena(int blockSize = 64 * 1024);
+	~LinearArena();
+	void* allocate(size_t size, size_t alignment = alignof(max_align_t));
+	template<typename T> T* allocateArray(int count);
+	void reset();
+	qint64 getUsedBytes() const;
+	int getBlockCount() const;
+
+private:
+	Q_DISABLE_COPY(LinearArena)
+
+	void addBlock(size_t size);
+
+	QVector<char*> blocks;
+	char* current;
+	char* end;
+	size_t blockSize;
+	size_t firstBlockSize;
+	qint64 usedBytes;
+};
+
+/*
+Description:
+	This function is used to allocate an uninitialized array from the arena, it is only meant for types that need no destructor;
+Input:
+	@ int count: the amount of elements;
+Output:
+	@ T* returnValue: the array;
+*/
+template<typename T>
+T* LinearArena::allocateArray(int count) {
+	return static_cast<T*>(allocate(qMax(count, 1) * sizeof(T), alignof(T)));
+}
@@ -1,4 +1,5 @@
 #include "Material.h"
+#include <qcryptographichash.h>
 
 /*
 Description:
@@ -6,7 +7,8 @@ Description:
 Input:
 	@ void parameter: void;
 */
-Material::Material() {
+Material::Material() :
+	shinnes(0.0f) {
 }
 
 /*
@@ -138,6 +140,25 @@ const float Material::getShinnes() const {
 	return shinnes;
 }
 
+/*
+Description:
+	This function is used to hash the content of an image, images of other sizes or formats never share a hash, and only the pixels of each scan line are hashed, not the padding after them, which is never initialized;
+Input:
+	@ const QImage& image: the image;
+Output:
+	@ QByteArray returnValue: the SHA-1 hash;
+*/
+static QByteArray hashImage(const QImage& image) {
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	qint32 header[3] = { image.width(), image.height(), (qint32)image.format() };
+	hash.addData(reinterpret_cast<const char*>(header), sizeof(header));
+
+	int lineBytes = (image.width() * image.depth() + 7) / 8;
+	for (int y = 0; y < image.height(); y++)
+		hash.addData(reinterpret_cast<const char*>(image.constScanLine(y)), lineBytes);
+	return hash.result();
+}
+
 /*
 Description:
 	This function is used to set texture for material using an image from path;
@@ -149,6 +170,9 @@ Output:
 void Material::setDiffuseMap(const QString& fileName) {
 	this->diffuseMap = QImage(fileName);
 	this->usingDiffuseMap = true;
+	this->diffuseMapKey = hashImage(diffuseMap);
+	this->shaderFeatures = QStringList() << "DIFFUSE_MAP";
+	this->shaderFeatureMask = DiffuseMapFeature;
 }
 
 /*
@@ -162,6 +186,9 @@ Output:
 void Material::setDiffuseMap(const QImage& image) {
 	diffuseMap = image;
 	this->usingDiffuseMap = true;
+	this->diffuseMapKey = hashImage(diffuseMap);
+	this->shaderFeatures = QStringList() << "DIFFUSE_MAP";
+	this->shaderFeatureMask = DiffuseMapFeature;
 }
 
 /*
@@ -187,3 +214,60 @@ Output:
 const bool Material::isUsingDiffuseMap() const {
 	return usingDiffuseMap;
 }
+
+/*
+Description:
+	This function is used to get the shader features required by the material, each one selects a compile-time variant of the object shader;
+Input:
+	@ void parameter: void;
+Output:
+	@ const QStringList& returnValue: the shader features, sorted;
+*/
+const QStringList& Material::getShaderFeatures() const {
+	return shaderFeatures;
+}
+
+/*
+Description:
+	This function is used to get the shader features required by the material as a bitmask, see Material::ShaderFeature;
+Input:
+	@ void parameter: void;
+Output:
+	@ quint32 returnValue: the shader features, one bit each;
+*/
+quint32 Material::getShaderFeatureMask() const {
+	return shaderFeatureMask;
+}
+
+/*
+Description:
+	This function is used to get the hash of the pixels of the diffuse map;
+Input:
+	@ void parameter: void;
+Output:
+	@ const QByteArray& returnValue: the hash, empty without a diffuse map;
+*/
+const QByteArray& Material::getDiffuseMapKey() const {
+	return diffuseMapKey;
+}
+
+/*
+Description:
+	This function is used to get a hash of everything that affects the look of the material, materials with the same key are interchangeable, the name is not part of it;
+Input:
+	@ void parameter: void;
+Output:
+	@ QByteArray returnValue: the hash;
+*/
+QByteArray Material::getContentKey() const {
+	const float values[] = {
+		diffuseColor.x(), diffuseColor.y(), diffuseColor.z(),
+		ambienceColor.x(), ambienceColor.y(), ambienceColor.z(),
+		specularColor.x(), specularColor.y(), specularColor.z(),
+		shinnes, usingDiffuseMap ? 1.0f : 0.0f };
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(reinterpret_cast<const char*>(values), sizeof(values));
+	hash.addData(diffuseMapKey);
+	return hash.result();
+}
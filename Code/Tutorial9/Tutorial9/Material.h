@@ -2,9 +2,17 @@
 #include <qstring>
 #include <qvector3d.h>
 #include <qimage.h>
+#include <qstringlist.h>
+#include <qbytearray.h>
+#include "ObjectPool.h"
 
-class Material {
+class Material : public PoolAllocated<Material> {
 public:
+	// one bit per shader feature, so that a draw can be sorted or bucketed by its features without comparing strings
+	enum ShaderFeature {
+		DiffuseMapFeature = 1
+	};
+
 	Material();
 	~Material();
 
@@ -22,6 +30,10 @@ public:
 	void setDiffuseMap(const QImage& image);
 	const QImage& getDiffuseMap() const;
 	const bool isUsingDiffuseMap() const;
+	const QStringList& getShaderFeatures() const;
+	quint32 getShaderFeatureMask() const;
+	const QByteArray& getDiffuseMapKey() const;
+	QByteArray getContentKey() const;
 
 private:
 	QString materialName;
@@ -30,6 +42,11 @@ private:
 	QVector3D specularColor;
 	float shinnes;
 	QImage diffuseMap;
+	// a hash of the pixels of the diffuse map, identical images share one texture
+	QByteArray diffuseMapKey;
 	bool usingDiffuseMap = false;
+	// the features are kept sorted and only rebuilt when the diffuse map changes, drawing does not allocate a list
+	QStringList shaderFeatures;
+	quint32 shaderFeatureMask = 0;
 };
 
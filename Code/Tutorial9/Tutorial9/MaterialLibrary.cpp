@@ -1,4 +1,5 @@
 #include "MaterialLibrary.h"
+#include "JobSystem.h"
 
 /*
 Description:
@@ -11,23 +12,70 @@ MaterialLibrary::MaterialLibrary() {
 
 /*
 Description:
-	This function is used to add material to the material list;
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+MaterialLibrary::~MaterialLibrary() {
+	clear();
+}
+
+/*
+Description:
+	This function is used to add material to the material list, the library takes the ownership of the material, a material already in the list is not added again;
+	the material is shared through the resource cache, so an identical material replaces it and the given pointer must not be used afterwards, use the returned handle instead;
+	the material is found by the name it has when it is added;
 Input:
 	@ Material * mateiral: a given material;
 Output:
-	@ void returnValue: void;
+	@ SlotHandle returnValue: the handle of the material;
 */
-void MaterialLibrary::addMaterial(Material* material) {
+SlotHandle MaterialLibrary::addMaterial(Material* material) {
 
-	if (!material) return;
+	if (!material) return SlotHandle();
 
-	for (int i = 0; i < materials.size(); i++) {
-		if (materials[i] == material) {
-			return;
-		}
+	QHash<Material*, SlotHandle>::const_iterator found = materialHandles.constFind(material);
+	if (found != materialHandles.constEnd()) return found.value();
+
+	QString materialName = material->getMaterialName();
+	Material* shared = ResourceCache::getDefault()->acquireMaterial(material);
+
+	// an identical material in the list already holds a reference, it is only found by one more name
+	found = materialHandles.constFind(shared);
+	if (found != materialHandles.constEnd()) {
+		ResourceCache::getDefault()->releaseMaterial(shared);
+		materialNames.insert(materialName, found.value());
+		return found.value();
 	}
 
-	materials.append(material);
+	SlotHandle handle = materials.insert(shared);
+	materialHandles.insert(shared, handle);
+	materialNames.insert(materialName, handle);
+	return handle;
+}
+
+/*
+Description:
+	This function is used to delete a material by its handle, the reference of the library is dropped, a stale handle is ignored;
+Input:
+	@ const SlotHandle& handle: the handle of the material;
+Output:
+	@ void returnValue: void;
+*/
+void MaterialLibrary::delMaterial(const SlotHandle& handle) {
+	Material* const* material = materials.get(handle);
+	if (!material) return;
+
+	Material* removed = *material;
+	materials.remove(handle);
+	materialHandles.remove(removed);
+	for (QHash<QString, SlotHandle>::iterator i = materialNames.begin(); i != materialNames.end();) {
+		if (i.value() == handle)
+			i = materialNames.erase(i);
+		else
+			++i;
+	}
+	ResourceCache::getDefault()->releaseMaterial(removed);
 }
 
 /*
@@ -39,7 +87,7 @@ Output:
 	@ Material * returnValue: a material;
 */
 Material* MaterialLibrary::getMaterial(int index) {
-	if (index < materials.size()) {
+	if (index >= 0 && index < materials.size()) {
 		return materials[index];
 	}
 	else {
@@ -56,12 +104,20 @@ Output:
 	@ Material * returnValue: a material;
 */
 Material* MaterialLibrary::getMaterial(const QString& materialName) {
-	for (int i = 0; i < materials.size(); i++) {
-		if (materials[i]->getMaterialName() == materialName) {
-			return materials[i];
-		}
-	}
-	return 0;
+	return getMaterial(materialNames.value(materialName));
+}
+
+/*
+Description:
+	This function is used to get material by its handle;
+Input:
+	@ const SlotHandle& handle: the handle of the material;
+Output:
+	@ Material * returnValue: a material, 0 if the handle is stale;
+*/
+Material* MaterialLibrary::getMaterial(const SlotHandle& handle) {
+	Material* const* material = materials.get(handle);
+	return material ? *material : 0;
 }
 
 /*
@@ -76,6 +132,22 @@ int MaterialLibrary::getCount() {
 	return materials.size();
 }
 
+/*
+Description:
+	This function is used to drop the references to all the materials;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void MaterialLibrary::clear() {
+	for (int i = 0; i < materials.size(); i++)
+		ResourceCache::getDefault()->releaseMaterial(materials[i]);
+	materials.clear();
+	materialHandles.clear();
+	materialNames.clear();
+}
+
 /*
 Description:
 	This function is used to load .mtl file froma given file path, the .mtl file should include
@@ -92,22 +164,23 @@ void MaterialLibrary::loadMaterialFromFile(const QString& fileName) {
 		return;
 	}
 
-	for (int i = 0; i < materials.size(); i++)
-		delete materials[i];
-	materials.clear();
+	clear();
 
 	QFileInfo fileInfo(fileName);
 	QTextStream inputStream(&materialFile);
 
 	Material* material = 0;
+	QVector<Material*> materials;
+	QStringList diffuseMaps;
 
 	while (!inputStream.atEnd()) {
 		QString line = inputStream.readLine();
 		QStringList list = line.split(" ");
 		if (list[0] == "newmtl") {
-			addMaterial(material);
 			material = new Material();
 			material->setMaterialName(list[1]);
+			materials.append(material);
+			diffuseMaps.append(QString());
 		}
 		else if (list[0] == "Ns") {
 			material->setShinnes(list[1].toFloat());
@@ -122,9 +195,21 @@ void MaterialLibrary::loadMaterialFromFile(const QString& fileName) {
 			material->setSpecularColor(QVector3D(list[1].toFloat(), list[2].toFloat(), list[3].toFloat()));
 		}
 		else if (list[0] == "map_Kd") {
-			material->setDiffuseMap(QString("%1/%2").arg(fileInfo.absolutePath()).arg(list[1]));
+			diffuseMaps.last() = QString("%1/%2").arg(fileInfo.absolutePath()).arg(list[1]);
 		}
 	}
 
-	addMaterial(material);
+	// the diffuse maps are decoded on the job system at once, the materials can only be shared after, since they are compared by content
+	JobSystem* jobSystem = JobSystem::getDefault();
+	JobCounter decoded;
+	for (int i = 0; i < materials.size(); i++) {
+		if (diffuseMaps[i].isEmpty()) continue;
+		Material* target = materials[i];
+		QString diffuseMap = diffuseMaps[i];
+		jobSystem->run([target, diffuseMap]() { target->setDiffuseMap(diffuseMap); }, &decoded);
+	}
+	jobSystem->wait(&decoded);
+
+	for (int i = 0; i < materials.size(); i++)
+		addMaterial(materials[i]);
 }
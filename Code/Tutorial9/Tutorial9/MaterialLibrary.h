@@ -4,17 +4,28 @@
 #include <qfile.h>
 #include <qtextstream.h>
 #include <qfileinfo.h>
+#include <qhash.h>
+#include "SlotMap.h"
+#include "ResourceCache.h"
 
 class MaterialLibrary {
 public:
 	MaterialLibrary();
-	void addMaterial(Material* material);
+	~MaterialLibrary();
+	SlotHandle addMaterial(Material* material);
+	void delMaterial(const SlotHandle& handle);
 	Material* getMaterial(int index);
 	Material* getMaterial(const QString &materialName);
+	Material* getMaterial(const SlotHandle& handle);
 	int getCount();
 	void loadMaterialFromFile(const QString& fileName);
 
 private:
-	QVector<Material*> materials;
+	void clear();
+
+	// the library holds a reference to each of its materials in the resource cache, materials are found by pointer and by name in constant time, identical materials share one entry
+	SlotMap<Material*> materials;
+	QHash<Material*, SlotHandle> materialHandles;
+	QHash<QString, SlotHandle> materialNames;
 };
 
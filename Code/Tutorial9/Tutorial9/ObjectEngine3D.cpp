@@ -1,4 +1,8 @@
 #include "ObjectEngine3D.h"
+#include "LinearArena.h"
+#include "JobSystem.h"
+#include "CommandBuffer.h"
+#include <math.h>
 
 /*
 Description:
@@ -16,6 +20,150 @@ Input:
 	@ void patameter: void;
 */
 ObjectEngine3D::~ObjectEngine3D() {
+	for (int i = 0; i < objects.size(); i++)
+		delete objects[i];
+}
+
+/*
+Description:
+	This function is used to find the end of a line of the .obj file;
+Input:
+	@ const char* p: the start of the line;
+	@ const char* end: the end of the file;
+Output:
+	@ const char* returnValue: the line break ending the line, or the end of the file;
+*/
+static const char* findLineEnd(const char* p, const char* end) {
+	while (p < end && *p != '\n') p++;
+	return p;
+}
+
+/*
+Description:
+	This function is used to skip the spaces before a token;
+Input:
+	@ const char* p: the current position;
+	@ const char* end: the end of the line;
+Output:
+	@ const char* returnValue: the first character that is not a space;
+*/
+static const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+/*
+Description:
+	This function is used to skip a token;
+Input:
+	@ const char* p: the start of the token;
+	@ const char* end: the end of the line;
+Output:
+	@ const char* returnValue: the first space after the token, or the end of the line;
+*/
+static const char* skipToken(const char* p, const char* end) {
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+	return p;
+}
+
+/*
+Description:
+	This function is used to compare a token with a keyword without building a string;
+Input:
+	@ const char* token: the start of the token;
+	@ const char* tokenEnd: the end of the token;
+	@ const char* keyword: the keyword;
+Output:
+	@ bool returnValue: true if the token is the keyword;
+*/
+static bool isKeyword(const char* token, const char* tokenEnd, const char* keyword) {
+	while (token < tokenEnd && *keyword && *token == *keyword) {
+		token++;
+		keyword++;
+	}
+	return token == tokenEnd && *keyword == 0;
+}
+
+/*
+Description:
+	This function is used to parse a floating point number in place, the C locale is always used;
+Input:
+	@ const char*& p: the current position, moved past the number;
+	@ const char* end: the end of the line;
+Output:
+	@ float returnValue: the number, 0 if the line has no more numbers;
+*/
+static float parseFloat(const char*& p, const char* end) {
+	p = skipSpaces(p, end);
+	double sign = 1.0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		if (*p == '-') sign = -1.0;
+		p++;
+	}
+
+	double value = 0.0;
+	while (p < end && *p >= '0' && *p <= '9') value = value * 10.0 + (*p++ - '0');
+	if (p < end && *p == '.') {
+		p++;
+		double scale = 0.1;
+		for (; p < end && *p >= '0' && *p <= '9'; scale *= 0.1) value += (*p++ - '0') * scale;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		int exponentSign = 1, exponent = 0;
+		if (p < end && (*p == '-' || *p == '+')) {
+			if (*p == '-') exponentSign = -1;
+			p++;
+		}
+		while (p < end && *p >= '0' && *p <= '9') exponent = exponent * 10 + (*p++ - '0');
+		value *= pow(10.0, exponentSign * exponent);
+	}
+	return float(sign * value);
+}
+
+/*
+Description:
+	This function is used to parse a vertex index of a face in place, indices start at 1 and negative ones count back from the last record;
+Input:
+	@ const char*& p: the current position, moved past the index;
+	@ const char* end: the end of the line;
+	@ int count: the amount of records read so far;
+Output:
+	@ int returnValue: the index starting at 0, -1 if it is missing or out of range;
+*/
+static int parseIndex(const char*& p, const char* end, int count) {
+	bool negative = p < end && *p == '-';
+	if (negative) p++;
+
+	int index = 0;
+	bool found = false;
+	for (; p < end && *p >= '0' && *p <= '9'; found = true) index = index * 10 + (*p++ - '0');
+	if (!found) return -1;
+
+	index = negative ? count - index : index - 1;
+	return index >= 0 && index < count ? index : -1;
+}
+
+/*
+Description:
+	This function is used to parse the numbers of vertex records, f. ex. [v] or [vt], on the job system, every record is written to its own place, so the ranges are independent;
+Input:
+	@ const QVector<const char*>& records: the first character after the keyword of each record;
+	@ const char* end: the end of the file content;
+	@ int components: the amount of numbers of each record;
+	@ float* values: the numbers, components per record;
+Output:
+	@ void returnValue: void;
+*/
+static void parseRecords(const QVector<const char*>& records, const char* end, int components, float* values) {
+	const int grainSize = 4096;
+	JobSystem::getDefault()->parallelFor(0, records.size(), grainSize, [&records, end, components, values](int first, int last) {
+		for (int i = first; i < last; i++) {
+			const char* p = records[i];
+			const char* lineEnd = findLineEnd(p, end);
+			for (int k = 0; k < components; k++) values[i * components + k] = parseFloat(p, lineEnd);
+		}
+	});
 }
 
 /*
@@ -29,76 +177,164 @@ Output:
 */
 void ObjectEngine3D::loadObjectFromFile(const QString& fileName) {
 	QFile objFile(fileName);
-	if (!objFile.exists()) {
+	if (!objFile.open(QIODevice::ReadOnly)) {
 		return;
 	}
 
-	QVector<QVector3D> verCoords;
-	QVector<QVector2D> texCoords;
-	QVector<QVector3D> normals;
+	// the file is read at once and parsed in place, no string is built per line
+	const QByteArray content = objFile.readAll();
+	objFile.close();
+	const char* begin = content.constData();
+	const char* end = begin + content.size();
+
+	// a first pass finds the vertex records and counts the face corners, so that the scratch arrays and the vertex arrays are allocated once
+	QVector<const char*> verCoordRecords, texCoordRecords, normalRecords;
+	int cornerCount = 0;
+	for (const char* line = begin; line < end;) {
+		const char* lineEnd = findLineEnd(line, end);
+		const char* key = skipSpaces(line, lineEnd);
+		const char* keyEnd = skipToken(key, lineEnd);
+		if (isKeyword(key, keyEnd, "v")) verCoordRecords.append(keyEnd);
+		else if (isKeyword(key, keyEnd, "vt")) texCoordRecords.append(keyEnd);
+		else if (isKeyword(key, keyEnd, "vn")) normalRecords.append(keyEnd);
+		else if (isKeyword(key, keyEnd, "f")) {
+			int fieldCount = 0;
+			for (const char* p = skipSpaces(keyEnd, lineEnd); p < lineEnd; p = skipSpaces(skipToken(p, lineEnd), lineEnd))
+				fieldCount++;
+			if (fieldCount >= 3) cornerCount += 3 * (fieldCount - 2);
+		}
+		line = lineEnd + 1;
+	}
+
+	// the coordinates only live while the file is parsed, they are freed with the arena in one shot
+	LinearArena arena;
+	float* verCoords = arena.allocateArray<float>(verCoordRecords.size() * 3);
+	float* texCoords = arena.allocateArray<float>(texCoordRecords.size() * 2);
+	float* normals = arena.allocateArray<float>(normalRecords.size() * 3);
+
+	// the numbers of the three kinds of records are parsed at the same time, each kind split across the job system
+	JobSystem* jobSystem = JobSystem::getDefault();
+	JobCounter parsed;
+	jobSystem->run([&verCoordRecords, end, verCoords]() { parseRecords(verCoordRecords, end, 3, verCoords); }, &parsed);
+	jobSystem->run([&texCoordRecords, end, texCoords]() { parseRecords(texCoordRecords, end, 2, texCoords); }, &parsed);
+	jobSystem->run([&normalRecords, end, normals]() { parseRecords(normalRecords, end, 3, normals); }, &parsed);
+	jobSystem->wait(&parsed);
+
+	// the faces refer to the records read so far, so they are assembled in file order
+	int verCoordIndex = 0, texCoordIndex = 0, normalIndex = 0;
+
 	QVector<Vertex> vertices;
 	QVector<GLuint> indices;
+	vertices.reserve(cornerCount);
+	indices.reserve(cornerCount);
 	SimpleObject3D* object = 0;
-
-	objFile.open(QIODevice::ReadOnly);
-	QTextStream input(&objFile);
 	QString materialName;
 
-	while (!input.atEnd()) {
-		QString line = input.readLine();
-		QStringList list = line.split(" ");
-		if (list[0] == "#") {
+	for (const char* line = begin; line < end;) {
+		const char* lineEnd = findLineEnd(line, end);
+		const char* key = skipSpaces(line, lineEnd);
+		const char* keyEnd = skipToken(key, lineEnd);
+		const char* p = keyEnd;
 
+		if (isKeyword(key, keyEnd, "v")) {
+			verCoordIndex++;
 		}
-		else if (list[0] == "mtllib") {
-			QFileInfo info(fileName);
-			materials.loadMaterialFromFile(QString("%1/%2").arg(info.absolutePath()).arg(list[1]));
-		}
-		else if (list[0] == "v") {
-			verCoords << QVector3D(list[1].toFloat(), list[2].toFloat(), list[3].toFloat());
-		}
-		else if (list[0] == "vt") {
-			texCoords << QVector2D(list[1].toFloat(), list[2].toFloat());
+		else if (isKeyword(key, keyEnd, "vt")) {
+			texCoordIndex++;
 		}
-		else if (list[0] == "vn") {
-			normals << QVector3D(list[1].toFloat(), list[2].toFloat(), list[3].toFloat());
+		else if (isKeyword(key, keyEnd, "vn")) {
+			normalIndex++;
 		}
-		else if (list[0] == "f") {
-			for (int i = 1; i <= 3; i++) {
-				QStringList v = list[i].split("/");
-				vertices.append(Vertex(verCoords[v[0].toLong() - 1], texCoords[v[1].toLong() - 1], normals[v[2].toLong() - 1]));
-				indices.append(indices.size());
+		else if (isKeyword(key, keyEnd, "f")) {
+			// polygons are split into a fan of triangles
+			Vertex first, previous;
+			int corner = 0;
+			for (p = skipSpaces(p, lineEnd); p < lineEnd; p = skipSpaces(p, lineEnd), corner++) {
+				int v = parseIndex(p, lineEnd, verCoordIndex), vt = -1, vn = -1;
+				if (p < lineEnd && *p == '/') {
+					p++;
+					vt = parseIndex(p, lineEnd, texCoordIndex);
+					if (p < lineEnd && *p == '/') {
+						p++;
+						vn = parseIndex(p, lineEnd, normalIndex);
+					}
+				}
+				p = skipToken(p, lineEnd);
+
+				Vertex vertex(
+					v >= 0 ? QVector3D(verCoords[v * 3], verCoords[v * 3 + 1], verCoords[v * 3 + 2]) : QVector3D(),
+					vt >= 0 ? QVector2D(texCoords[vt * 2], texCoords[vt * 2 + 1]) : QVector2D(),
+					vn >= 0 ? QVector3D(normals[vn * 3], normals[vn * 3 + 1], normals[vn * 3 + 2]) : QVector3D());
+
+				if (corner == 0) first = vertex;
+				else if (corner >= 2) {
+					vertices.append(first);
+					vertices.append(previous);
+					vertices.append(vertex);
+					for (int i = 0; i < 3; i++) indices.append(indices.size());
+				}
+				previous = vertex;
 			}
 		}
-		else if (list[0] == "usemtl") {
+		else if (isKeyword(key, keyEnd, "mtllib")) {
+			p = skipSpaces(p, lineEnd);
+			QFileInfo info(fileName);
+			materials.loadMaterialFromFile(QString("%1/%2").arg(info.absolutePath()).arg(QString::fromUtf8(p, skipToken(p, lineEnd) - p)));
+		}
+		else if (isKeyword(key, keyEnd, "usemtl")) {
+			// each material starts a new object, the arrays keep their capacity for the next one
 			if (object) object->init(vertices, indices, materials.getMaterial(materialName));
-			materialName = list[1];
+			vertices.clear();
+			indices.clear();
+			p = skipSpaces(p, lineEnd);
+			materialName = QString::fromUtf8(p, skipToken(p, lineEnd) - p);
 			addObject(object);
 			object = new SimpleObject3D;
 		}
+		line = lineEnd + 1;
 	}
 
 	if (object) object->init(vertices, indices, materials.getMaterial(materialName));
 	addObject(object);
-	
-	objFile.close();
 }
 
 /*
 Description:
-	This function is used to append an object to the end of the object list;
+	This function is used to append an object to the end of the object list, the object engine takes the ownership of the object, an object already in the list is not added again;
 Input:
 	@ Object3D * object: the object;
+Output:
+	@ SlotHandle returnValue: the handle of the object;
+*/
+SlotHandle ObjectEngine3D::addObject(SimpleObject3D* object) {
+	if (!object) return SlotHandle();
+
+	QHash<SimpleObject3D*, SlotHandle>::const_iterator found = objectHandles.constFind(object);
+	if (found != objectHandles.constEnd()) return found.value();
+
+	SlotHandle handle = objects.insert(object);
+	objectHandles.insert(object, handle);
+	object->setParentTransform(&transform);
+	object->setAnimation(animation);
+	return handle;
+}
+
+/*
+Description:
+	This function is used to delete an object by its handle, the object is destroyed, a stale handle is ignored;
+Input:
+	@ const SlotHandle& handle: the handle of the object;
 Output:
 	@ void returnValue: void;
 */
-void ObjectEngine3D::addObject(SimpleObject3D* object) {
+void ObjectEngine3D::delObject(const SlotHandle& handle) {
+	SimpleObject3D* const* object = objects.get(handle);
 	if (!object) return;
-	for (int i = 0; i < objects.size(); i++) {
-		if (objects[i] == object)
-			return;
-	}
-	objects.append(object);
+
+	SimpleObject3D* removed = *object;
+	objects.remove(handle);
+	objectHandles.remove(removed);
+	delete removed;
 }
 
 /*
@@ -110,7 +346,7 @@ Output:
 	@ const int returnValue: a pointer to an object;
 */
 SimpleObject3D* ObjectEngine3D::getObject(int index) {
-	if (index < objects.size()) {
+	if (index >= 0 && index < objects.size()) {
 		return objects[index];
 	}
 	else {
@@ -120,54 +356,125 @@ SimpleObject3D* ObjectEngine3D::getObject(int index) {
 
 /*
 Description:
-	This function is used to rotate objects defined in the object engine, which calls Object3D::rotate(const QQuaternion&);
+	This function is used to get an object by its handle;
+Input:
+	@ const SlotHandle& handle: the handle of the object;
+Output:
+	@ SimpleObject3D* returnValue: the object, 0 if the handle is stale;
+*/
+SimpleObject3D* ObjectEngine3D::getObject(const SlotHandle& handle) {
+	SimpleObject3D* const* object = objects.get(handle);
+	return object ? *object : 0;
+}
+
+/*
+Description:
+	This function is used to get total amount of objects in the object engine;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the total amount of objects;
+*/
+int ObjectEngine3D::getCount() const {
+	return objects.size();
+}
+
+/*
+Description:
+	This function is used to get the material library of the object engine, materials added to it are owned by the object engine;
+Input:
+	@ void parameter: void;
+Output:
+	@ MaterialLibrary* returnValue: the material library;
+*/
+MaterialLibrary* ObjectEngine3D::getMaterialLibrary() {
+	return &materials;
+}
+
+/*
+Description:
+	This function is used to rotate objects defined in the object engine, the objects are attached to the transform of the object engine;
 Input:
 	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
 Output:
 	@ void returnValue: void;
 */
 void ObjectEngine3D::rotate(const QQuaternion& r) {
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->rotate(r);
+	transform.rotate(r);
 }
 
 /*
 Description:
-	This function is used to translate objects defined in the object engine, which calls Object3D::translate(const QVector3D&);
+	This function is used to translate objects defined in the object engine, the objects are attached to the transform of the object engine;
 Input:
 	@ const QVector3D& t: a translation vector;
 Output:
 	@ void returnValue: void;
 */
 void ObjectEngine3D::translate(const QVector3D& t) {
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->translate(t);
+	transform.translate(t);
 }
 
 /*
 Description:
-	This function is used to scale objects defined in the object engine, which calls Object3D::scale(const float&);
+	This function is used to scale objects defined in the object engine, the objects are attached to the transform of the object engine;
 Input:
 	@ const float& s: a scalar;
 Output:
 	@ void returnValue: void;
 */
 void ObjectEngine3D::scale(const float& s) {
-	for (int i = 0; i < objects.size(); i++)
-		objects[i]->scale(s);
+	transform.scale(s);
 }
 
 /*
 Description:
-	This function is used to set the global transform objects defined in the object engine, which calls Object3D::setGlobalTransform(const QMatrix4x4&);
+	This function is used to set the global transform for the object engine, which is used while the object engine has no parent;
 Input:
 	@ const QMatrix4x4& g: a global transformation;
 Output:
 	@ void returnValue: void;
 */
 void ObjectEngine3D::setGlobalTransform(const QMatrix4x4& g) {
+	transform.setGlobalTransform(g);
+}
+
+/*
+Description:
+	This function is used to attach the object engine to the transform of its parent, so that its world matrix follows the parent;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::setParentTransform(Transform3D* parent) {
+	transform.setParent(parent);
+}
+
+/*
+Description:
+	This function is used to set the procedural animation of all the objects in the object engine, including the objects added later;
+Input:
+	@ const Animation3D& animation: the animation;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::setAnimation(const Animation3D& animation) {
+	this->animation = animation;
 	for (int i = 0; i < objects.size(); i++)
-		objects[i]->setGlobalTransform(g);
+		objects[i]->setAnimation(animation);
+}
+
+/*
+Description:
+	This function is used to get the procedural animation set for all the objects in the object engine;
+Input:
+	@ void parameter: void;
+Output:
+	@ const Animation3D& returnValue: the animation;
+*/
+const Animation3D& ObjectEngine3D::getAnimation() const {
+	return animation;
 }
 
 /*
@@ -182,4 +489,81 @@ Output:
 void ObjectEngine3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
 	for (int i = 0; i < objects.size(); i++)
 		objects[i]->draw(shaderProgram, functions);
-}
\ No newline at end of file
+}
+
+/*
+Description:
+	This function is used to draw the depth of objects defined in the object engine, which calls Object3D::drawDepth(QOpenGLShaderProgram*, QOpenGLFunctions*);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	for (int i = 0; i < objects.size(); i++)
+		objects[i]->drawDepth(shaderProgram, functions);
+}
+
+/*
+Description:
+	This function is used to draw a number of instances of objects defined in the object engine at once, which calls Transformational::drawInstanced(QOpenGLShaderProgram*, QOpenGLFunctions*, int);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	for (int i = 0; i < objects.size(); i++)
+		objects[i]->drawInstanced(shaderProgram, functions, instanceCount);
+}
+
+/*
+Description:
+	This function is used to draw the depth of a number of instances of objects defined in the object engine at once, which calls Transformational::drawDepthInstanced(QOpenGLShaderProgram*, QOpenGLFunctions*, int);
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	for (int i = 0; i < objects.size(); i++)
+		objects[i]->drawDepthInstanced(shaderProgram, functions, instanceCount);
+}
+
+/*
+Description:
+	This function is used to record the draws of objects defined in the object engine, the objects are recorded in parallel on the job system of the command buffer;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::record(CommandBuffer* commands) {
+	const int grainSize = 16;
+	commands->getJobSystem()->parallelFor(0, objects.size(), grainSize, [this, commands](int first, int last) {
+		for (int i = first; i < last; i++)
+			objects[i]->record(commands);
+	});
+}
+
+/*
+Description:
+	This function is used to record the draws of a number of instances of objects defined in the object engine, the objects are recorded in parallel on the job system of the command buffer;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+	@ Prefab3D* prefab: the prefab whose instance matrices are bound;
+Output:
+	@ void returnValue: void;
+*/
+void ObjectEngine3D::recordInstanced(CommandBuffer* commands, Prefab3D* prefab) {
+	const int grainSize = 16;
+	commands->getJobSystem()->parallelFor(0, objects.size(), grainSize, [this, commands, prefab](int first, int last) {
+		for (int i = first; i < last; i++)
+			objects[i]->recordInstanced(commands, prefab);
+	});
+}
@@ -1,24 +1,43 @@
 #pragma once
 #include "SimpleObject3D.h"
 #include "MaterialLibrary.h"
+#include "SlotMap.h"
+#include "ObjectPool.h"
+#include <qhash.h>
 
 
-class ObjectEngine3D : public Transformational {
+class ObjectEngine3D : public Transformational, public PoolAllocated<ObjectEngine3D> {
 public:
 	ObjectEngine3D();
 	~ObjectEngine3D();
 	void loadObjectFromFile(const QString& fileName);
-	void addObject(SimpleObject3D* object);
+	SlotHandle addObject(SimpleObject3D* object);
+	void delObject(const SlotHandle& handle);
 	SimpleObject3D* getObject(int index);
+	SimpleObject3D* getObject(const SlotHandle& handle);
+	int getCount() const;
+	MaterialLibrary* getMaterialLibrary();
 
 	void rotate(const QQuaternion& r);
 	void translate(const QVector3D& t);
 	void scale(const float& s);
 	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
+	void setAnimation(const Animation3D& animation);
+	const Animation3D& getAnimation() const;
 	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void record(CommandBuffer* commands);
+	void recordInstanced(CommandBuffer* commands, Prefab3D* prefab);
 
 private:
-	QVector<SimpleObject3D*> objects;
+	// the object engine owns its objects and deletes them
+	SlotMap<SimpleObject3D*> objects;
+	QHash<SimpleObject3D*, SlotHandle> objectHandles;
 	MaterialLibrary materials;
+	Transform3D transform;
+	Animation3D animation;
 };
 
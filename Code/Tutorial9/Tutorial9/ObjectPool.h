@@ -0,0 +1,197 @@
+#pragma once
+#include <qglobal.h>
+#include <qvector.h>
+#include <qmutex.h>
+#include <new>
+
+// a fixed-size allocator for one type, objects are carved out of blocks and recycled through a free list
+template<typename T>
+class ObjectPool {
+public:
+	ObjectPool(int blockSize = 256);
+	~ObjectPool();
+	void* allocate();
+	void release(void* pointer);
+	int getLiveCount() const;
+	int getBlockCount() const;
+	qint64 getAllocationCount() const;
+
+	static ObjectPool<T>& getDefault();
+
+private:
+	Q_DISABLE_COPY(ObjectPool)
+
+	union Node {
+		Node* next;
+		alignas(T) char storage[sizeof(T)];
+	};
+
+	QVector<Node*> blocks;
+	Node* freeList;
+	int blockSize;
+	int liveCount;
+	qint64 allocationCount;
+	QMutex mutex;
+};
+
+// a base class that routes new and delete of a class through its default pool
+template<typename T>
+class PoolAllocated {
+public:
+	static void* operator new(size_t size);
+	static void operator delete(void* pointer, size_t size);
+};
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ int blockSize: the amount of objects allocated at once when the pool runs out;
+*/
+template<typename T>
+ObjectPool<T>::ObjectPool(int blockSize) :
+	freeList(0), blockSize(qMax(blockSize, 1)), liveCount(0), allocationCount(0) {
+}
+
+/*
+Description:
+	This function is a destructor, the blocks are freed without destroying the objects still in them;
+Input:
+	@ void patameter: void;
+*/
+template<typename T>
+ObjectPool<T>::~ObjectPool() {
+	for (int i = 0; i < blocks.size(); i++)
+		::operator delete(blocks[i]);
+}
+
+/*
+Description:
+	This function is used to get the memory of one object, a new block is only allocated when the free list is empty;
+Input:
+	@ void parameter: void;
+Output:
+	@ void* returnValue: uninitialized memory for one object;
+*/
+template<typename T>
+void* ObjectPool<T>::allocate() {
+	QMutexLocker locker(&mutex);
+	if (freeList == 0) {
+		Node* block = static_cast<Node*>(::operator new(blockSize * sizeof(Node)));
+		blocks.append(block);
+		allocationCount++;
+		for (int i = 0; i < blockSize; i++) {
+			block[i].next = freeList;
+			freeList = &block[i];
+		}
+	}
+
+	Node* node = freeList;
+	freeList = node->next;
+	liveCount++;
+	return node->storage;
+}
+
+/*
+Description:
+	This function is used to give the memory of one object back to the pool, the object must be destroyed already;
+Input:
+	@ void* pointer: the memory returned by ObjectPool::allocate();
+Output:
+	@ void returnValue: void;
+*/
+template<typename T>
+void ObjectPool<T>::release(void* pointer) {
+	if (pointer == 0) return;
+	QMutexLocker locker(&mutex);
+	Node* node = static_cast<Node*>(pointer);
+	node->next = freeList;
+	freeList = node;
+	liveCount--;
+}
+
+/*
+Description:
+	This function is used to get the amount of objects currently allocated from the pool;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of live objects;
+*/
+template<typename T>
+int ObjectPool<T>::getLiveCount() const {
+	return liveCount;
+}
+
+/*
+Description:
+	This function is used to get the amount of blocks allocated by the pool;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of blocks;
+*/
+template<typename T>
+int ObjectPool<T>::getBlockCount() const {
+	return blocks.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of heap allocations made by the pool, which only grows when a block is added;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of heap allocations;
+*/
+template<typename T>
+qint64 ObjectPool<T>::getAllocationCount() const {
+	return allocationCount;
+}
+
+/*
+Description:
+	This function is used to get the pool shared by all the objects of a type;
+Input:
+	@ void parameter: void;
+Output:
+	@ ObjectPool<T>& returnValue: the default pool;
+*/
+template<typename T>
+ObjectPool<T>& ObjectPool<T>::getDefault() {
+	static ObjectPool<T> pool;
+	return pool;
+}
+
+/*
+Description:
+	This function is used to allocate an object from the default pool of its type, a derived class of another size falls back to the heap;
+Input:
+	@ size_t size: the size of the object;
+Output:
+	@ void* returnValue: uninitialized memory for the object;
+*/
+template<typename T>
+void* PoolAllocated<T>::operator new(size_t size) {
+	if (size != sizeof(T)) return ::operator new(size);
+	return ObjectPool<T>::getDefault().allocate();
+}
+
+/*
+Description:
+	This function is used to give an object back to the default pool of its type;
+Input:
+	@ void* pointer: the object;
+	@ size_t size: the size of the object;
+Output:
+	@ void returnValue: void;
+*/
+template<typename T>
+void PoolAllocated<T>::operator delete(void* pointer, size_t size) {
+	if (size != sizeof(T)) {
+		::operator delete(pointer);
+		return;
+	}
+	ObjectPool<T>::getDefault().release(pointer);
+}
+
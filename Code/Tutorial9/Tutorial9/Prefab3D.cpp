@@ -0,0 +1,454 @@
+#include "Prefab3D.h"
+#include "CommandBuffer.h"
+#include "GLStateCache.h"
+#include <string.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ Transformational* definition: the subtree shared by all the instances, which must not be attached to a parent;
+*/
+Prefab3D::Prefab3D(Transformational* definition) :
+	definition(definition), instancesChanged(false), capacity(0), uploadedCount(0), functions(0), instanceTexture(0) {
+}
+
+/*
+Description:
+	This function is a destructor, the instances are destroyed, the definition is not;
+Input:
+	@ void patameter: void;
+*/
+Prefab3D::~Prefab3D() {
+	for (int i = 0; i < instances.size(); i++)
+		delete instances[i];
+
+	if (functions != 0)
+		functions->glDeleteTextures(1, &instanceTexture);
+	if (instanceBuffer.isCreated())
+		instanceBuffer.destroy();
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to create the buffer texture holding the instance matrices, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::init() {
+	functions = GLStateCache::getDefault()->getFunctions();
+	if (functions == 0) return;
+
+	instanceBuffer.create();
+	instanceBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	functions->glGenTextures(1, &instanceTexture);
+}
+
+/*
+Description:
+	This function is used to create an instance of the prefab, the instance is owned by the prefab and placed by adding it to a group;
+Input:
+	@ void parameter: void;
+Output:
+	@ PrefabInstance3D* returnValue: the instance;
+*/
+PrefabInstance3D* Prefab3D::createInstance() {
+	PrefabInstance3D* instance = new PrefabInstance3D(this);
+	instance->handle = instances.insert(instance);
+	return instance;
+}
+
+/*
+Description:
+	This function is used to destroy an instance of the prefab, the instance must be removed from its group first;
+Input:
+	@ PrefabInstance3D* instance: the instance;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::delInstance(PrefabInstance3D* instance) {
+	if (instance == 0 || instance->prefab != this) return;
+	instances.remove(instance->handle);
+	delete instance;
+}
+
+/*
+Description:
+	This function is used to get the amount of instances of the prefab;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of instances;
+*/
+int Prefab3D::getInstanceCount() const {
+	return instances.size();
+}
+
+/*
+Description:
+	This function is used to get the subtree shared by all the instances;
+Input:
+	@ void parameter: void;
+Output:
+	@ Transformational* returnValue: the definition;
+*/
+Transformational* Prefab3D::getDefinition() const {
+	return definition;
+}
+
+/*
+Description:
+	This function is used to get the amount of instance matrices uploaded by the last pass, which is 0 while no instance moves;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of instance matrices;
+*/
+int Prefab3D::getUploadedCount() const {
+	return uploadedCount;
+}
+
+/*
+Description:
+	This function is used to get the world matrices of the instances gathered by the last draw or record, f. ex. to expand the instances into single objects;
+Input:
+	@ void parameter: void;
+Output:
+	@ const QVector<Matrix4>& returnValue: the instance matrices;
+*/
+const QVector<Matrix4>& Prefab3D::getInstanceMatrices() const {
+	return instanceMatrices;
+}
+
+/*
+Description:
+	This function is used to rotate the definition, which rotates the content of every instance;
+Input:
+	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::rotate(const QQuaternion& r) {
+	definition->rotate(r);
+}
+
+/*
+Description:
+	This function is used to translate the definition, which translates the content of every instance;
+Input:
+	@ const QVector3D& t: a translation vector;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::translate(const QVector3D& t) {
+	definition->translate(t);
+}
+
+/*
+Description:
+	This function is used to scale the definition, which scales the content of every instance;
+Input:
+	@ const float& s: a scalar;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::scale(const float& s) {
+	definition->scale(s);
+}
+
+/*
+Description:
+	This function is used to set the global transform of the definition, which is applied to the content of every instance;
+Input:
+	@ const QMatrix4x4& g: a global transformation;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::setGlobalTransform(const QMatrix4x4& g) {
+	definition->setGlobalTransform(g);
+}
+
+/*
+Description:
+	This function is used to attach the prefab to a parent, which is ignored, since a prefab is placed by its instances;
+Input:
+	@ Transform3D* parent: the transform of the parent;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::setParentTransform(Transform3D* parent) {
+	Q_UNUSED(parent);
+}
+
+/*
+Description:
+	This function is used to draw all the instances of the prefab, every object of the definition is drawn once for all the instances;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program including Transform.glsl;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	if (this->functions == 0 || instances.isEmpty()) return;
+
+	gatherInstances();
+	bindInstances(shaderProgram);
+	definition->drawInstanced(shaderProgram, functions, instances.size());
+	shaderProgram->setUniformValue("u_instanceCount", 0);
+}
+
+/*
+Description:
+	This function is used to draw the depth of all the instances of the prefab, which is used by the depth prepass;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program including Transform.glsl;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	if (this->functions == 0 || instances.isEmpty()) return;
+
+	gatherInstances();
+	bindInstances(shaderProgram);
+	definition->drawDepthInstanced(shaderProgram, functions, instances.size());
+	shaderProgram->setUniformValue("u_instanceCount", 0);
+}
+
+/*
+Description:
+	This function is used to record the draws of all the instances of the prefab, the instance matrices are gathered here and uploaded when the commands are replayed;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::record(CommandBuffer* commands) {
+	if (functions == 0 || instances.isEmpty()) return;
+
+	gatherInstances();
+	definition->recordInstanced(commands, this);
+}
+
+/*
+Description:
+	This function is used to gather the world matrices of the instances, which needs no OpenGL context, the matrices are marked for upload when any of them has changed since the last upload;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::gatherInstances() {
+	uploadedCount = 0;
+	int count = instances.size();
+	bool changed = count != instanceMatrices.size();
+	instanceMatrices.resize(count);
+
+	for (int i = 0; i < count; i++) {
+		Matrix4 matrix = SimdMath::fromQMatrix(instances[i]->getRenderMatrix());
+		if (changed || memcmp(&matrix, &instanceMatrices[i], sizeof(Matrix4)) != 0) {
+			instanceMatrices[i] = matrix;
+			changed = true;
+		}
+	}
+	if (changed) instancesChanged = true;
+}
+
+/*
+Description:
+	This function is used to upload the gathered instance matrices, when they have changed since the last upload;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::uploadInstances() {
+	if (!instancesChanged) return;
+	instancesChanged = false;
+
+	int count = instanceMatrices.size();
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(instanceBuffer);
+	if (count > capacity) {
+		capacity = qMax(count, capacity + capacity / 2);
+		instanceBuffer.allocate(capacity * sizeof(Matrix4));
+		cache->bindTexture(textureUnit, GL_TEXTURE_BUFFER, instanceTexture);
+		functions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer.bufferId());
+	}
+	instanceBuffer.write(0, instanceMatrices.constData(), count * sizeof(Matrix4));
+	uploadedCount = count;
+}
+
+/*
+Description:
+	This function is used to bind the instance matrices to their texture unit and enable instancing in Transform.glsl, the gathered matrices are uploaded first when they have changed;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program including Transform.glsl;
+Output:
+	@ void returnValue: void;
+*/
+void Prefab3D::bindInstances(QOpenGLShaderProgram* shaderProgram) {
+	uploadInstances();
+	GLStateCache::getDefault()->bindTexture(textureUnit, GL_TEXTURE_BUFFER, instanceTexture);
+	shaderProgram->setUniformValue("u_instanceMatrices", textureUnit);
+	shaderProgram->setUniformValue("u_instanceCount", instances.size());
+}
+
+/*
+Description:
+	This function is a constructor, instances are created by Prefab3D::createInstance();
+Input:
+	@ Prefab3D* prefab: the prefab placed by the instance;
+*/
+PrefabInstance3D::PrefabInstance3D(Prefab3D* prefab) :
+	prefab(prefab) {
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+PrefabInstance3D::~PrefabInstance3D() {
+}
+
+/*
+Description:
+	This function is used to rotate the instance;
+Input:
+	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::rotate(const QQuaternion& r) {
+	transform.rotate(r);
+}
+
+/*
+Description:
+	This function is used to translate the instance;
+Input:
+	@ const QVector3D& t: a translation vector;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::translate(const QVector3D& t) {
+	transform.translate(t);
+}
+
+/*
+Description:
+	This function is used to scale the instance;
+Input:
+	@ const float& s: a scalar;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::scale(const float& s) {
+	transform.scale(s);
+}
+
+/*
+Description:
+	This function is used to set the global transform for the instance, which is used while the instance has no parent;
+Input:
+	@ const QMatrix4x4& g: a global transformation;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::setGlobalTransform(const QMatrix4x4& g) {
+	transform.setGlobalTransform(g);
+}
+
+/*
+Description:
+	This function is used to attach the instance to the transform of its parent, so that its world matrix follows the parent;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::setParentTransform(Transform3D* parent) {
+	transform.setParent(parent);
+}
+
+/*
+Description:
+	This function is used to draw the instance, which draws nothing, since the prefab draws all its instances at once;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	Q_UNUSED(shaderProgram);
+	Q_UNUSED(functions);
+}
+
+/*
+Description:
+	This function is used to draw the depth of the instance, which draws nothing, since the prefab draws all its instances at once;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	Q_UNUSED(shaderProgram);
+	Q_UNUSED(functions);
+}
+
+/*
+Description:
+	This function is used to record the draws of the instance, which records nothing, since the prefab records all its instances at once;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void PrefabInstance3D::record(CommandBuffer* commands) {
+	Q_UNUSED(commands);
+}
+
+/*
+Description:
+	This function is used to get the prefab placed by the instance;
+Input:
+	@ void parameter: void;
+Output:
+	@ Prefab3D* returnValue: the prefab;
+*/
+Prefab3D* PrefabInstance3D::getPrefab() const {
+	return prefab;
+}
+
+/*
+Description:
+	This function is used to get the world matrix of the instance, which is applied on top of the world matrices of the definition;
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 PrefabInstance3D::getWorldMatrix() {
+	return transform.getWorldMatrix();
+}
+
+/*
+Description:
+	This function is used to get the world matrix the instance is drawn with, which comes from the snapshot of the frame when the store has one;
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 PrefabInstance3D::getRenderMatrix() {
+	return transform.getRenderMatrix();
+}
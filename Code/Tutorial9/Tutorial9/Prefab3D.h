@@ -0,0 +1,84 @@
+#pragma once
+#include <qvector.h>
+#include <qopenglbuffer.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include "Transformational.h"
+#include "SlotMap.h"
+#include "SimdMath.h"
+#include "ObjectPool.h"
+
+class PrefabInstance3D;
+
+// a subtree defined once and placed many times, the instances share its geometry and materials and are drawn with instanced draws
+class Prefab3D : public Transformational {
+public:
+	Prefab3D(Transformational* definition);
+	~Prefab3D();
+	void init();
+	PrefabInstance3D* createInstance();
+	void delInstance(PrefabInstance3D* instance);
+	int getInstanceCount() const;
+	Transformational* getDefinition() const;
+	int getUploadedCount() const;
+	const QVector<Matrix4>& getInstanceMatrices() const;
+	void bindInstances(QOpenGLShaderProgram* shaderProgram);
+
+	void rotate(const QQuaternion& r);
+	void translate(const QVector3D& t);
+	void scale(const float& s);
+	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
+	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void record(CommandBuffer* commands);
+
+	static const int textureUnit = 5;
+
+private:
+	Q_DISABLE_COPY(Prefab3D)
+
+	void gatherInstances();
+	void uploadInstances();
+
+	// the definition is not owned, it is never attached to a parent, so its world matrices are relative to the prefab
+	Transformational* definition;
+
+	// the prefab owns its instances, each instance keeps its own handle
+	SlotMap<PrefabInstance3D*> instances;
+
+	// the instance matrices last uploaded, a pass only uploads them again when an instance has moved
+	QVector<Matrix4> instanceMatrices;
+	bool instancesChanged;
+	int capacity;
+	int uploadedCount;
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+	QOpenGLBuffer instanceBuffer;
+	GLuint instanceTexture;
+};
+
+// a lightweight placement of a prefab, it only holds a transform, the prefab draws all its instances at once
+class PrefabInstance3D : public Transformational, public PoolAllocated<PrefabInstance3D> {
+public:
+	void rotate(const QQuaternion& r);
+	void translate(const QVector3D& t);
+	void scale(const float& s);
+	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
+	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void record(CommandBuffer* commands);
+	Prefab3D* getPrefab() const;
+	QMatrix4x4 getWorldMatrix();
+	QMatrix4x4 getRenderMatrix();
+
+private:
+	friend class Prefab3D;
+	PrefabInstance3D(Prefab3D* prefab);
+	~PrefabInstance3D();
+
+	Prefab3D* prefab;
+	SlotHandle handle;
+	Transform3D transform;
+};
@@ -0,0 +1,164 @@
+#include "RenderThread.h"
+
+/*
+Description:
+	This function is a constructor, the thread is started by QThread::start() after the widget is initialized;
+Input:
+	@ QOpenGLWidget* widget: the widget drawn by the thread;
+	@ const std::function<void()>& render: the function drawing a frame, which is called on the render thread with the context of the widget current;
+*/
+RenderThread::RenderThread(QOpenGLWidget* widget, const std::function<void()>& render) :
+	widget(widget), render(render), contextGranted(false), frameRequested(false), frameCount(0), quit(0) {
+}
+
+/*
+Description:
+	This function is a destructor, which stops the thread;
+Input:
+	@ void patameter: void;
+*/
+RenderThread::~RenderThread() {
+	stop();
+}
+
+/*
+Description:
+	This function is used to ask for a frame, requests made while a frame is drawn are merged into the next frame;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::requestFrame() {
+	QMutexLocker locker(&requestMutex);
+	frameRequested = true;
+	requestCondition.wakeOne();
+}
+
+/*
+Description:
+	This function is used to stop the thread, it is called on the GUI thread, after it the context belongs to the GUI thread again;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::stop() {
+	quit.storeRelease(1);
+
+	requestMutex.lock();
+	requestCondition.wakeOne();
+	requestMutex.unlock();
+
+	grabMutex.lock();
+	grabCondition.wakeAll();
+	grabMutex.unlock();
+
+	wait();
+}
+
+/*
+Description:
+	This function is used to keep the render thread from taking the context, it waits for the frame being drawn;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::lock() {
+	renderMutex.lock();
+}
+
+/*
+Description:
+	This function is used to let the render thread take the context again;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::unlock() {
+	renderMutex.unlock();
+}
+
+/*
+Description:
+	This function is used to get the amount of frames drawn so far;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of frames;
+*/
+int RenderThread::getFrameCount() const {
+	return frameCount.loadAcquire();
+}
+
+/*
+Description:
+	This function is used to draw a frame whenever one is requested, the context is borrowed from the GUI thread for the frame and the composition is scheduled after it;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::run() {
+	QOpenGLContext* context = widget->context();
+	QThread* guiThread = context->thread();
+
+	while (true) {
+		requestMutex.lock();
+		while (!frameRequested && !quit.loadAcquire())
+			requestCondition.wait(&requestMutex);
+		frameRequested = false;
+		requestMutex.unlock();
+		if (quit.loadAcquire()) break;
+
+		// the GUI thread moves the context to this thread when it gets to the queued call, the GUI thread stopping this thread never gets to it,
+		// so quit is checked again under the mutex stop() wakes under, and the wait only ends for the context or for quit, not on a spurious wakeup
+		grabMutex.lock();
+		if (quit.loadAcquire()) {
+			grabMutex.unlock();
+			break;
+		}
+		contextGranted = false;
+		QMetaObject::invokeMethod(widget, [this]() { grabContext(); }, Qt::QueuedConnection);
+		while (!contextGranted && !quit.loadAcquire())
+			grabCondition.wait(&grabMutex);
+		if (!contextGranted) {
+			grabMutex.unlock();
+			break;
+		}
+		QMutexLocker locker(&renderMutex);
+		grabMutex.unlock();
+
+		widget->makeCurrent();
+		render();
+		widget->doneCurrent();
+		context->moveToThread(guiThread);
+		frameCount.fetchAndAddRelease(1);
+
+		// the widget composes the new frame on the GUI thread
+		QMetaObject::invokeMethod(widget, [this]() { widget->update(); }, Qt::QueuedConnection);
+	}
+}
+
+/*
+Description:
+	This function is used to move the context of the widget to the render thread, which is called on the GUI thread, nothing is moved once the thread is stopping;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void RenderThread::grabContext() {
+	renderMutex.lock();
+	QMutexLocker locker(&grabMutex);
+
+	// quit is checked under the mutex, so the context is never moved to a thread that has already given up waiting for it
+	if (!quit.loadAcquire()) {
+		widget->context()->moveToThread(this);
+		contextGranted = true;
+		grabCondition.wakeAll();
+	}
+	renderMutex.unlock();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <qthread.h>
+#include <qmutex.h>
+#include <qwaitcondition.h>
+#include <qatomic.h>
+#include <qopenglwidget.h>
+#include <qopenglcontext.h>
+#include <functional>
+
+// draws the frames of a QOpenGLWidget on its own thread, the context of the widget is borrowed from the GUI thread for every frame
+// and handed back for the composition, so the GUI thread never waits for the GPU submission of a frame
+class RenderThread : public QThread {
+public:
+	RenderThread(QOpenGLWidget* widget, const std::function<void()>& render);
+	~RenderThread();
+	void requestFrame();
+	void stop();
+	void lock();
+	void unlock();
+	int getFrameCount() const;
+
+protected:
+	void run();
+
+private:
+	Q_DISABLE_COPY(RenderThread)
+
+	void grabContext();
+
+	QOpenGLWidget* widget;
+	std::function<void()> render;
+
+	// held while the thread owns the context, the GUI thread takes it before it needs the context itself, f. ex. to resize the widget
+	QMutex renderMutex;
+
+	// the context can only be moved by the thread it belongs to, so the render thread waits here until the GUI thread has moved it
+	QMutex grabMutex;
+	QWaitCondition grabCondition;
+	bool contextGranted;
+
+	QMutex requestMutex;
+	QWaitCondition requestCondition;
+	bool frameRequested;
+
+	QAtomicInt frameCount;
+	QAtomicInt quit;
+};
@@ -0,0 +1,368 @@
+#include "ResolutionScaler.h"
+#include "GLStateCache.h"
+#include <qvector2d.h>
+#include <QtMath>
+
+/*
+Description:
+	This function is a constructor, the scene is drawn at full size until dynamic resolution is enabled;
+Input:
+	@ void parameter: void;
+*/
+ResolutionScaler::ResolutionScaler() :
+	functions(0), upscaleShader(0), enabled(false), targetFrameTime(16.6f), minimumScale(0.5f), maximumScale(1.0f), scale(1.0f),
+	frameTime(0.0f), cpuTime(0.0f), gpuTime(0.0f), queryIndex(0) {
+	for (int i = 0; i < queryCount; i++) {
+		queries[i] = 0;
+		queryPending[i] = false;
+	}
+}
+
+/*
+Description:
+	This function is a destructor, the default scaler outlives the context, so the queries and the buffer are expected to be destroyed already;
+Input:
+	@ void patameter: void;
+*/
+ResolutionScaler::~ResolutionScaler() {
+}
+
+/*
+Description:
+	This function is used to create the timer queries and the fullscreen triangle of the upscale, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ QOpenGLShaderProgram* upscaleShader: the shader program built from Upscale.vsh and Upscale.fsh;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::init(QOpenGLShaderProgram* upscaleShader) {
+	this->upscaleShader = upscaleShader;
+
+	functions = GLStateCache::getDefault()->getFunctions();
+	if (functions == 0) return;
+
+	functions->glGenQueries(queryCount, queries);
+
+	// the triangle of the skybox, covering the whole screen
+	QVector<QVector2D> vertices;
+	vertices << QVector2D(-1.0, -1.0) << QVector2D(3.0, -1.0) << QVector2D(-1.0, 3.0);
+
+	vertexBuffer.create();
+	GLStateCache::getDefault()->bindBuffer(vertexBuffer);
+	vertexBuffer.allocate(vertices.constData(), vertices.size() * sizeof(QVector2D));
+}
+
+/*
+Description:
+	This function is used to delete the timer queries and the fullscreen triangle, before the context is destroyed, an OpenGL context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::destroy() {
+	if (functions == 0) return;
+
+	functions->glDeleteQueries(queryCount, queries);
+	for (int i = 0; i < queryCount; i++) {
+		queries[i] = 0;
+		queryPending[i] = false;
+	}
+	if (vertexBuffer.isCreated())
+		vertexBuffer.destroy();
+	GLStateCache::getDefault()->invalidate();
+
+	functions = 0;
+	upscaleShader = 0;
+}
+
+/*
+Description:
+	This function is used to start measuring a frame, the query of a frame still not read after the others were used is read here, which only waits when the GPU is several frames behind;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::beginFrame() {
+	if (functions == 0) return;
+
+	if (queryPending[queryIndex])
+		readQuery(queryIndex);
+
+	functions->glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+	timer.start();
+}
+
+/*
+Description:
+	This function is used to finish measuring a frame, the GPU times of the earlier frames that are available are read, and the scale is adjusted by each of them;
+	the CPU time is only kept for getCpuTime(), a frame bound by the CPU does not get faster with fewer pixels, so following it would only blur the scene;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::endFrame() {
+	if (functions == 0 || !timer.isValid()) return;
+
+	functions->glEndQuery(GL_TIME_ELAPSED);
+	queryPending[queryIndex] = true;
+	queryIndex = (queryIndex + 1) % queryCount;
+	cpuTime = timer.nsecsElapsed() / 1.0e6f;
+	timer.invalidate();
+
+	// the queries finish in the order they were issued, so the oldest is read first and the reading stops at the first one not available
+	for (int i = 0; i < queryCount; i++) {
+		int query = (queryIndex + i) % queryCount;
+		if (!queryPending[query]) continue;
+
+		GLint available = 0;
+		functions->glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		readQuery(query);
+	}
+}
+
+/*
+Description:
+	This function is used to draw the scene over the bound framebuffer, sampled bilinearly and sharpened more the smaller the scene is, only the lower left region of the texture the scene was drawn to is sampled;
+Input:
+	@ GLuint texture: the texture the scene was drawn to;
+	@ const QSize& size: the size of the scene in pixels, see getSceneSize(const QSize&);
+	@ const QSize& targetSize: the size of the texture in pixels, see getTargetSize(const QSize&);
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::upscale(GLuint texture, const QSize& size, const QSize& targetSize) {
+	if (functions == 0 || upscaleShader == 0 || size.isEmpty() || targetSize.isEmpty()) return;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->useProgram(upscaleShader);
+	cache->bindTexture(0, GL_TEXTURE_2D, texture);
+	upscaleShader->setUniformValue("u_scene", 0);
+	upscaleShader->setUniformValue("u_texelSize", QVector2D(1.0f / targetSize.width(), 1.0f / targetSize.height()));
+	upscaleShader->setUniformValue("u_region", QVector2D(float(size.width()) / targetSize.width(), float(size.height()) / targetSize.height()));
+	upscaleShader->setUniformValue("u_sharpness", qBound(0.0f, 1.0f - scale, 1.0f));
+
+	cache->bindBuffer(vertexBuffer);
+	int verLoc = upscaleShader->attributeLocation("a_position");
+	upscaleShader->enableAttributeArray(verLoc);
+	upscaleShader->setAttributeBuffer(verLoc, GL_FLOAT, 0, 2, sizeof(QVector2D));
+
+	functions->glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/*
+Description:
+	This function is used to get the size the scene is drawn at, the scale is rounded to steps of 5 percent, so the scale only moves by whole steps;
+Input:
+	@ const QSize& size: the size of the framebuffer of the widget;
+Output:
+	@ QSize returnValue: the size of the scene;
+*/
+QSize ResolutionScaler::getSceneSize(const QSize& size) const {
+	if (!enabled) return size;
+
+	float step = qBound(minimumScale, qRound(scale * 20.0f) / 20.0f, maximumScale);
+	return QSize(qMax(qRound(size.width() * step), 1), qMax(qRound(size.height() * step), 1));
+}
+
+/*
+Description:
+	This function is used to get the size of the textures the scene is drawn to, which fits the largest scale, so they are created once for a size of the widget and the scene is drawn to their lower left region;
+Input:
+	@ const QSize& size: the size of the framebuffer of the widget;
+Output:
+	@ QSize returnValue: the size of the textures;
+*/
+QSize ResolutionScaler::getTargetSize(const QSize& size) const {
+	if (!enabled) return size;
+	return QSize(qMax(qRound(size.width() * maximumScale), 1), qMax(qRound(size.height() * maximumScale), 1));
+}
+
+/*
+Description:
+	This function is used to enable or disable dynamic resolution, the scene is drawn directly to the widget when disabled;
+Input:
+	@ bool enabled: true to scale the scene;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::setEnabled(bool enabled) {
+	this->enabled = enabled;
+}
+
+/*
+Description:
+	This function is used to check whether dynamic resolution is enabled;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the scene is scaled;
+*/
+bool ResolutionScaler::isEnabled() const {
+	return enabled;
+}
+
+/*
+Description:
+	This function is used to set the frame time the scale is adjusted to hold;
+Input:
+	@ float milliseconds: the frame time in milliseconds;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::setTargetFrameTime(float milliseconds) {
+	targetFrameTime = qMax(milliseconds, 1.0f);
+}
+
+/*
+Description:
+	This function is used to get the frame time the scale is adjusted to hold;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the frame time in milliseconds;
+*/
+float ResolutionScaler::getTargetFrameTime() const {
+	return targetFrameTime;
+}
+
+/*
+Description:
+	This function is used to set the range of the scale, a maximum above 1 draws the scene above the resolution of the widget when there is time left;
+Input:
+	@ float minimum: the smallest scale;
+	@ float maximum: the largest scale;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::setScaleRange(float minimum, float maximum) {
+	minimumScale = qBound(0.1f, minimum, 2.0f);
+	maximumScale = qBound(minimumScale, maximum, 2.0f);
+	scale = qBound(minimumScale, scale, maximumScale);
+}
+
+/*
+Description:
+	This function is used to get the smallest scale;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the scale;
+*/
+float ResolutionScaler::getMinimumScale() const {
+	return minimumScale;
+}
+
+/*
+Description:
+	This function is used to get the largest scale;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the scale;
+*/
+float ResolutionScaler::getMaximumScale() const {
+	return maximumScale;
+}
+
+/*
+Description:
+	This function is used to get the current scale, before it is rounded to a step;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the scale of the width and the height of the scene;
+*/
+float ResolutionScaler::getScale() const {
+	return scale;
+}
+
+/*
+Description:
+	This function is used to get the smoothed GPU time of the frames the scale is adjusted by;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the frame time in milliseconds;
+*/
+float ResolutionScaler::getFrameTime() const {
+	return frameTime;
+}
+
+/*
+Description:
+	This function is used to get the CPU time of the last frame, which is reported apart from the GPU time and does not move the scale;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the time in milliseconds;
+*/
+float ResolutionScaler::getCpuTime() const {
+	return cpuTime;
+}
+
+/*
+Description:
+	This function is used to get the GPU time of the latest frame whose query was read;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the time in milliseconds;
+*/
+float ResolutionScaler::getGpuTime() const {
+	return gpuTime;
+}
+
+/*
+Description:
+	This function is used to get the scaler of the widget, whose settings are given on the command line;
+Input:
+	@ void parameter: void;
+Output:
+	@ ResolutionScaler* returnValue: the default scaler;
+*/
+ResolutionScaler* ResolutionScaler::getDefault() {
+	static ResolutionScaler scaler;
+	return &scaler;
+}
+
+/*
+Description:
+	This function is used to read the GPU time of a finished query and adjust the scale by it, each measured frame is counted once;
+Input:
+	@ int query: the index of the query;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::readQuery(int query) {
+	GLuint64 nanoseconds = 0;
+	functions->glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+	gpuTime = nanoseconds / 1.0e6f;
+	queryPending[query] = false;
+	adjust(gpuTime);
+}
+
+/*
+Description:
+	This function is used to move the scale towards the one holding the target frame time, the cost of the scene grows with its pixels, so the scale goes with the square root of the time;
+Input:
+	@ float milliseconds: the GPU time of the frame;
+Output:
+	@ void returnValue: void;
+*/
+void ResolutionScaler::adjust(float milliseconds) {
+	if (frameTime <= 0.0f) frameTime = milliseconds;
+	else frameTime += 0.1f * (milliseconds - frameTime);
+	if (!enabled) return;
+
+	// close to the target the scale is left alone, so it does not hunt around it
+	if (qAbs(frameTime - targetFrameTime) < 0.05f * targetFrameTime) return;
+
+	// the measured frames were drawn at earlier scales, so only a part of the way is taken each frame
+	float ideal = scale * qSqrt(targetFrameTime / qMax(frameTime, 0.01f));
+	scale = qBound(minimumScale, scale + 0.1f * (ideal - scale), maximumScale);
+}
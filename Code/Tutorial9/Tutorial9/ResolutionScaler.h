@@ -0,0 +1,63 @@
+#pragma once
+#include <qsize.h>
+#include <qelapsedtimer.h>
+#include <qopenglbuffer.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+
+// dynamic resolution, the scene is drawn to an offscreen target whose size is scaled every frame to hold a frame time,
+// the scale follows the GPU time of the frames, the CPU time is only reported, since fewer pixels do not make the CPU faster, and the target is upscaled and sharpened to the framebuffer of the widget
+class ResolutionScaler {
+public:
+	ResolutionScaler();
+	~ResolutionScaler();
+	void init(QOpenGLShaderProgram* upscaleShader);
+	void destroy();
+	void beginFrame();
+	void endFrame();
+	void upscale(GLuint texture, const QSize& size, const QSize& targetSize);
+	QSize getSceneSize(const QSize& size) const;
+	QSize getTargetSize(const QSize& size) const;
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+	void setTargetFrameTime(float milliseconds);
+	float getTargetFrameTime() const;
+	void setScaleRange(float minimum, float maximum);
+	float getMinimumScale() const;
+	float getMaximumScale() const;
+	float getScale() const;
+	float getFrameTime() const;
+	float getCpuTime() const;
+	float getGpuTime() const;
+
+	static ResolutionScaler* getDefault();
+
+private:
+	Q_DISABLE_COPY(ResolutionScaler)
+
+	void readQuery(int query);
+	void adjust(float milliseconds);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+	QOpenGLShaderProgram* upscaleShader;
+	QOpenGLBuffer vertexBuffer;
+
+	bool enabled;
+	float targetFrameTime;
+	float minimumScale;
+	float maximumScale;
+	float scale;
+
+	// the smoothed GPU time the scale is adjusted by, and the times of the last measured frame
+	float frameTime;
+	float cpuTime;
+	float gpuTime;
+
+	QElapsedTimer timer;
+
+	// the GPU time of a frame is read a few frames later, so waiting for the query never stalls the frame
+	static const int queryCount = 4;
+	GLuint queries[queryCount];
+	bool queryPending[queryCount];
+	int queryIndex;
+};
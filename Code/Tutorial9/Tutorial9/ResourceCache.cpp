@@ -0,0 +1,369 @@
+#include "ResourceCache.h"
+#include "GLStateCache.h"
+#include "SimpleObject3D.h"
+#include <qcryptographichash.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+ResourceCache::ResourceCache() :
+	usingTextureArrays(false), hitCount(0), savedBytes(0) {
+}
+
+/*
+Description:
+	This function is a destructor, the materials still referenced are deleted, the OpenGL resources are expected to be released with their objects;
+Input:
+	@ void patameter: void;
+*/
+ResourceCache::~ResourceCache() {
+	for (QHash<QByteArray, Entry<Material> >::iterator i = materials.begin(); i != materials.end(); ++i)
+		delete i.value().resource;
+}
+
+/*
+Description:
+	This function is used to get the ranges of a vertex and index payload in the geometry arena, the ranges are only allocated for a payload that is not shared yet;
+Input:
+	@ const QVector<Vertex>& vertices: the vertex list;
+	@ const QVector<GLuint>& indices: the index list;
+Output:
+	@ Geometry* returnValue: the shared geometry, released by ResourceCache::releaseGeometry(Geometry*);
+*/
+ResourceCache::Geometry* ResourceCache::acquireGeometry(const QVector<Vertex>& vertices, const QVector<GLuint>& indices) {
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(reinterpret_cast<const char*>(vertices.constData()), vertices.size() * sizeof(Vertex));
+	hash.addData(reinterpret_cast<const char*>(indices.constData()), indices.size() * sizeof(GLuint));
+	QByteArray key = hash.result();
+
+	Geometry* geometry = geometries.value(key, 0);
+	if (geometry != 0) {
+		geometry->references++;
+		hitCount++;
+		savedBytes += geometry->bytes;
+		return geometry;
+	}
+
+	geometry = new Geometry;
+	geometry->key = key;
+	geometry->references = 1;
+
+	// the depth prepass only needs positions, so keep a tightly packed position-only stream (12 bytes per vertex instead of 32)
+	QVector<QVector3D> positions;
+	positions.reserve(vertices.size());
+	for (int i = 0; i < vertices.size(); i++) {
+		positions.append(vertices[i].position);
+		geometry->radius = qMax(geometry->radius, vertices[i].position.length());
+	}
+
+	if (!geometryArena.allocate(&geometry->allocation, vertices.constData(), positions.constData(), vertices.size(), indices.constData(), indices.size())) {
+		delete geometry;
+		return 0;
+	}
+
+	geometry->bytes = vertices.size() * (sizeof(Vertex) + sizeof(QVector3D)) + indices.size() * sizeof(GLuint);
+	geometries.insert(key, geometry);
+	return geometry;
+}
+
+/*
+Description:
+	This function is used to drop a reference to a geometry, the ranges are freed with the last reference, an OpenGL context is supposed to be current;
+Input:
+	@ Geometry* geometry: the geometry;
+Output:
+	@ void returnValue: void;
+*/
+void ResourceCache::releaseGeometry(Geometry* geometry) {
+	if (geometry == 0 || --geometry->references > 0) return;
+
+	geometries.remove(geometry->key);
+	geometryArena.free(&geometry->allocation);
+	delete geometry;
+}
+
+/*
+Description:
+	This function is used to get the texture of the diffuse map of a material, materials with the same image share one texture;
+Input:
+	@ const Material* material: the material;
+Output:
+	@ QOpenGLTexture* returnValue: the shared texture, released by ResourceCache::releaseTexture(QOpenGLTexture*);
+*/
+QOpenGLTexture* ResourceCache::acquireTexture(const Material* material) {
+	const QByteArray& key = material->getDiffuseMapKey();
+	Entry<QOpenGLTexture>& entry = textures[key];
+	if (entry.resource != 0) {
+		entry.references++;
+		hitCount++;
+		savedBytes += material->getDiffuseMap().sizeInBytes();
+		return entry.resource;
+	}
+
+	QOpenGLTexture* texture = new QOpenGLTexture((material->getDiffuseMap()).mirrored());
+
+	// Set nearest filtering mode for texture minification
+	texture->setMinificationFilter(QOpenGLTexture::Linear);
+
+	// Set bilinear filtering mode for texture magnification
+	texture->setMagnificationFilter(QOpenGLTexture::Linear);
+
+	// Wrap texture coordinates by repreating
+	// f. ex. texture coordinate (1.1, 1.2) is same as 0.1, 0.2;
+	texture->setWrapMode(QOpenGLTexture::Repeat);
+
+	entry.resource = texture;
+	entry.references = 1;
+	textureKeys.insert(texture, key);
+	return texture;
+}
+
+/*
+Description:
+	This function is used to drop a reference to a texture, the texture is destroyed with the last reference, an OpenGL context is supposed to be current;
+Input:
+	@ QOpenGLTexture* texture: the texture;
+Output:
+	@ void returnValue: void;
+*/
+void ResourceCache::releaseTexture(QOpenGLTexture* texture) {
+	QHash<QOpenGLTexture*, QByteArray>::iterator key = textureKeys.find(texture);
+	if (key == textureKeys.end()) return;
+
+	QHash<QByteArray, Entry<QOpenGLTexture> >::iterator entry = textures.find(key.value());
+	if (--entry.value().references > 0) return;
+
+	textures.erase(entry);
+	textureKeys.erase(key);
+	delete texture;
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to get the layer of the diffuse map of a material in the texture arrays, materials with the same image share one layer;
+Input:
+	@ const Material* material: the material;
+Output:
+	@ TextureArrayPool::Layer returnValue: the shared layer, released by ResourceCache::releaseTextureLayer(const TextureArrayPool::Layer&), the array is -1 for a material without a diffuse map;
+*/
+TextureArrayPool::Layer ResourceCache::acquireTextureLayer(const Material* material) {
+	if (!material->isUsingDiffuseMap()) return TextureArrayPool::Layer();
+
+	const QByteArray& key = material->getDiffuseMapKey();
+	LayerEntry& entry = textureLayers[key];
+	if (entry.references > 0) {
+		entry.references++;
+		hitCount++;
+		savedBytes += material->getDiffuseMap().sizeInBytes();
+		return entry.layer;
+	}
+
+	entry.layer = textureArrays.insert((material->getDiffuseMap()).mirrored());
+	if (entry.layer.array < 0) {
+		textureLayers.remove(key);
+		return TextureArrayPool::Layer();
+	}
+
+	entry.references = 1;
+	textureLayerKeys.insert(qMakePair(entry.layer.array, entry.layer.layer), key);
+	return entry.layer;
+}
+
+/*
+Description:
+	This function is used to drop a reference to a layer, the layer is given back to its array with the last reference, an OpenGL context is supposed to be current;
+Input:
+	@ const TextureArrayPool::Layer& layer: the layer;
+Output:
+	@ void returnValue: void;
+*/
+void ResourceCache::releaseTextureLayer(const TextureArrayPool::Layer& layer) {
+	QHash<QPair<int, int>, QByteArray>::iterator key = textureLayerKeys.find(qMakePair(layer.array, layer.layer));
+	if (key == textureLayerKeys.end()) return;
+
+	QHash<QByteArray, LayerEntry>::iterator entry = textureLayers.find(key.value());
+	if (--entry.value().references > 0) return;
+
+	textureLayers.erase(entry);
+	textureLayerKeys.erase(key);
+	textureArrays.remove(layer);
+}
+
+/*
+Description:
+	This function is used to share a material, a material identical to a shared one is deleted and the shared one is returned instead, the name is not compared;
+Input:
+	@ Material* material: a fully set up material, the cache takes the ownership of it;
+Output:
+	@ Material* returnValue: the shared material, released by ResourceCache::releaseMaterial(Material*);
+*/
+Material* ResourceCache::acquireMaterial(Material* material) {
+	if (material == 0) return 0;
+
+	// a material shared already only gains a reference
+	QHash<Material*, QByteArray>::const_iterator known = materialKeys.constFind(material);
+	if (known != materialKeys.constEnd()) {
+		materials[known.value()].references++;
+		return material;
+	}
+
+	QByteArray key = material->getContentKey();
+	Entry<Material>& entry = materials[key];
+	if (entry.resource != 0) {
+		entry.references++;
+		hitCount++;
+		savedBytes += sizeof(Material) + material->getDiffuseMap().sizeInBytes();
+		delete material;
+		return entry.resource;
+	}
+
+	entry.resource = material;
+	entry.references = 1;
+	materialKeys.insert(material, key);
+	return material;
+}
+
+/*
+Description:
+	This function is used to drop a reference to a material, the material is deleted with the last reference;
+Input:
+	@ Material* material: the material;
+Output:
+	@ void returnValue: void;
+*/
+void ResourceCache::releaseMaterial(Material* material) {
+	QHash<Material*, QByteArray>::iterator key = materialKeys.find(material);
+	if (key == materialKeys.end()) return;
+
+	QHash<QByteArray, Entry<Material> >::iterator entry = materials.find(key.value());
+	if (--entry.value().references > 0) return;
+
+	materials.erase(entry);
+	materialKeys.erase(key);
+	delete material;
+}
+
+/*
+Description:
+	This function is used to get the amount of distinct geometries;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of geometries;
+*/
+int ResourceCache::getGeometryCount() const {
+	return geometries.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of distinct textures;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of textures;
+*/
+int ResourceCache::getTextureCount() const {
+	return textures.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of distinct materials;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of materials;
+*/
+int ResourceCache::getMaterialCount() const {
+	return materials.size();
+}
+
+/*
+Description:
+	This function is used to get the amount of requests resolved to a resource that was shared already;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of hits;
+*/
+int ResourceCache::getHitCount() const {
+	return hitCount;
+}
+
+/*
+Description:
+	This function is used to get the amount of memory the hits did not allocate, buffer and texture bytes on the GPU plus the materials and images freed on the CPU;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the amount of bytes;
+*/
+qint64 ResourceCache::getSavedBytes() const {
+	return savedBytes;
+}
+
+/*
+Description:
+	This function is used to get the arena holding the vertices and indices of all the geometries, whose blocks are bound to draw them;
+Input:
+	@ void parameter: void;
+Output:
+	@ GeometryArena* returnValue: the geometry arena;
+*/
+GeometryArena* ResourceCache::getGeometryArena() {
+	return &geometryArena;
+}
+
+/*
+Description:
+	This function is used to get the texture arrays holding the diffuse maps when texture arrays are used;
+Input:
+	@ void parameter: void;
+Output:
+	@ TextureArrayPool* returnValue: the texture arrays;
+*/
+TextureArrayPool* ResourceCache::getTextureArrays() {
+	return &textureArrays;
+}
+
+/*
+Description:
+	This function is used to choose whether the diffuse maps are packed into texture arrays, which is set before the first object is created, since the shaders are built for one of the modes;
+Input:
+	@ bool enabled: true to pack the diffuse maps into texture arrays;
+Output:
+	@ void returnValue: void;
+*/
+void ResourceCache::setUsingTextureArrays(bool enabled) {
+	usingTextureArrays = enabled;
+}
+
+/*
+Description:
+	This function is used to check whether the diffuse maps are packed into texture arrays;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the objects acquire texture layers instead of textures;
+*/
+bool ResourceCache::isUsingTextureArrays() const {
+	return usingTextureArrays;
+}
+
+/*
+Description:
+	This function is used to get the cache shared by the application;
+Input:
+	@ void parameter: void;
+Output:
+	@ ResourceCache* returnValue: the default cache;
+*/
+ResourceCache* ResourceCache::getDefault() {
+	static ResourceCache cache;
+	return &cache;
+}
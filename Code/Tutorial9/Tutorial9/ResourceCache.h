@@ -0,0 +1,81 @@
+#pragma once
+#include <qvector.h>
+#include <qhash.h>
+#include <qbytearray.h>
+#include <qopenglbuffer.h>
+#include <qopengltexture.h>
+#include "Material.h"
+#include "GeometryArena.h"
+#include "TextureArrayPool.h"
+
+struct Vertex;
+
+// shares identical geometry, textures and materials, every resource is found by a hash of its content and freed with its last reference
+class ResourceCache {
+public:
+	// the ranges of one vertex and index payload in the buffers of the geometry arena, drawn by every object created from the same payload
+	struct Geometry {
+		Geometry() : radius(0.0f), bytes(0), references(0) {};
+		GeometryArena::Allocation allocation;
+		// the distance of the farthest vertex from the origin, a bounding sphere that stays valid under any rotation
+		float radius;
+		qint64 bytes;
+		int references;
+		QByteArray key;
+	};
+
+	ResourceCache();
+	~ResourceCache();
+	Geometry* acquireGeometry(const QVector<Vertex>& vertices, const QVector<GLuint>& indices);
+	void releaseGeometry(Geometry* geometry);
+	QOpenGLTexture* acquireTexture(const Material* material);
+	void releaseTexture(QOpenGLTexture* texture);
+	TextureArrayPool::Layer acquireTextureLayer(const Material* material);
+	void releaseTextureLayer(const TextureArrayPool::Layer& layer);
+	Material* acquireMaterial(Material* material);
+	void releaseMaterial(Material* material);
+
+	int getGeometryCount() const;
+	int getTextureCount() const;
+	int getMaterialCount() const;
+	int getHitCount() const;
+	qint64 getSavedBytes() const;
+	GeometryArena* getGeometryArena();
+	TextureArrayPool* getTextureArrays();
+	void setUsingTextureArrays(bool enabled);
+	bool isUsingTextureArrays() const;
+
+	static ResourceCache* getDefault();
+
+private:
+	Q_DISABLE_COPY(ResourceCache)
+
+	template<typename T>
+	struct Entry {
+		Entry() : resource(0), references(0) {};
+		T* resource;
+		int references;
+	};
+
+	// the resources are created and used on the thread owning the OpenGL context, so the cache is not locked
+	QHash<QByteArray, Geometry*> geometries;
+	GeometryArena geometryArena;
+	QHash<QByteArray, Entry<QOpenGLTexture> > textures;
+	QHash<QOpenGLTexture*, QByteArray> textureKeys;
+
+	// the diffuse maps packed into texture arrays, found by the same key as the textures
+	struct LayerEntry {
+		LayerEntry() : references(0) {};
+		TextureArrayPool::Layer layer;
+		int references;
+	};
+	TextureArrayPool textureArrays;
+	QHash<QByteArray, LayerEntry> textureLayers;
+	QHash<QPair<int, int>, QByteArray> textureLayerKeys;
+	bool usingTextureArrays;
+	QHash<QByteArray, Entry<Material> > materials;
+	QHash<Material*, QByteArray> materialKeys;
+
+	int hitCount;
+	qint64 savedBytes;
+};
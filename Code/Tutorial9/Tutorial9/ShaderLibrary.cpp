@@ -0,0 +1,423 @@
+#include "ShaderLibrary.h"
+#include <qopenglcontext.h>
+#include <qcryptographichash.h>
+#include <qstandardpaths.h>
+#include <qfile.h>
+#include <qsavefile.h>
+#include <qdir.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+ShaderLibrary::ShaderLibrary() :
+	functions(0), binarySupported(false), cacheHits(0) {
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+ShaderLibrary::~ShaderLibrary() {
+	for (int i = 0; i < variants.size(); i++)
+		delete variants[i].program;
+}
+
+/*
+Description:
+	This function is used to get the OpenGL functions and locate the binary cache, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void ShaderLibrary::init() {
+	functions = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_3_Compatibility>();
+	if (functions == 0) return;
+	functions->initializeOpenGLFunctions();
+
+	// program binaries are only valid for the driver that produced them, so the driver is part of every hash
+	driverString.append((const char*)functions->glGetString(GL_VENDOR));
+	driverString.append((const char*)functions->glGetString(GL_RENDERER));
+	driverString.append((const char*)functions->glGetString(GL_VERSION));
+
+	GLint formatCount = 0;
+	functions->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	binarySupported = formatCount > 0;
+
+	cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+	if (binarySupported)
+		QDir().mkpath(cacheDirectory);
+
+	// let the driver compile on its own threads where it is supported
+	typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+	MaxShaderCompilerThreads maxShaderCompilerThreads = 0;
+	if (QOpenGLContext::currentContext()->hasExtension("GL_KHR_parallel_shader_compile"))
+		maxShaderCompilerThreads = (MaxShaderCompilerThreads)QOpenGLContext::currentContext()->getProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (QOpenGLContext::currentContext()->hasExtension("GL_ARB_parallel_shader_compile"))
+		maxShaderCompilerThreads = (MaxShaderCompilerThreads)QOpenGLContext::currentContext()->getProcAddress("glMaxShaderCompilerThreadsARB");
+	if (maxShaderCompilerThreads != 0)
+		maxShaderCompilerThreads(0xFFFFFFFF);
+}
+
+/*
+Description:
+	This function is used to set the defines shared by all the variants, such as "MAX_CLUSTER_LIGHTS 64";
+Input:
+	@ const QStringList& defines: a list of defines, each one is a name followed by an optional value;
+Output:
+	@ void returnValue: void;
+*/
+void ShaderLibrary::setGlobalDefines(const QStringList& defines) {
+	globalDefines = defines;
+}
+
+/*
+Description:
+	This function is used to request a variant of a shader program, the variant is compiled by the next call of ShaderLibrary::build();
+	the stages are loaded from name.vsh, name.fsh and name.csh, whichever exist;
+Input:
+	@ const QString& name: the file name of the shaders without extension;
+	@ const QStringList& features: the features of the variant, each one becomes a #define;
+Output:
+	@ void returnValue: void;
+*/
+void ShaderLibrary::addProgram(const QString& name, const QStringList& features) {
+	QString key = getKey(name, features);
+	if (programs.contains(key)) return;
+
+	ShaderVariant variant;
+	variant.name = name;
+	variant.features = features;
+	variant.features.sort();
+	variant.program = new QOpenGLShaderProgram;
+	variant.program->setProperty("features", variant.features);
+
+	variants.append(variant);
+	programs.insert(key, variant.program);
+}
+
+/*
+Description:
+	This function is used to build all the requested variants, variants found in the binary cache are loaded directly;
+	all the other variants are submitted to the driver before any status is queried, so the driver is free to compile them in parallel, a variant whose file or include cannot be read is not built;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if all the variants are linked;
+*/
+bool ShaderLibrary::build() {
+	if (functions == 0) {
+		buildLog = "OpenGL 4.3 functions are not available";
+		return false;
+	}
+
+	static const struct {
+		const char* extension;
+		GLenum type;
+	} stages[] = { { ".vsh", GL_VERTEX_SHADER }, { ".fsh", GL_FRAGMENT_SHADER }, { ".csh", GL_COMPUTE_SHADER } };
+
+	QVector<int> pending;
+	bool linked = true;
+
+	// load cached binaries and submit the compiles of the others
+	for (int i = 0; i < variants.size(); i++) {
+		ShaderVariant& variant = variants[i];
+		if (variant.program->isLinked()) continue;
+
+		QVector<QByteArray> sources(3);
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(driverString);
+		bool loaded = true;
+		for (int s = 0; s < 3 && loaded; s++) {
+			if (!QFile::exists("./" + variant.name + stages[s].extension)) continue;
+			loaded = preprocess("./" + variant.name + stages[s].extension, variant.features, sources[s]);
+			hash.addData(stages[s].extension, 4);
+			hash.addData(sources[s]);
+		}
+
+		// a stage missing an include would compile without it, or fail with an error pointing at the wrong line, so the variant is not built
+		if (!loaded) {
+			buildLog += getKey(variant.name, variant.features) + ": a shader file or an include cannot be read\n";
+			linked = false;
+			continue;
+		}
+		variant.hash = hash.result().toHex();
+
+		variant.program->create();
+		GLuint program = variant.program->programId();
+
+		if (loadBinary(program, variant.hash)) {
+			variant.program->link();
+			cacheHits++;
+			continue;
+		}
+
+		for (int s = 0; s < 3; s++) {
+			if (sources[s].isEmpty()) continue;
+			const char* source = sources[s].constData();
+			GLuint shader = functions->glCreateShader(stages[s].type);
+			functions->glShaderSource(shader, 1, &source, 0);
+			functions->glCompileShader(shader);
+			variant.shaders.append(shader);
+		}
+		pending.append(i);
+	}
+
+	// link without waiting for the compiles
+	for (int i = 0; i < pending.size(); i++) {
+		ShaderVariant& variant = variants[pending[i]];
+		GLuint program = variant.program->programId();
+		for (int s = 0; s < variant.shaders.size(); s++)
+			functions->glAttachShader(program, variant.shaders[s]);
+		if (binarySupported)
+			functions->glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		functions->glLinkProgram(program);
+	}
+
+	// collect the results, the first query of each program waits for its own compile only
+	for (int i = 0; i < pending.size(); i++) {
+		ShaderVariant& variant = variants[pending[i]];
+		GLuint program = variant.program->programId();
+
+		GLint status = 0;
+		functions->glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status == GL_TRUE) {
+			saveBinary(program, variant.hash);
+		}
+		else {
+			GLint length = 0;
+			functions->glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			QByteArray info(qMax(length, 1), '\0');
+			functions->glGetProgramInfoLog(program, info.size(), 0, info.data());
+			for (int s = 0; s < variant.shaders.size(); s++) {
+				functions->glGetShaderiv(variant.shaders[s], GL_INFO_LOG_LENGTH, &length);
+				QByteArray shaderInfo(qMax(length, 1), '\0');
+				functions->glGetShaderInfoLog(variant.shaders[s], shaderInfo.size(), 0, shaderInfo.data());
+				info.append(shaderInfo.constData());
+			}
+			buildLog += getKey(variant.name, variant.features) + ": " + QString::fromLatin1(info.constData()) + "\n";
+			linked = false;
+		}
+
+		for (int s = 0; s < variant.shaders.size(); s++) {
+			functions->glDetachShader(program, variant.shaders[s]);
+			functions->glDeleteShader(variant.shaders[s]);
+		}
+		variant.shaders.clear();
+
+		// QOpenGLShaderProgram adopts a program linked outside of it when it owns no shaders
+		if (status == GL_TRUE)
+			variant.program->link();
+	}
+
+	return linked;
+}
+
+/*
+Description:
+	This function is used to get a variant of a shader program;
+Input:
+	@ const QString& name: the file name of the shaders without extension;
+	@ const QStringList& features: the features of the variant;
+Output:
+	@ QOpenGLShaderProgram* returnValue: the shader program, 0 if the variant is not requested;
+*/
+QOpenGLShaderProgram* ShaderLibrary::getProgram(const QString& name, const QStringList& features) const {
+	return programs.value(getKey(name, features), 0);
+}
+
+/*
+Description:
+	This function is used to get all the variants of a shader program;
+Input:
+	@ const QString& name: the file name of the shaders without extension;
+Output:
+	@ QVector<QOpenGLShaderProgram*> returnValue: the shader programs of all the variants;
+*/
+QVector<QOpenGLShaderProgram*> ShaderLibrary::getPrograms(const QString& name) const {
+	QVector<QOpenGLShaderProgram*> result;
+	for (int i = 0; i < variants.size(); i++) {
+		if (variants[i].name == name)
+			result.append(variants[i].program);
+	}
+	return result;
+}
+
+/*
+Description:
+	This function is used to get the compile and link errors of the last build;
+Input:
+	@ void parameter: void;
+Output:
+	@ const QString& returnValue: the build log;
+*/
+const QString& ShaderLibrary::log() const {
+	return buildLog;
+}
+
+/*
+Description:
+	This function is used to get the amount of variants loaded from the binary cache;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of cache hits;
+*/
+int ShaderLibrary::getCacheHits() const {
+	return cacheHits;
+}
+
+/*
+Description:
+	This function is used to check whether a shader program is the variant built for a feature set, programs not built by a shader library accept any feature set;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program;
+	@ const QStringList& features: the features required by an object;
+Output:
+	@ bool returnValue: true if the object should be drawn with the shader program;
+*/
+bool ShaderLibrary::isCompatible(QOpenGLShaderProgram* shaderProgram, const QStringList& features) {
+	QVariant programFeatures = shaderProgram->property("features");
+	if (!programFeatures.isValid()) return true;
+
+	// most feature sets are sorted already, they are only copied and sorted otherwise
+	const QStringList programList = programFeatures.toStringList();
+	if (programList == features) return true;
+	if (programList.size() != features.size()) return false;
+
+	QStringList sorted = features;
+	sorted.sort();
+	return programList == sorted;
+}
+
+/*
+Description:
+	This function is used to build the key of a variant from its name and features;
+Input:
+	@ const QString& name: the file name of the shaders without extension;
+	@ const QStringList& features: the features of the variant;
+Output:
+	@ QString returnValue: the key;
+*/
+QString ShaderLibrary::getKey(const QString& name, const QStringList& features) {
+	QStringList sorted = features;
+	sorted.sort();
+	return name + "[" + sorted.join(",") + "]";
+}
+
+/*
+Description:
+	This function is used to load a shader file, resolve its #include "file" lines and insert the defines of a variant right after its #version line;
+	every file is included once, and the included sources are covered by the hash of the variant;
+Input:
+	@ const QString& fileName: the shader file;
+	@ const QStringList& features: the features of the variant;
+	@ QByteArray& source: the shader source;
+Output:
+	@ bool returnValue: false with a warning if the file or one of its includes cannot be read;
+*/
+bool ShaderLibrary::preprocess(const QString& fileName, const QStringList& features, QByteArray& source) const {
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		qWarning("%s cannot be read", qPrintable(fileName));
+		return false;
+	}
+	source = file.readAll();
+
+	QStringList included;
+	int include;
+	while ((include = source.indexOf("#include \"")) >= 0) {
+		int begin = include + 10;
+		int end = source.indexOf('"', begin);
+		int lineEnd = source.indexOf('\n', include);
+		if (end < 0) break;
+		if (lineEnd < 0) lineEnd = source.size();
+
+		QString includeName = QString::fromLatin1(source.mid(begin, end - begin));
+		QByteArray includeSource;
+		if (!included.contains(includeName)) {
+			QFile includeFile("./" + includeName);
+			if (!includeFile.open(QIODevice::ReadOnly)) {
+				qWarning("%s includes \"%s\", which cannot be read", qPrintable(fileName), qPrintable(includeName));
+				return false;
+			}
+			includeSource = includeFile.readAll();
+			included.append(includeName);
+		}
+		source = source.left(include) + includeSource + source.mid(lineEnd);
+	}
+
+	QByteArray defines;
+	for (int i = 0; i < globalDefines.size(); i++)
+		defines += "#define " + globalDefines[i].toLatin1() + "\n";
+	for (int i = 0; i < features.size(); i++)
+		defines += "#define " + features[i].toLatin1() + "\n";
+
+	int position = 0;
+	if (source.startsWith("#version")) {
+		position = source.indexOf("\n");
+		position = position < 0 ? source.size() : position + 1;
+	}
+
+	source = source.left(position) + defines + source.mid(position);
+	return true;
+}
+
+/*
+Description:
+	This function is used to load a program binary from the cache, the binary is rejected by the driver if it no longer matches;
+Input:
+	@ GLuint program: the program object;
+	@ const QByteArray& hash: the hash of the sources, defines and driver;
+Output:
+	@ bool returnValue: true if the program is linked from the cached binary;
+*/
+bool ShaderLibrary::loadBinary(GLuint program, const QByteArray& hash) {
+	if (!binarySupported) return false;
+
+	QFile file(cacheDirectory + "/" + QString::fromLatin1(hash) + ".bin");
+	if (!file.open(QIODevice::ReadOnly)) return false;
+	QByteArray data = file.readAll();
+	if (data.size() <= (int)sizeof(GLenum)) return false;
+
+	GLenum format = 0;
+	memcpy(&format, data.constData(), sizeof(GLenum));
+	functions->glProgramBinary(program, format, data.constData() + sizeof(GLenum), data.size() - sizeof(GLenum));
+
+	GLint status = 0;
+	functions->glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+/*
+Description:
+	This function is used to save a linked program binary into the cache, the file starts with the binary format followed by the binary;
+Input:
+	@ GLuint program: the program object;
+	@ const QByteArray& hash: the hash of the sources, defines and driver;
+Output:
+	@ void returnValue: void;
+*/
+void ShaderLibrary::saveBinary(GLuint program, const QByteArray& hash) {
+	if (!binarySupported) return;
+
+	GLint length = 0;
+	functions->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	QByteArray data(sizeof(GLenum) + length, '\0');
+	GLenum format = 0;
+	functions->glGetProgramBinary(program, length, 0, &format, data.data() + sizeof(GLenum));
+	memcpy(data.data(), &format, sizeof(GLenum));
+
+	// written to a temporary file first, so that a crash never leaves a partial binary behind
+	QSaveFile file(cacheDirectory + "/" + QString::fromLatin1(hash) + ".bin");
+	if (!file.open(QIODevice::WriteOnly)) return;
+	file.write(data);
+	file.commit();
+}
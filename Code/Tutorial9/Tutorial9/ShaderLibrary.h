@@ -0,0 +1,49 @@
+#pragma once
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qvector.h>
+#include <qmap.h>
+
+class ShaderLibrary {
+public:
+	ShaderLibrary();
+	~ShaderLibrary();
+	void init();
+	void setGlobalDefines(const QStringList& defines);
+	void addProgram(const QString& name, const QStringList& features = QStringList());
+	bool build();
+	QOpenGLShaderProgram* getProgram(const QString& name, const QStringList& features = QStringList()) const;
+	QVector<QOpenGLShaderProgram*> getPrograms(const QString& name) const;
+	const QString& log() const;
+	int getCacheHits() const;
+
+	static bool isCompatible(QOpenGLShaderProgram* shaderProgram, const QStringList& features);
+
+private:
+	struct ShaderVariant {
+		QString name;
+		QStringList features;
+		QOpenGLShaderProgram* program;
+		QVector<GLuint> shaders;
+		QByteArray hash;
+	};
+
+	static QString getKey(const QString& name, const QStringList& features);
+	bool preprocess(const QString& fileName, const QStringList& features, QByteArray& source) const;
+	bool loadBinary(GLuint program, const QByteArray& hash);
+	void saveBinary(GLuint program, const QByteArray& hash);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+	QString cacheDirectory;
+	QByteArray driverString;
+	bool binarySupported;
+
+	QStringList globalDefines;
+	QVector<ShaderVariant> variants;
+	QMap<QString, QOpenGLShaderProgram*> programs;
+	QString buildLog;
+	int cacheHits;
+};
+
@@ -0,0 +1,482 @@
+#include "SimdMath.h"
+#include <qmath.h>
+#include <string.h>
+
+#ifdef SIMD_MATH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+/*
+Description:
+	This function is used to compose a translation, a rotation and a uniform scale into an affine matrix (translation * rotation * scale), which matches QMatrix4x4::translate, rotate and scale;
+Input:
+	@ const QVector3D& t: a translation vector;
+	@ const QQuaternion& r: a normalized quaternion;
+	@ float s: a scalar;
+	@ Matrix4& result: the affine matrix;
+Output:
+	@ void returnValue: void;
+*/
+static void composeAffineScalar(const QVector3D& t, const QQuaternion& r, float s, Matrix4& result) {
+	float x = r.x(), y = r.y(), z = r.z(), w = r.scalar();
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float xw = x * w, yw = y * w, zw = z * w;
+
+	float* m = result.m;
+	m[0] = (1.0f - 2.0f * (yy + zz)) * s;
+	m[1] = 2.0f * (xy + zw) * s;
+	m[2] = 2.0f * (xz - yw) * s;
+	m[3] = 0.0f;
+	m[4] = 2.0f * (xy - zw) * s;
+	m[5] = (1.0f - 2.0f * (xx + zz)) * s;
+	m[6] = 2.0f * (yz + xw) * s;
+	m[7] = 0.0f;
+	m[8] = 2.0f * (xz + yw) * s;
+	m[9] = 2.0f * (yz - xw) * s;
+	m[10] = (1.0f - 2.0f * (xx + yy)) * s;
+	m[11] = 0.0f;
+	m[12] = t.x();
+	m[13] = t.y();
+	m[14] = t.z();
+	m[15] = 1.0f;
+}
+
+/*
+Description:
+	This function is used to invert an affine matrix, the upper 3x3 block is inverted by its cofactors and the translation is rotated back, a singular matrix falls back to QMatrix4x4::inverted();
+Input:
+	@ const Matrix4& matrix: an affine matrix;
+	@ Matrix4& result: the inverse matrix;
+Output:
+	@ void returnValue: void;
+*/
+static void inverseAffineScalar(const Matrix4& matrix, Matrix4& result) {
+	const float* a = matrix.m;
+	float a00 = a[0], a10 = a[1], a20 = a[2];
+	float a01 = a[4], a11 = a[5], a21 = a[6];
+	float a02 = a[8], a12 = a[9], a22 = a[10];
+
+	float c00 = a11 * a22 - a12 * a21;
+	float c01 = a12 * a20 - a10 * a22;
+	float c02 = a10 * a21 - a11 * a20;
+
+	float determinant = a00 * c00 + a01 * c01 + a02 * c02;
+	if (qFuzzyIsNull(determinant)) {
+		result = SimdMath::fromQMatrix(SimdMath::toQMatrix(matrix).inverted());
+		return;
+	}
+	float d = 1.0f / determinant;
+
+	float i00 = c00 * d;
+	float i01 = (a02 * a21 - a01 * a22) * d;
+	float i02 = (a01 * a12 - a02 * a11) * d;
+	float i10 = c01 * d;
+	float i11 = (a00 * a22 - a02 * a20) * d;
+	float i12 = (a02 * a10 - a00 * a12) * d;
+	float i20 = c02 * d;
+	float i21 = (a01 * a20 - a00 * a21) * d;
+	float i22 = (a00 * a11 - a01 * a10) * d;
+
+	float tx = a[12], ty = a[13], tz = a[14];
+
+	float* m = result.m;
+	m[0] = i00; m[1] = i10; m[2] = i20; m[3] = 0.0f;
+	m[4] = i01; m[5] = i11; m[6] = i21; m[7] = 0.0f;
+	m[8] = i02; m[9] = i12; m[10] = i22; m[11] = 0.0f;
+	m[12] = -(i00 * tx + i01 * ty + i02 * tz);
+	m[13] = -(i10 * tx + i11 * ty + i12 * tz);
+	m[14] = -(i20 * tx + i21 * ty + i22 * tz);
+	m[15] = 1.0f;
+}
+
+/*
+Description:
+	This function is used to split an affine matrix into a translation, a rotation and a scale per axis, a matrix with a projection, a reflection or a degenerate axis cannot be split;
+Input:
+	@ const Matrix4& matrix: the matrix;
+	@ QVector3D& t: the translation vector;
+	@ QQuaternion& r: the normalized quaternion;
+	@ QVector3D& s: the length of each axis;
+Output:
+	@ bool returnValue: true if the matrix is split;
+*/
+static bool decomposeAffineScalar(const Matrix4& matrix, QVector3D& t, QQuaternion& r, QVector3D& s) {
+	const float* m = matrix.m;
+	if (m[3] != 0.0f || m[7] != 0.0f || m[11] != 0.0f || m[15] != 1.0f) return false;
+
+	QVector3D x(m[0], m[1], m[2]), y(m[4], m[5], m[6]), z(m[8], m[9], m[10]);
+	s = QVector3D(x.length(), y.length(), z.length());
+	if (qFuzzyIsNull(s.x()) || qFuzzyIsNull(s.y()) || qFuzzyIsNull(s.z())) return false;
+	x /= s.x();
+	y /= s.y();
+	z /= s.z();
+	if (QVector3D::dotProduct(QVector3D::crossProduct(x, y), z) < 0.0f) return false;
+
+	r = QQuaternion::fromAxes(x, y, z);
+	t = QVector3D(m[12], m[13], m[14]);
+	return true;
+}
+
+/*
+Description:
+	This function is used to compose translations, rotations and uniform scales into affine matrices (translation * rotation * scale), four matrices are built at once;
+Input:
+	@ const QVector3D* translations: the translation vectors;
+	@ const QQuaternion* rotations: the normalized quaternions;
+	@ const float* scales: the scalars;
+	@ Matrix4* results: the affine matrices;
+	@ int count: the amount of matrices;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::composeAffine(const QVector3D* translations, const QQuaternion* rotations, const float* scales, Matrix4* results, int count) {
+	int i = 0;
+#ifdef SIMD_MATH_USE_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		const QQuaternion* r = rotations + i;
+		const QVector3D* t = translations + i;
+
+		// one lane per matrix
+		__m128 x = _mm_set_ps(r[3].x(), r[2].x(), r[1].x(), r[0].x());
+		__m128 y = _mm_set_ps(r[3].y(), r[2].y(), r[1].y(), r[0].y());
+		__m128 z = _mm_set_ps(r[3].z(), r[2].z(), r[1].z(), r[0].z());
+		__m128 w = _mm_set_ps(r[3].scalar(), r[2].scalar(), r[1].scalar(), r[0].scalar());
+		__m128 s = _mm_loadu_ps(scales + i);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+		__m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), s);
+		__m128 m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, zw)), s);
+		__m128 m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, yw)), s);
+		__m128 m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, zw)), s);
+		__m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), s);
+		__m128 m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, xw)), s);
+		__m128 m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, yw)), s);
+		__m128 m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, xw)), s);
+		__m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), s);
+		__m128 tx = _mm_set_ps(t[3].x(), t[2].x(), t[1].x(), t[0].x());
+		__m128 ty = _mm_set_ps(t[3].y(), t[2].y(), t[1].y(), t[0].y());
+		__m128 tz = _mm_set_ps(t[3].z(), t[2].z(), t[1].z(), t[0].z());
+		__m128 tw = one;
+
+		// transpose the lanes back into the columns of each matrix
+		__m128 c0 = zero;
+		_MM_TRANSPOSE4_PS(m00, m10, m20, c0);
+		__m128 c1 = zero;
+		_MM_TRANSPOSE4_PS(m01, m11, m21, c1);
+		__m128 c2 = zero;
+		_MM_TRANSPOSE4_PS(m02, m12, m22, c2);
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+
+		Matrix4* result = results + i;
+		_mm_storeu_ps(result[0].m + 0, m00); _mm_storeu_ps(result[0].m + 4, m01); _mm_storeu_ps(result[0].m + 8, m02); _mm_storeu_ps(result[0].m + 12, tx);
+		_mm_storeu_ps(result[1].m + 0, m10); _mm_storeu_ps(result[1].m + 4, m11); _mm_storeu_ps(result[1].m + 8, m12); _mm_storeu_ps(result[1].m + 12, ty);
+		_mm_storeu_ps(result[2].m + 0, m20); _mm_storeu_ps(result[2].m + 4, m21); _mm_storeu_ps(result[2].m + 8, m22); _mm_storeu_ps(result[2].m + 12, tz);
+		_mm_storeu_ps(result[3].m + 0, c0); _mm_storeu_ps(result[3].m + 4, c1); _mm_storeu_ps(result[3].m + 8, c2); _mm_storeu_ps(result[3].m + 12, tw);
+	}
+#endif
+	for (; i < count; i++)
+		composeAffineScalar(translations[i], rotations[i], scales[i], results[i]);
+}
+
+/*
+Description:
+	This function is used to multiply pairs of affine matrices (a * b);
+Input:
+	@ const Matrix4* a: the matrices on the left;
+	@ const Matrix4* b: the matrices on the right;
+	@ Matrix4* results: the products, which may alias a or b;
+	@ int count: the amount of pairs;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::multiplyAffine(const Matrix4* a, const Matrix4* b, Matrix4* results, int count) {
+	for (int i = 0; i < count; i++)
+		multiplyAffine(a[i], b[i], results[i]);
+}
+
+/*
+Description:
+	This function is used to multiply two affine matrices (a * b), each column of the product is a linear combination of the columns of a;
+Input:
+	@ const Matrix4& a: the matrix on the left;
+	@ const Matrix4& b: the matrix on the right;
+	@ Matrix4& result: the product, which may alias a or b;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::multiplyAffine(const Matrix4& a, const Matrix4& b, Matrix4& result) {
+#ifdef SIMD_MATH_USE_SSE
+	__m128 a0 = _mm_loadu_ps(a.m + 0);
+	__m128 a1 = _mm_loadu_ps(a.m + 4);
+	__m128 a2 = _mm_loadu_ps(a.m + 8);
+	__m128 a3 = _mm_loadu_ps(a.m + 12);
+
+	__m128 c[4];
+	for (int j = 0; j < 4; j++) {
+		const float* column = b.m + 4 * j;
+		c[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(column[0])), _mm_mul_ps(a1, _mm_set1_ps(column[1]))), _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+	}
+	c[3] = _mm_add_ps(c[3], a3);
+
+	for (int j = 0; j < 4; j++)
+		_mm_storeu_ps(result.m + 4 * j, c[j]);
+#else
+	float c[16];
+	for (int j = 0; j < 4; j++) {
+		const float* column = b.m + 4 * j;
+		for (int k = 0; k < 4; k++)
+			c[4 * j + k] = a.m[k] * column[0] + a.m[4 + k] * column[1] + a.m[8 + k] * column[2];
+	}
+	for (int k = 0; k < 4; k++)
+		c[12 + k] += a.m[12 + k];
+	memcpy(result.m, c, sizeof(c));
+#endif
+}
+
+/*
+Description:
+	This function is used to invert affine matrices, four matrices are inverted at once, a singular matrix falls back to QMatrix4x4::inverted();
+Input:
+	@ const Matrix4* matrices: the affine matrices;
+	@ Matrix4* results: the inverse matrices, which must not alias the input;
+	@ int count: the amount of matrices;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::inverseAffine(const Matrix4* matrices, Matrix4* results, int count) {
+	int i = 0;
+#ifdef SIMD_MATH_USE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(0.00001f);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	for (; i + 4 <= count; i += 4) {
+		const Matrix4* in = matrices + i;
+
+		// transpose so that each register holds one element of four matrices
+		__m128 a00 = _mm_loadu_ps(in[0].m + 0), a10 = _mm_loadu_ps(in[1].m + 0), a20 = _mm_loadu_ps(in[2].m + 0), unused0 = _mm_loadu_ps(in[3].m + 0);
+		_MM_TRANSPOSE4_PS(a00, a10, a20, unused0);
+		__m128 a01 = _mm_loadu_ps(in[0].m + 4), a11 = _mm_loadu_ps(in[1].m + 4), a21 = _mm_loadu_ps(in[2].m + 4), unused1 = _mm_loadu_ps(in[3].m + 4);
+		_MM_TRANSPOSE4_PS(a01, a11, a21, unused1);
+		__m128 a02 = _mm_loadu_ps(in[0].m + 8), a12 = _mm_loadu_ps(in[1].m + 8), a22 = _mm_loadu_ps(in[2].m + 8), unused2 = _mm_loadu_ps(in[3].m + 8);
+		_MM_TRANSPOSE4_PS(a02, a12, a22, unused2);
+		__m128 tx = _mm_loadu_ps(in[0].m + 12), ty = _mm_loadu_ps(in[1].m + 12), tz = _mm_loadu_ps(in[2].m + 12), unused3 = _mm_loadu_ps(in[3].m + 12);
+		_MM_TRANSPOSE4_PS(tx, ty, tz, unused3);
+
+		__m128 c00 = _mm_sub_ps(_mm_mul_ps(a11, a22), _mm_mul_ps(a12, a21));
+		__m128 c01 = _mm_sub_ps(_mm_mul_ps(a12, a20), _mm_mul_ps(a10, a22));
+		__m128 c02 = _mm_sub_ps(_mm_mul_ps(a10, a21), _mm_mul_ps(a11, a20));
+		__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a00, c00), _mm_mul_ps(a01, c01)), _mm_mul_ps(a02, c02));
+		int singular = _mm_movemask_ps(_mm_cmple_ps(_mm_and_ps(determinant, absMask), epsilon));
+		__m128 d = _mm_div_ps(one, determinant);
+
+		__m128 i00 = _mm_mul_ps(c00, d);
+		__m128 i01 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a02, a21), _mm_mul_ps(a01, a22)), d);
+		__m128 i02 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a01, a12), _mm_mul_ps(a02, a11)), d);
+		__m128 i10 = _mm_mul_ps(c01, d);
+		__m128 i11 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a00, a22), _mm_mul_ps(a02, a20)), d);
+		__m128 i12 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a02, a10), _mm_mul_ps(a00, a12)), d);
+		__m128 i20 = _mm_mul_ps(c02, d);
+		__m128 i21 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a01, a20), _mm_mul_ps(a00, a21)), d);
+		__m128 i22 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a00, a11), _mm_mul_ps(a01, a10)), d);
+
+		__m128 t0 = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(_mm_mul_ps(i00, tx), _mm_mul_ps(i01, ty)), _mm_mul_ps(i02, tz)));
+		__m128 t1 = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(_mm_mul_ps(i10, tx), _mm_mul_ps(i11, ty)), _mm_mul_ps(i12, tz)));
+		__m128 t2 = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(_mm_mul_ps(i20, tx), _mm_mul_ps(i21, ty)), _mm_mul_ps(i22, tz)));
+		__m128 t3 = one;
+
+		__m128 w0 = zero, w1 = zero, w2 = zero;
+		_MM_TRANSPOSE4_PS(i00, i10, i20, w0);
+		_MM_TRANSPOSE4_PS(i01, i11, i21, w1);
+		_MM_TRANSPOSE4_PS(i02, i12, i22, w2);
+		_MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+
+		Matrix4* result = results + i;
+		_mm_storeu_ps(result[0].m + 0, i00); _mm_storeu_ps(result[0].m + 4, i01); _mm_storeu_ps(result[0].m + 8, i02); _mm_storeu_ps(result[0].m + 12, t0);
+		_mm_storeu_ps(result[1].m + 0, i10); _mm_storeu_ps(result[1].m + 4, i11); _mm_storeu_ps(result[1].m + 8, i12); _mm_storeu_ps(result[1].m + 12, t1);
+		_mm_storeu_ps(result[2].m + 0, i20); _mm_storeu_ps(result[2].m + 4, i21); _mm_storeu_ps(result[2].m + 8, i22); _mm_storeu_ps(result[2].m + 12, t2);
+		_mm_storeu_ps(result[3].m + 0, w0); _mm_storeu_ps(result[3].m + 4, w1); _mm_storeu_ps(result[3].m + 8, w2); _mm_storeu_ps(result[3].m + 12, t3);
+
+		for (int k = 0; k < 4; k++) {
+			if (singular & (1 << k))
+				inverseAffineScalar(in[k], result[k]);
+		}
+	}
+#endif
+	for (; i < count; i++)
+		inverseAffineScalar(matrices[i], results[i]);
+}
+
+/*
+Description:
+	This function is used to transform bounding spheres, the center is transformed as a point and the radius is scaled by the longest axis of the matrix;
+Input:
+	@ const Matrix4* matrices: the affine matrices;
+	@ const QVector4D* spheres: the spheres (x, y, z, radius);
+	@ QVector4D* results: the transformed spheres;
+	@ int count: the amount of spheres;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::transformSpheres(const Matrix4* matrices, const QVector4D* spheres, QVector4D* results, int count) {
+	for (int i = 0; i < count; i++) {
+		const float* m = matrices[i].m;
+		const QVector4D& sphere = spheres[i];
+#ifdef SIMD_MATH_USE_SSE
+		__m128 c0 = _mm_loadu_ps(m + 0);
+		__m128 c1 = _mm_loadu_ps(m + 4);
+		__m128 c2 = _mm_loadu_ps(m + 8);
+		__m128 c3 = _mm_loadu_ps(m + 12);
+		__m128 center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(sphere.x())), _mm_mul_ps(c1, _mm_set1_ps(sphere.y()))), _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(sphere.z())), c3));
+
+		// squared lengths of the three axes, the fourth column is only there to complete the transpose
+		__m128 s0 = _mm_mul_ps(c0, c0), s1 = _mm_mul_ps(c1, c1), s2 = _mm_mul_ps(c2, c2), s3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+		__m128 lengths = _mm_add_ps(_mm_add_ps(s0, s1), s2);
+		__m128 longest = _mm_max_ps(lengths, _mm_max_ps(_mm_shuffle_ps(lengths, lengths, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(lengths, lengths, _MM_SHUFFLE(3, 1, 0, 2))));
+
+		float values[4];
+		_mm_storeu_ps(values, center);
+		results[i] = QVector4D(values[0], values[1], values[2], sphere.w() * qSqrt(_mm_cvtss_f32(longest)));
+#else
+		float x = sphere.x(), y = sphere.y(), z = sphere.z();
+		float l0 = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+		float l1 = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+		float l2 = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+		results[i] = QVector4D(
+			m[0] * x + m[4] * y + m[8] * z + m[12],
+			m[1] * x + m[5] * y + m[9] * z + m[13],
+			m[2] * x + m[6] * y + m[10] * z + m[14],
+			sphere.w() * qSqrt(qMax(l0, qMax(l1, l2))));
+#endif
+	}
+}
+
+/*
+Description:
+	This function is used to transform axis aligned bounding boxes, the center is transformed as a point and the extent by the absolute matrix, which gives the tight box of the transformed box;
+Input:
+	@ const Matrix4* matrices: the affine matrices;
+	@ const QVector3D* minimums: the minimum corners;
+	@ const QVector3D* maximums: the maximum corners;
+	@ QVector3D* resultMinimums: the minimum corners of the transformed boxes;
+	@ QVector3D* resultMaximums: the maximum corners of the transformed boxes;
+	@ int count: the amount of boxes;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::transformBoxes(const Matrix4* matrices, const QVector3D* minimums, const QVector3D* maximums, QVector3D* resultMinimums, QVector3D* resultMaximums, int count) {
+#ifdef SIMD_MATH_USE_SSE
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+#endif
+	for (int i = 0; i < count; i++) {
+		const float* m = matrices[i].m;
+		QVector3D center = (minimums[i] + maximums[i]) * 0.5f;
+		QVector3D extent = (maximums[i] - minimums[i]) * 0.5f;
+#ifdef SIMD_MATH_USE_SSE
+		__m128 c0 = _mm_loadu_ps(m + 0);
+		__m128 c1 = _mm_loadu_ps(m + 4);
+		__m128 c2 = _mm_loadu_ps(m + 8);
+		__m128 c3 = _mm_loadu_ps(m + 12);
+		__m128 newCenter = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(center.x())), _mm_mul_ps(c1, _mm_set1_ps(center.y()))), _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(center.z())), c3));
+		__m128 newExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(c0, absMask), _mm_set1_ps(extent.x())), _mm_mul_ps(_mm_and_ps(c1, absMask), _mm_set1_ps(extent.y()))), _mm_mul_ps(_mm_and_ps(c2, absMask), _mm_set1_ps(extent.z())));
+
+		float low[4], high[4];
+		_mm_storeu_ps(low, _mm_sub_ps(newCenter, newExtent));
+		_mm_storeu_ps(high, _mm_add_ps(newCenter, newExtent));
+		resultMinimums[i] = QVector3D(low[0], low[1], low[2]);
+		resultMaximums[i] = QVector3D(high[0], high[1], high[2]);
+#else
+		float x = center.x(), y = center.y(), z = center.z();
+		float ex = extent.x(), ey = extent.y(), ez = extent.z();
+		QVector3D newCenter(
+			m[0] * x + m[4] * y + m[8] * z + m[12],
+			m[1] * x + m[5] * y + m[9] * z + m[13],
+			m[2] * x + m[6] * y + m[10] * z + m[14]);
+		QVector3D newExtent(
+			qAbs(m[0]) * ex + qAbs(m[4]) * ey + qAbs(m[8]) * ez,
+			qAbs(m[1]) * ex + qAbs(m[5]) * ey + qAbs(m[9]) * ez,
+			qAbs(m[2]) * ex + qAbs(m[6]) * ey + qAbs(m[10]) * ez);
+		resultMinimums[i] = newCenter - newExtent;
+		resultMaximums[i] = newCenter + newExtent;
+#endif
+	}
+}
+
+/*
+Description:
+	This function is used to blend two affine matrices, the translations and scales are blended linearly and the rotations along the shorter arc,
+	so a rotating transform keeps its shape, matrices that cannot be split into these parts are blended element by element;
+Input:
+	@ const Matrix4& a: the matrix at 0;
+	@ const Matrix4& b: the matrix at 1;
+	@ float t: the blend factor between 0 and 1;
+	@ Matrix4& result: the blended matrix, which may alias a or b;
+Output:
+	@ void returnValue: void;
+*/
+void SimdMath::interpolateAffine(const Matrix4& a, const Matrix4& b, float t, Matrix4& result) {
+	QVector3D ta, tb, sa, sb;
+	QQuaternion ra, rb;
+	if (!decomposeAffineScalar(a, ta, ra, sa) || !decomposeAffineScalar(b, tb, rb, sb)) {
+		for (int k = 0; k < 16; k++)
+			result.m[k] = a.m[k] + (b.m[k] - a.m[k]) * t;
+		return;
+	}
+
+	QVector3D scale = sa + (sb - sa) * t;
+	composeAffineScalar(ta + (tb - ta) * t, QQuaternion::nlerp(ra, rb, t), 1.0f, result);
+	for (int k = 0; k < 3; k++) {
+		result.m[k] *= scale.x();
+		result.m[4 + k] *= scale.y();
+		result.m[8 + k] *= scale.z();
+	}
+}
+
+/*
+Description:
+	This function is used to copy a QMatrix4x4 into a Matrix4;
+Input:
+	@ const QMatrix4x4& matrix: the matrix;
+Output:
+	@ Matrix4 returnValue: the matrix;
+*/
+Matrix4 SimdMath::fromQMatrix(const QMatrix4x4& matrix) {
+	Matrix4 result;
+	memcpy(result.m, matrix.constData(), sizeof(result.m));
+	return result;
+}
+
+/*
+Description:
+	This function is used to copy a Matrix4 into a QMatrix4x4;
+Input:
+	@ const Matrix4& matrix: the matrix;
+Output:
+	@ QMatrix4x4 returnValue: the matrix;
+*/
+QMatrix4x4 SimdMath::toQMatrix(const Matrix4& matrix) {
+	QMatrix4x4 result;
+	memcpy(result.data(), matrix.m, sizeof(matrix.m));
+	return result;
+}
+
+/*
+Description:
+	This function is used to get the identity matrix;
+Input:
+	@ void parameter: void;
+Output:
+	@ const Matrix4& returnValue: the identity matrix;
+*/
+const Matrix4& SimdMath::identity() {
+	static const Matrix4 matrix = { { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } };
+	return matrix;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <qmatrix4x4.h>
+#include <qquaternion.h>
+#include <qvector3d.h>
+#include <qvector4d.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_MATH_USE_SSE
+#endif
+
+// a column-major 4x4 matrix with the same memory layout as QMatrix4x4::constData(), without the type flags of QMatrix4x4
+struct Matrix4 {
+	float m[16];
+};
+
+class SimdMath {
+public:
+	static void composeAffine(const QVector3D* translations, const QQuaternion* rotations, const float* scales, Matrix4* results, int count);
+	static void multiplyAffine(const Matrix4* a, const Matrix4* b, Matrix4* results, int count);
+	static void multiplyAffine(const Matrix4& a, const Matrix4& b, Matrix4& result);
+	static void inverseAffine(const Matrix4* matrices, Matrix4* results, int count);
+	static void transformSpheres(const Matrix4* matrices, const QVector4D* spheres, QVector4D* results, int count);
+	static void transformBoxes(const Matrix4* matrices, const QVector3D* minimums, const QVector3D* maximums, QVector3D* resultMinimums, QVector3D* resultMaximums, int count);
+	static void interpolateAffine(const Matrix4& a, const Matrix4& b, float t, Matrix4& result);
+
+	static Matrix4 fromQMatrix(const QMatrix4x4& matrix);
+	static QMatrix4x4 toQMatrix(const Matrix4& matrix);
+	static const Matrix4& identity();
+};
+
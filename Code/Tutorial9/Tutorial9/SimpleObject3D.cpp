@@ -1,4 +1,7 @@
 #include "SimpleObject3D.h"
+#include "CommandBuffer.h"
+#include "Prefab3D.h"
+#include "GLStateCache.h"
 
 /*
 Description:
@@ -7,8 +10,7 @@ Input:
 	@ void parameter: void;
 */
 SimpleObject3D::SimpleObject3D() :
-	indexBuffer(QOpenGLBuffer::IndexBuffer), texture(0) {
-	s = 1.0f;
+	geometry(0), texture(0) {
 }
 
 /*
@@ -20,8 +22,7 @@ Input:
 	@ const QImage & image: a given texture image;
 */
 SimpleObject3D::SimpleObject3D(const QVector<Vertex>& vertices, const QVector<GLuint>& indices, Material* material) :
-	indexBuffer(QOpenGLBuffer::IndexBuffer), texture(0) {
-	s = 1.0f;
+	geometry(0), texture(0) {
 	init(vertices, indices, material);
 }
 
@@ -32,14 +33,9 @@ Input:
 	@ void patameter: void;
 */
 SimpleObject3D::~SimpleObject3D() {
-	if (vertexBuffer.isCreated())
-		vertexBuffer.destroy();
-	if (indexBuffer.isCreated())
-		indexBuffer.destroy();
-	if (texture != 0) {
-		if (texture->isCreated())
-			texture->destroy();
-	}
+	ResourceCache::getDefault()->releaseGeometry(geometry);
+	ResourceCache::getDefault()->releaseTexture(texture);
+	ResourceCache::getDefault()->releaseTextureLayer(textureLayer);
 }
 
 /*
@@ -51,41 +47,26 @@ Input:
 	@ const QImage & image: a given texture image;
 */
 void SimpleObject3D::init(const QVector<Vertex>& vertices, const QVector<GLuint>& indices, Material *material) {
+	// the new resources are acquired first, so that a payload shared with the old one is not destroyed in between
+	ResourceCache* cache = ResourceCache::getDefault();
+	ResourceCache::Geometry* oldGeometry = geometry;
+	QOpenGLTexture* oldTexture = texture;
+	TextureArrayPool::Layer oldTextureLayer = textureLayer;
 
-	if (vertexBuffer.isCreated())
-		vertexBuffer.destroy();
-	if (indexBuffer.isCreated())
-		indexBuffer.destroy();
-	if (texture != 0) {
-		if (texture->isCreated()) {
-			delete texture;
-			texture = 0;
-		}
+	geometry = cache->acquireGeometry(vertices, indices);
+	if (cache->isUsingTextureArrays()) {
+		texture = 0;
+		textureLayer = cache->acquireTextureLayer(material);
+	}
+	else {
+		texture = cache->acquireTexture(material);
+		textureLayer = TextureArrayPool::Layer();
 	}
-
-	vertexBuffer.create();
-	vertexBuffer.bind();
-	vertexBuffer.allocate(vertices.constData(), vertices.size() * sizeof(Vertex));
-	vertexBuffer.release();
-
-	indexBuffer.create();
-	indexBuffer.bind();
-	indexBuffer.allocate(indices.constData(), indices.size() * sizeof(GLuint));
-	indexBuffer.release();
-
 	this->material = material;
 
-	texture = new QOpenGLTexture((material->getDiffuseMap()).mirrored());
-
-	// Set nearest filtering mode for texture minification
-	texture->setMinificationFilter(QOpenGLTexture::Linear);
-
-	// Set bilinear filtering mode for texture magnification
-	texture->setMagnificationFilter(QOpenGLTexture::Linear);
-
-	// Wrap texture coordinates by repreating
-	// f. ex. texture coordinate (1.1, 1.2) is same as 0.1, 0.2;
-	texture->setWrapMode(QOpenGLTexture::Repeat);
+	cache->releaseGeometry(oldGeometry);
+	cache->releaseTexture(oldTexture);
+	cache->releaseTextureLayer(oldTextureLayer);
 }
 
 /*
@@ -97,7 +78,7 @@ Output:
 	@ void returnValue: void;
 */
 void SimpleObject3D::rotate(const QQuaternion& r) {
-	this->r = r * this->r;
+	transform.rotate(r);
 }
 
 /*
@@ -109,7 +90,7 @@ Output:
 	@ void returnValue: void;
 */
 void SimpleObject3D::translate(const QVector3D& t) {
-	this->t += t;
+	transform.translate(t);
 }
 
 /*
@@ -121,7 +102,7 @@ Output:
 	@ void returnValue: void;
 */
 void SimpleObject3D::scale(const float& s) {
-	this->s *= s;
+	transform.scale(s);
 }
 
 /*
@@ -133,12 +114,79 @@ Output:
 	@ void returnValue: void;
 */
 void SimpleObject3D::setGlobalTransform(const QMatrix4x4& g) {
-	this->g = g;
+	transform.setGlobalTransform(g);
+}
+
+/*
+Description:
+	This function is used to attach the object to the transform of its parent, so that its world matrix follows the parent;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::setParentTransform(Transform3D* parent) {
+	transform.setParent(parent);
+}
+
+/*
+Description:
+	This function is used to set the procedural animation of the object, which is evaluated in the vertex shader, so the object needs no update on the CPU;
+Input:
+	@ const Animation3D& animation: the animation;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::setAnimation(const Animation3D& animation) {
+	this->animation = animation;
 }
 
 /*
 Description:
-	This function is used to draw all the objects in a group, which calls Object3D::draw(QOpenGLShaderProgram*, QOpenGLFunctions*);
+	This function is used to get the procedural animation of the object;
+Input:
+	@ void parameter: void;
+Output:
+	@ const Animation3D& returnValue: the animation;
+*/
+const Animation3D& SimpleObject3D::getAnimation() const {
+	return animation;
+}
+
+/*
+Description:
+	This function is used to set the model matrix and the animation of the object, a store evaluated on the GPU only needs the handle of the transform;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program including Transform.glsl and Animation.glsl;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::setModelUniforms(QOpenGLShaderProgram* shaderProgram) {
+	if (transform.isRenderedOnDevice()) {
+		shaderProgram->setUniformValue("u_transformIndex", transform.getHandle());
+	}
+	else {
+		shaderProgram->setUniformValue("u_transformIndex", -1);
+		shaderProgram->setUniformValue("u_modelMatrix", transform.getRenderMatrix());
+	}
+	shaderProgram->setUniformValue("u_animation", animation.getParameters());
+}
+
+/*
+Description:
+	This function is used to draw the triangles of the geometry from the bound buffers of its block, the ranges are addressed by the first index and the base vertex;
+Input:
+	@ int instanceCount: the amount of instances;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::drawElements(int instanceCount) {
+	ResourceCache::getDefault()->getGeometryArena()->drawElements(geometry->allocation, instanceCount);
+}
+
+/*
+Description:
+	This function is used to draw the object, which draws a single instance;
 Input:
 	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
 	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
@@ -146,27 +194,42 @@ Output:
 	@ void returnValue: void;
 */
 void SimpleObject3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	drawInstanced(shaderProgram, functions, 1);
+}
 
-	if (!vertexBuffer.isCreated() || !indexBuffer.isCreated()) return;
+/*
+Description:
+	This function is used to draw a number of instances of the object with one draw call, the instances share the buffers, the texture and the material;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	// the geometry arena draws the elements, see drawElements(int)
+	Q_UNUSED(functions);
 
-	texture->bind(0);
+	if (geometry == 0) return;
+
+	// objects are drawn once per shader variant, only the matching variant draws the object
+	if (!ShaderLibrary::isCompatible(shaderProgram, material->getShaderFeatures())) return;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	if (texture != 0) cache->bindTexture(0, texture);
+	else ResourceCache::getDefault()->getTextureArrays()->bind(textureLayer.array, 0);
 	shaderProgram->setUniformValue("u_texture", 0);
+	shaderProgram->setUniformValue("u_textureLayer", textureLayer.layer);
 	shaderProgram->setUniformValue("u_materialProperty.diffuseColor", material->getDiffuseColor());
 	shaderProgram->setUniformValue("u_materialProperty.ambienceColor", material->getAmbienceColor());
 	shaderProgram->setUniformValue("u_materialProperty.specularColor", material->getSpecularColor());
 	shaderProgram->setUniformValue("u_materialProperty.shinnes", material->getShinnes());
-	shaderProgram->setUniformValue("u_isUsingDiffuseMap", material->isUsingDiffuseMap());
-
-	QMatrix4x4 modelMatrix;
-	modelMatrix.setToIdentity();
-	modelMatrix.translate(t);
-	modelMatrix.rotate(r);
-	modelMatrix.scale(s);
-	modelMatrix = g * modelMatrix;
 
-	shaderProgram->setUniformValue("u_modelMatrix", modelMatrix);
+	setModelUniforms(shaderProgram);
 
-	vertexBuffer.bind();
+	GeometryArena::Block* block = ResourceCache::getDefault()->getGeometryArena()->getBlock(geometry->allocation.block);
+	cache->bindBuffer(block->vertexBuffer);
 
 	int offset = 0;
 
@@ -186,11 +249,105 @@ void SimpleObject3D::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions*
 	shaderProgram->enableAttributeArray(normLoc);
 	shaderProgram->setAttributeBuffer(normLoc, GL_FLOAT, offset, 3, sizeof(Vertex));
 
-	indexBuffer.bind();
+	cache->bindBuffer(block->indexBuffer);
+
+	drawElements(instanceCount);
+}
+/*
+Description:
+	This function is used to draw the depth of the object using the position-only vertex stream, which is used by the depth prepass;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	drawDepthInstanced(shaderProgram, functions, 1);
+}
+
+/*
+Description:
+	This function is used to draw the depth of a number of instances of the object with one draw call, which is used by the depth prepass;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+	@ int instanceCount: the amount of instances, whose matrices are bound by a Prefab3D;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) {
+	// the geometry arena draws the elements, see drawElements(int)
+	Q_UNUSED(functions);
+
+	if (geometry == 0) return;
+
+	setModelUniforms(shaderProgram);
 
-	functions->glDrawElements(GL_TRIANGLES, indexBuffer.size(), GL_UNSIGNED_INT, 0);
+	GLStateCache* cache = GLStateCache::getDefault();
+	GeometryArena::Block* block = ResourceCache::getDefault()->getGeometryArena()->getBlock(geometry->allocation.block);
+	cache->bindBuffer(block->positionBuffer);
 
-	vertexBuffer.release();
-	indexBuffer.release();
-	texture->release();
-}
\ No newline at end of file
+	int verLoc = shaderProgram->attributeLocation("a_position");
+	shaderProgram->enableAttributeArray(verLoc);
+	shaderProgram->setAttributeBuffer(verLoc, GL_FLOAT, 0, 3, sizeof(QVector3D));
+
+	cache->bindBuffer(block->indexBuffer);
+
+	drawElements(instanceCount);
+}
+
+/*
+Description:
+	This function is used to record the draws of the object, which records a single instance;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::record(CommandBuffer* commands) {
+	recordInstanced(commands, 0);
+}
+
+/*
+Description:
+	This function is used to record the draws of the object for every pass, the model matrix, the animation and the material are copied into the commands, so nothing is read when they are replayed;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+	@ Prefab3D* prefab: the prefab whose instance matrices are bound, 0 for a single copy;
+Output:
+	@ void returnValue: void;
+*/
+void SimpleObject3D::recordInstanced(CommandBuffer* commands, Prefab3D* prefab) {
+
+	if (geometry == 0) return;
+
+	DrawCommand command;
+	command.geometry = geometry;
+	command.order = transform.getHandle();
+	if (transform.isRenderedOnDevice())
+		command.transformIndex = transform.getHandle();
+	else
+		command.modelMatrix = transform.getRenderMatrix();
+	command.animation = animation.getParameters();
+	if (prefab != 0) {
+		command.prefab = prefab;
+		command.instanceCount = prefab->getInstanceCount();
+	}
+
+	if (commands->isDepthPassRecorded()) {
+		command.pass = DrawCommand::DepthPass;
+		commands->record(command);
+	}
+
+	command.pass = DrawCommand::ColorPass;
+	command.texture = texture;
+	command.textureArray = textureLayer.array;
+	command.textureLayer = textureLayer.layer;
+	command.material = material;
+	command.diffuseColor = material->getDiffuseColor();
+	command.ambienceColor = material->getAmbienceColor();
+	command.specularColor = material->getSpecularColor();
+	command.shinnes = material->getShinnes();
+	commands->record(command);
+}
@@ -4,9 +4,15 @@
 #include <qvector2d.h>
 #include <qopengltexture.h>
 #include <qopenglfunctions.h>
+#include <qopenglextrafunctions.h>
+#include <qopenglcontext.h>
 #include <qopenglshaderprogram.h>
 #include "Transformational.h"
 #include "Material.h"
+#include "ShaderLibrary.h"
+#include "Animation3D.h"
+#include "ObjectPool.h"
+#include "ResourceCache.h"
 
 struct Vertex {
 	Vertex() {};
@@ -18,7 +24,7 @@ struct Vertex {
 	QVector3D normal;
 };
 
-class SimpleObject3D : public Transformational {
+class SimpleObject3D : public Transformational, public PoolAllocated<SimpleObject3D> {
 public:
 	SimpleObject3D();
 	SimpleObject3D(const QVector<Vertex>& vertices, const QVector<GLuint>& indices, Material* material);
@@ -28,17 +34,28 @@ public:
 	void translate(const QVector3D& t);
 	void scale(const float& s);
 	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
+	void setAnimation(const Animation3D& animation);
+	const Animation3D& getAnimation() const;
 	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount);
+	void record(CommandBuffer* commands);
+	void recordInstanced(CommandBuffer* commands, Prefab3D* prefab);
 
 private:
-	QOpenGLBuffer vertexBuffer;
-	QOpenGLBuffer indexBuffer;
+	void setModelUniforms(QOpenGLShaderProgram* shaderProgram);
+	void drawElements(int instanceCount);
+
+	// the ranges of the geometry and the texture are shared with every object of identical content
+	ResourceCache::Geometry* geometry;
 	QOpenGLTexture* texture;
+	// the layer of the diffuse map when the cache packs them into texture arrays, the texture is 0 then
+	TextureArrayPool::Layer textureLayer;
 
-	QQuaternion r;
-	QVector3D t;
-	float s;
-	QMatrix4x4 g;
+	Transform3D transform;
+	Animation3D animation;
 
 	Material* material;
 };
@@ -0,0 +1,213 @@
+#include "SimulationThread.h"
+
+/*
+Description:
+	This function is a constructor, the thread is started by QThread::start();
+Input:
+	@ const std::function<void()>& step: the function advancing the scene by one step of the interval, which is called on the simulation thread;
+	@ const std::function<void()>& capturePrevious: the function keeping the state the published state is blended from, which is called on the simulation thread before the last step, or before the posted commands when no step is due;
+	@ const std::function<void()>& publish: the function handing the state of the latest step to the renderer, which is called on the simulation thread once after the steps due;
+	@ int interval: the size of a step in milliseconds;
+*/
+SimulationThread::SimulationThread(const std::function<void()>& step, const std::function<void()>& capturePrevious, const std::function<void()>& publish, int interval) :
+	step(step), capturePrevious(capturePrevious), publish(publish), interval(qMax(interval, 1)), paused(0), stateTime(0), stepCount(0), quit(0) {
+	clock.start();
+}
+
+/*
+Description:
+	This function is a destructor, which stops the thread;
+Input:
+	@ void patameter: void;
+*/
+SimulationThread::~SimulationThread() {
+	stop();
+}
+
+/*
+Description:
+	This function is used to post a command to the simulation thread, the command is run before the next step;
+Input:
+	@ const std::function<void()>& command: the command;
+Output:
+	@ void returnValue: void;
+*/
+void SimulationThread::post(const std::function<void()>& command) {
+	QMutexLocker locker(&commandMutex);
+	commands.append(command);
+	commandCondition.wakeOne();
+}
+
+/*
+Description:
+	This function is used to stop the thread and wait until the current step is done;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void SimulationThread::stop() {
+	commandMutex.lock();
+	quit.storeRelease(1);
+	commandCondition.wakeOne();
+	commandMutex.unlock();
+	wait();
+}
+
+/*
+Description:
+	This function is used to pause or resume the steps, a paused thread still runs the posted commands and publishes their result, the time paused is not simulated;
+Input:
+	@ bool paused: true to pause the steps;
+Output:
+	@ void returnValue: void;
+*/
+void SimulationThread::setPaused(bool paused) {
+	QMutexLocker locker(&commandMutex);
+	this->paused.storeRelease(paused ? 1 : 0);
+	commandCondition.wakeOne();
+}
+
+/*
+Description:
+	This function is used to check whether the steps are paused;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the steps are paused;
+*/
+bool SimulationThread::isPaused() const {
+	return paused.loadAcquire() != 0;
+}
+
+/*
+Description:
+	This function is used to get the amount of steps run so far;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of steps;
+*/
+int SimulationThread::getStepCount() const {
+	return stepCount.loadAcquire();
+}
+
+/*
+Description:
+	This function is used to get the size of a step;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the size of a step in milliseconds;
+*/
+int SimulationThread::getInterval() const {
+	return interval;
+}
+
+/*
+Description:
+	This function is used to get the simulated time, which only advances in whole steps and does not include the time dropped while the simulation was behind;
+Input:
+	@ void parameter: void;
+Output:
+	@ float returnValue: the simulated time in seconds;
+*/
+float SimulationThread::getSimulationTime() const {
+	return stepCount.loadAcquire() * (interval / 1000.0f);
+}
+
+/*
+Description:
+	This function is used to read the clock the steps are scheduled by, which can be read by any thread;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the time since the thread is created in nanoseconds;
+*/
+qint64 SimulationThread::getClockTime() const {
+	return clock.nsecsElapsed();
+}
+
+/*
+Description:
+	This function is used to get the clock time the state of the latest step belongs to, a frame drawn at a later clock time blends the last two steps;
+Input:
+	@ void parameter: void;
+Output:
+	@ qint64 returnValue: the clock time in nanoseconds;
+*/
+qint64 SimulationThread::getStateTime() const {
+	return stateTime.loadAcquire();
+}
+
+/*
+Description:
+	This function is used to run the steps due by the clock until the thread stops, the posted commands are run first and the new state is published after the steps;
+	the amount of steps is only decided by the clock, so the speed of the simulation does not depend on the pace of the loop, and the steps run at once are bounded;
+	the state before the last step is captured as well, a frame blends over one step even when several steps are run to catch up;
+	while paused, the thread only wakes up for the posted commands, which are run at most once per interval, so a burst of input is applied at once;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void SimulationThread::run() {
+	const qint64 stepTime = interval * qint64(1000000);
+	qint64 simulated = clock.nsecsElapsed();
+	stateTime.storeRelease(simulated);
+
+	QVector<std::function<void()> > pending;
+	while (true) {
+		commandMutex.lock();
+		bool slept = false;
+		while (paused.loadAcquire() && commands.isEmpty() && !quit.loadAcquire()) {
+			commandCondition.wait(&commandMutex);
+			slept = true;
+		}
+		pending.swap(commands);
+		bool stepping = !paused.loadAcquire();
+		commandMutex.unlock();
+		if (quit.loadAcquire()) break;
+
+		// the time spent paused is not made up for
+		if (slept || !stepping)
+			simulated = clock.nsecsElapsed();
+
+		qint64 now = clock.nsecsElapsed();
+		int steps = stepping ? int(qMin<qint64>((now - simulated) / stepTime, maxCatchUpSteps)) : 0;
+		bool changed = !pending.isEmpty();
+
+		// without a step the frame blends from the state before the commands to the state after them
+		if (steps == 0 && changed)
+			capturePrevious();
+		for (int i = 0; i < pending.size(); i++)
+			pending[i]();
+		pending.clear();
+
+		for (int i = 0; i < steps; i++) {
+			if (i == steps - 1)
+				capturePrevious();
+			step();
+			simulated += stepTime;
+			stepCount.fetchAndAddRelease(1);
+		}
+
+		// a simulation too slow for the clock drops the time it is behind instead of falling further back with every step
+		if (simulated + stepTime <= now)
+			simulated = now;
+
+		if (steps > 0 || changed) {
+			stateTime.storeRelease(simulated);
+			publish();
+		}
+
+		if (stepping) {
+			qint64 remaining = simulated + stepTime - clock.nsecsElapsed();
+			if (remaining > 0)
+				usleep(remaining / 1000);
+		}
+		else if (changed) {
+			msleep(interval);
+		}
+	}
+}
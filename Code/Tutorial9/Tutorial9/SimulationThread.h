@@ -0,0 +1,53 @@
+#pragma once
+#include <qthread.h>
+#include <qmutex.h>
+#include <qwaitcondition.h>
+#include <qatomic.h>
+#include <qvector.h>
+#include <qelapsedtimer.h>
+#include <functional>
+
+// runs the simulation of the scene in steps of a fixed size on its own thread, other threads change the scene by posting commands to it
+class SimulationThread : public QThread {
+public:
+	SimulationThread(const std::function<void()>& step, const std::function<void()>& capturePrevious, const std::function<void()>& publish, int interval);
+	~SimulationThread();
+	void post(const std::function<void()>& command);
+	void stop();
+	void setPaused(bool paused);
+	bool isPaused() const;
+	int getStepCount() const;
+	int getInterval() const;
+	float getSimulationTime() const;
+	qint64 getClockTime() const;
+	qint64 getStateTime() const;
+
+	// the most steps run to catch up with the clock, the time the simulation is behind beyond them is dropped
+	static const int maxCatchUpSteps = 5;
+
+protected:
+	void run();
+
+private:
+	Q_DISABLE_COPY(SimulationThread)
+
+	std::function<void()> step;
+	std::function<void()> capturePrevious;
+	std::function<void()> publish;
+	int interval;
+
+	// the commands are run on the simulation thread before the next step, so the scene is only ever touched by one thread
+	QMutex commandMutex;
+	QVector<std::function<void()> > commands;
+
+	// a paused thread sleeps here until a command is posted, so it costs nothing while the scene is still
+	QWaitCondition commandCondition;
+	QAtomicInt paused;
+
+	// the clock time in nanoseconds the state of the latest step belongs to, the simulated time only advances in whole steps
+	QElapsedTimer clock;
+	QAtomicInteger<qint64> stateTime;
+
+	QAtomicInt stepCount;
+	QAtomicInt quit;
+};
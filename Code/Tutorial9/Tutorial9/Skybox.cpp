@@ -1,64 +1,51 @@
 #include "Skybox.h"
+#include "GLStateCache.h"
 
 /*
 Description:
-	This function is a constructor;
+	This function is a constructor, which splits a horizontal cross layout image into the six faces of a cube map texture;
+	the layout is 4 faces wide and 3 faces high, where the middle row holds -X, -Z, +X, +Z from left to right, and +Y, -Y are above and below -Z;
 Input:
-	@ const float width: width of the skybox, where the default value is 70.0f;
-	@ const QImage &texture: the texture of the skybox;
+	@ const QImage &texture: the texture of the skybox in the horizontal cross layout;
 */
-Skybox::Skybox(float width, const QImage& texture) {
-	QVector<Vertex> vertices;
-	vertices <<
-		Vertex(QVector3D(-width, width, width), QVector2D(4.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, 0.0, -1.0)) <<
-		Vertex(QVector3D(-width, -width, width), QVector2D(4.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 0.0, -1.0)) <<
-		Vertex(QVector3D(width, width, width), QVector2D(3.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, 0.0, -1.0)) <<
-		Vertex(QVector3D(width, -width, width), QVector2D(3.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 0.0, -1.0)) <<
-
-		Vertex(QVector3D(width, width, width), QVector2D(3.0 / 4.0, 2.0 / 3.0), QVector3D(-1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(width, -width, width), QVector2D(3.0 / 4.0, 1.0 / 3.0), QVector3D(-1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(width, width, -width), QVector2D(2.0 / 4.0, 2.0 / 3.0), QVector3D(-1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(width, -width, -width), QVector2D(2.0 / 4.0, 1.0 / 3.0), QVector3D(-1.0, 0.0, 0.0)) <<
-
-		Vertex(QVector3D(width, width, width), QVector2D(2.0 / 4.0, 3.0 / 3.0), QVector3D(0.0, -1.0, 0.0)) <<
-		Vertex(QVector3D(width, width, -width), QVector2D(2.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, -1.0, 0.0)) <<
-		Vertex(QVector3D(-width, width, width), QVector2D(1.0 / 4.0, 3.0 / 3.0), QVector3D(0.0, -1.0, 0.0)) <<
-		Vertex(QVector3D(-width, width, -width), QVector2D(1.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, -1.0, 0.0)) <<
-
-		Vertex(QVector3D(width, width, -width), QVector2D(2.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, 0.0, 1.0)) <<
-		Vertex(QVector3D(width, -width, -width), QVector2D(2.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 0.0, 1.0)) <<
-		Vertex(QVector3D(-width, width, -width), QVector2D(1.0 / 4.0, 2.0 / 3.0), QVector3D(0.0, 0.0, 1.0)) <<
-		Vertex(QVector3D(-width, -width, -width), QVector2D(1.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 0.0, 1.0)) <<
-
-		Vertex(QVector3D(-width, width, width), QVector2D(0.0 / 4.0, 2.0 / 3.0), QVector3D(1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(-width, width, -width), QVector2D(1.0 / 4.0, 2.0 / 3.0), QVector3D(1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(-width, -width, width), QVector2D(0.0 / 4.0, 1.0 / 3.0), QVector3D(1.0, 0.0, 0.0)) <<
-		Vertex(QVector3D(-width, -width, -width), QVector2D(1.0 / 4.0, 1.0 / 3.0), QVector3D(1.0, 0.0, 0.0)) <<
-
-		Vertex(QVector3D(-width, -width, width), QVector2D(1.0 / 4.0, 0.0 / 3.0), QVector3D(0.0, 1.0, 0.0)) <<
-		Vertex(QVector3D(-width, -width, -width), QVector2D(1.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 1.0, 0.0)) <<
-		Vertex(QVector3D(width, -width, width), QVector2D(2.0 / 4.0, 0.0 / 3.0), QVector3D(0.0, 1.0, 0.0)) <<
-		Vertex(QVector3D(width, -width, -width), QVector2D(2.0 / 4.0, 1.0 / 3.0), QVector3D(0.0, 1.0, 0.0));
-
-	QVector<GLuint> indices;
-	indices << 0 << 1 << 2 << 2 << 1 << 3;
-	for (int i = 0; i < 24; i += 4)
-		indices <<
-		i + 0 <<
-		i + 2 <<
-		i + 1 <<
-		i + 2 <<
-		i + 3 <<
-		i + 1;
-
-	Material* material = new Material;
-	material->setDiffuseMap(texture);
-	material->setShinnes(96);
-	material->setDiffuseColor(QVector3D(1.0, 1.0, 1.0));
-	material->setAmbienceColor(QVector3D(1.0, 1.0, 1.0));
-	material->setSpecularColor(QVector3D(1.0, 1.0, 1.0));
-
-	box = new SimpleObject3D(vertices, indices, material);
+Skybox::Skybox(const QImage& texture) {
+	// a single triangle covering the whole screen, which is clipped to the viewport
+	QVector<QVector2D> vertices;
+	vertices << QVector2D(-1.0, -1.0) << QVector2D(3.0, -1.0) << QVector2D(-1.0, 3.0);
+
+	vertexBuffer.create();
+	GLStateCache::getDefault()->bindBuffer(vertexBuffer);
+	vertexBuffer.allocate(vertices.constData(), vertices.size() * sizeof(QVector2D));
+
+	QImage image = texture.convertToFormat(QImage::Format_RGBA8888);
+	int size = image.width() / 4;
+
+	// face images are stored as seen from outside the cube, so the side faces are mirrored horizontally and the top and bottom faces vertically
+	QOpenGLTexture::CubeMapFace faces[6] = {
+		QOpenGLTexture::CubeMapPositiveX, QOpenGLTexture::CubeMapNegativeX,
+		QOpenGLTexture::CubeMapPositiveY, QOpenGLTexture::CubeMapNegativeY,
+		QOpenGLTexture::CubeMapPositiveZ, QOpenGLTexture::CubeMapNegativeZ
+	};
+	QImage faceImages[6] = {
+		image.copy(2 * size, 1 * size, size, size).mirrored(true, false),
+		image.copy(0 * size, 1 * size, size, size).mirrored(true, false),
+		image.copy(1 * size, 0 * size, size, size).mirrored(false, true),
+		image.copy(1 * size, 2 * size, size, size).mirrored(false, true),
+		image.copy(3 * size, 1 * size, size, size).mirrored(true, false),
+		image.copy(1 * size, 1 * size, size, size).mirrored(true, false)
+	};
+
+	this->texture = new QOpenGLTexture(QOpenGLTexture::TargetCubeMap);
+	this->texture->create();
+	this->texture->setSize(size, size);
+	this->texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+	this->texture->allocateStorage();
+	for (int i = 0; i < 6; i++)
+		this->texture->setData(0, 0, faces[i], QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, faceImages[i].constBits());
+
+	this->texture->setMinificationFilter(QOpenGLTexture::Linear);
+	this->texture->setMagnificationFilter(QOpenGLTexture::Linear);
+	this->texture->setWrapMode(QOpenGLTexture::ClampToEdge);
 }
 
 /*
@@ -68,12 +55,15 @@ Input:
 	@ void paramter: void;
 */
 Skybox::~Skybox() {
-	delete box;
+	if (vertexBuffer.isCreated())
+		vertexBuffer.destroy();
+	delete texture;
+	GLStateCache::getDefault()->invalidate();
 }
 
 /*
 Description:
-	This function is used to rotate the skybox, which calls Object3D::rotate(const QQuaternion&) for object rotation;
+	This function is used to rotate the skybox, the skybox always surrounds the camera, so it is ignored;
 Input:
 	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
 Output:
@@ -85,7 +75,7 @@ void Skybox::rotate(const QQuaternion& r) {
 
 /*
 Description:
-	This function is used to translate the skybox, which calls Object3D::translate(const QVector3D&) for object translation;
+	This function is used to translate the skybox, the skybox always surrounds the camera, so it is ignored;
 Input:
 	@ const QVector3D& t: a translation vector;
 Output:
@@ -97,7 +87,7 @@ void Skybox::translate(const QVector3D& t) {
 
 /*
 Description:
-	This function is used to scale the skybox, which calls Object3D::scale(const float&) for object scaling;
+	This function is used to scale the skybox, the skybox always surrounds the camera, so it is ignored;
 Input:
 	@ const float& s: a scalar;
 Output:
@@ -109,7 +99,7 @@ void Skybox::scale(const float& s) {
 
 /*
 Description:
-	This function is used to set the global transform for the skybox, which calls Object3D::setGlobalTransform(const QMatrix4x4&) for setting global transform;
+	This function is used to set the global transform for the skybox, the skybox always surrounds the camera, so it is ignored;
 Input:
 	@ const QMatrix4x4& g: a global transformation;
 Output:
@@ -121,7 +111,20 @@ void Skybox::setGlobalTransform(const QMatrix4x4& g) {
 
 /*
 Description:
-	This function is used to draw the skybox, which calls Object3D::draw(QOpenGLShaderProgram*, QOpenGLFunctions*);
+	This function is used to attach the skybox to the transform of its parent, the skybox always surrounds the camera, so it is ignored;
+Input:
+	@ Transform3D* parent: the transform of the parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void Skybox::setParentTransform(Transform3D* parent) {
+	(void)parent;
+}
+
+/*
+Description:
+	This function is used to draw the skybox as a fullscreen triangle at the maximum depth, the direction of each pixel is used to sample the cube map;
+	it is supposed to be drawn after the opaque geometry with GL_LEQUAL depth test, so that only the pixels where nothing else is visible are shaded;
 Input:
 	@ QOpenGLShaderProgram* shaderProgram: the shader program used for loading shaders and passing parameters;
 	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
@@ -129,5 +132,44 @@ Output:
 	@ void returnValue: void;
 */
 void Skybox::draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
-	box->draw(shaderProgram, functions);
+
+	if (!vertexBuffer.isCreated()) return;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindTexture(0, texture);
+	shaderProgram->setUniformValue("u_skybox", 0);
+
+	cache->bindBuffer(vertexBuffer);
+
+	int verLoc = shaderProgram->attributeLocation("a_position");
+	shaderProgram->enableAttributeArray(verLoc);
+	shaderProgram->setAttributeBuffer(verLoc, GL_FLOAT, 0, 2, sizeof(QVector2D));
+
+	functions->glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/*
+Description:
+	This function is used to draw the depth of the skybox, the skybox is not an occluder, so nothing is drawn in the depth prepass;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the depth-only shader program used for loading shaders and passing parameters;
+	@ QOpenGLFunctions* functions: the OpenGL functions used to drawing elements;
+Output:
+	@ void returnValue: void;
+*/
+void Skybox::drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) {
+	(void)shaderProgram;
+	(void)functions;
+}
+
+/*
+Description:
+	This function is used to record the draws of the skybox, which records nothing, since the skybox is drawn after the scene with its own shader;
+Input:
+	@ CommandBuffer* commands: the command buffer recorded into;
+Output:
+	@ void returnValue: void;
+*/
+void Skybox::record(CommandBuffer* commands) {
+	(void)commands;
 }
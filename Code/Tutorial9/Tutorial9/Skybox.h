@@ -1,18 +1,25 @@
 #pragma once
 #include "Transformational.h"
-#include "SimpleObject3D.h"
+#include <qopenglbuffer.h>
+#include <qopengltexture.h>
+#include <qvector2d.h>
+#include <qimage.h>
 
 class Skybox : public Transformational {
 public:
-	Skybox(float width, const QImage& texture);
+	Skybox(const QImage& texture);
 	~Skybox();
 	void rotate(const QQuaternion& r);
 	void translate(const QVector3D& t);
 	void scale(const float& s);
 	void setGlobalTransform(const QMatrix4x4& g);
+	void setParentTransform(Transform3D* parent);
 	void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions);
+	void record(CommandBuffer* commands);
 
 private:
-	SimpleObject3D* box;
+	QOpenGLBuffer vertexBuffer;
+	QOpenGLTexture* texture;
 };
 
@@ -0,0 +1,231 @@
+#pragma once
+#include <qglobal.h>
+#include <qvector.h>
+#include <qhash.h>
+
+// a handle into a SlotMap, the generation tells a live entry from a removed one whose slot is reused
+struct SlotHandle {
+	SlotHandle() : index(-1), generation(0) {};
+	SlotHandle(int index, quint32 generation) : index(index), generation(generation) {};
+	bool isNull() const { return index < 0; };
+	bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; };
+	bool operator!=(const SlotHandle& other) const { return !(*this == other); };
+	int index;
+	quint32 generation;
+};
+
+inline uint qHash(const SlotHandle& handle, uint seed = 0) {
+	return ::qHash(handle.index, seed) ^ handle.generation;
+}
+
+template<typename T>
+class SlotMap {
+public:
+	SlotHandle insert(const T& value);
+	bool remove(const SlotHandle& handle);
+	bool contains(const SlotHandle& handle) const;
+	T* get(const SlotHandle& handle);
+	const T* get(const SlotHandle& handle) const;
+	void clear();
+
+	int size() const;
+	bool isEmpty() const;
+	T& operator[](int index);
+	const T& operator[](int index) const;
+	SlotHandle handleAt(int index) const;
+
+private:
+	struct Slot {
+		int dense;
+		quint32 generation;
+	};
+
+	// values are kept dense, so iterating over the live entries never skips a hole
+	QVector<T> values;
+	QVector<int> denseSlots;
+
+	// one slot per handle index, a removed slot is reused with a new generation
+	QVector<Slot> sparseSlots;
+	QVector<int> freeSlots;
+};
+
+/*
+Description:
+	This function is used to insert a value, the value is appended to the dense array and a free slot is reused if there is one;
+Input:
+	@ const T& value: the value;
+Output:
+	@ SlotHandle returnValue: the handle of the value;
+*/
+template<typename T>
+SlotHandle SlotMap<T>::insert(const T& value) {
+	int slot;
+	if (!freeSlots.isEmpty()) {
+		slot = freeSlots.last();
+		freeSlots.removeLast();
+	}
+	else {
+		slot = sparseSlots.size();
+		Slot empty = { -1, 0 };
+		sparseSlots.append(empty);
+	}
+
+	sparseSlots[slot].dense = values.size();
+	values.append(value);
+	denseSlots.append(slot);
+	return SlotHandle(slot, sparseSlots[slot].generation);
+}
+
+/*
+Description:
+	This function is used to remove a value, the last value is moved into its place, so the order of the dense array is not kept;
+Input:
+	@ const SlotHandle& handle: the handle of the value;
+Output:
+	@ bool returnValue: true if the handle referred to a live value;
+*/
+template<typename T>
+bool SlotMap<T>::remove(const SlotHandle& handle) {
+	if (!contains(handle)) return false;
+
+	int dense = sparseSlots[handle.index].dense;
+	int last = values.size() - 1;
+	if (dense != last) {
+		values[dense] = values[last];
+		denseSlots[dense] = denseSlots[last];
+		sparseSlots[denseSlots[dense]].dense = dense;
+	}
+	values.removeLast();
+	denseSlots.removeLast();
+
+	sparseSlots[handle.index].dense = -1;
+	sparseSlots[handle.index].generation++;
+	freeSlots.append(handle.index);
+	return true;
+}
+
+/*
+Description:
+	This function is used to check whether a handle refers to a live value;
+Input:
+	@ const SlotHandle& handle: the handle;
+Output:
+	@ bool returnValue: true if the value is live;
+*/
+template<typename T>
+bool SlotMap<T>::contains(const SlotHandle& handle) const {
+	return handle.index >= 0 && handle.index < sparseSlots.size() && sparseSlots[handle.index].generation == handle.generation && sparseSlots[handle.index].dense >= 0;
+}
+
+/*
+Description:
+	This function is used to get a value by its handle;
+Input:
+	@ const SlotHandle& handle: the handle;
+Output:
+	@ T* returnValue: the value, 0 if the handle is stale;
+*/
+template<typename T>
+T* SlotMap<T>::get(const SlotHandle& handle) {
+	return contains(handle) ? &values[sparseSlots[handle.index].dense] : 0;
+}
+
+/*
+Description:
+	This function is used to get a value by its handle;
+Input:
+	@ const SlotHandle& handle: the handle;
+Output:
+	@ const T* returnValue: the value, 0 if the handle is stale;
+*/
+template<typename T>
+const T* SlotMap<T>::get(const SlotHandle& handle) const {
+	return contains(handle) ? &values[sparseSlots[handle.index].dense] : 0;
+}
+
+/*
+Description:
+	This function is used to remove all the values, every handle given out before becomes stale;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+template<typename T>
+void SlotMap<T>::clear() {
+	for (int i = 0; i < denseSlots.size(); i++) {
+		Slot& slot = sparseSlots[denseSlots[i]];
+		slot.dense = -1;
+		slot.generation++;
+		freeSlots.append(denseSlots[i]);
+	}
+	values.clear();
+	denseSlots.clear();
+}
+
+/*
+Description:
+	This function is used to get the amount of live values;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of live values;
+*/
+template<typename T>
+int SlotMap<T>::size() const {
+	return values.size();
+}
+
+/*
+Description:
+	This function is used to check whether there is no live value;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if there is no live value;
+*/
+template<typename T>
+bool SlotMap<T>::isEmpty() const {
+	return values.isEmpty();
+}
+
+/*
+Description:
+	This function is used to get a value by its position in the dense array, which is used to iterate over the live values;
+Input:
+	@ int index: the position in the dense array;
+Output:
+	@ T& returnValue: the value;
+*/
+template<typename T>
+T& SlotMap<T>::operator[](int index) {
+	return values[index];
+}
+
+/*
+Description:
+	This function is used to get a value by its position in the dense array, which is used to iterate over the live values;
+Input:
+	@ int index: the position in the dense array;
+Output:
+	@ const T& returnValue: the value;
+*/
+template<typename T>
+const T& SlotMap<T>::operator[](int index) const {
+	return values[index];
+}
+
+/*
+Description:
+	This function is used to get the handle of a value by its position in the dense array;
+Input:
+	@ int index: the position in the dense array;
+Output:
+	@ SlotHandle returnValue: the handle of the value;
+*/
+template<typename T>
+SlotHandle SlotMap<T>::handleAt(int index) const {
+	int slot = denseSlots[index];
+	return SlotHandle(slot, sparseSlots[slot].generation);
+}
+
@@ -0,0 +1,92 @@
+#pragma once
+#include <qatomic.h>
+
+// a lock-free triple buffer between one producer and one consumer, the producer fills a buffer and publishes it,
+// the consumer takes the latest published buffer, neither side ever waits and a frame skipped by the consumer is simply dropped
+template<typename T>
+class SnapshotExchange {
+public:
+	SnapshotExchange();
+	T& getWriteBuffer();
+	void publish();
+	bool acquire();
+	const T& getReadBuffer() const;
+
+private:
+	Q_DISABLE_COPY(SnapshotExchange)
+
+	// set on the shared index while it refers to a buffer the consumer has not taken yet
+	static const int freshBit = 4;
+
+	T buffers[3];
+
+	// the write index is only used by the producer and the read index only by the consumer, the shared index is swapped with them atomically
+	int writeIndex;
+	int readIndex;
+	QAtomicInt sharedIndex;
+};
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+template<typename T>
+SnapshotExchange<T>::SnapshotExchange() :
+	writeIndex(0), readIndex(1), sharedIndex(2) {
+}
+
+/*
+Description:
+	This function is used to get the buffer the producer fills next, it may hold an older snapshot, so every field should be written;
+Input:
+	@ void parameter: void;
+Output:
+	@ T& returnValue: the write buffer;
+*/
+template<typename T>
+T& SnapshotExchange<T>::getWriteBuffer() {
+	return buffers[writeIndex];
+}
+
+/*
+Description:
+	This function is used to publish the write buffer, which replaces any buffer published before and not yet taken by the consumer;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+template<typename T>
+void SnapshotExchange<T>::publish() {
+	writeIndex = sharedIndex.fetchAndStoreOrdered(writeIndex | freshBit) & ~freshBit;
+}
+
+/*
+Description:
+	This function is used to take the latest published buffer as the read buffer;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if a new buffer is taken, false if nothing is published since the last call;
+*/
+template<typename T>
+bool SnapshotExchange<T>::acquire() {
+	if ((sharedIndex.loadAcquire() & freshBit) == 0) return false;
+	readIndex = sharedIndex.fetchAndStoreOrdered(readIndex) & ~freshBit;
+	return true;
+}
+
+/*
+Description:
+	This function is used to get the buffer taken by the last acquire, which is not touched by the producer until the next acquire;
+Input:
+	@ void parameter: void;
+Output:
+	@ const T& returnValue: the read buffer;
+*/
+template<typename T>
+const T& SnapshotExchange<T>::getReadBuffer() const {
+	return buffers[readIndex];
+}
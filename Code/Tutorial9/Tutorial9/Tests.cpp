@@ -0,0 +1,545 @@
+#include "Tests.h"
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "TransformStore.h"
+#include "FrameGraph.h"
+#include "GLStateCache.h"
+#include "IndirectRenderer.h"
+#include "ShaderLibrary.h"
+#include "Material.h"
+#include <qthread.h>
+#include <qmutex.h>
+#include <qsemaphore.h>
+#include <qguiapplication.h>
+#include <qopenglcontext.h>
+#include <qoffscreensurface.h>
+#include <algorithm>
+
+/*
+Description:
+	This function is used to write the result of one test;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+	@ const char* name: the name of the test;
+	@ bool passed: true if the test passed;
+	@ const QString& detail: what failed, empty for a passed test;
+Output:
+	@ bool returnValue: the result passed through;
+*/
+static bool report(QTextStream& output, const char* name, bool passed, const QString& detail = QString()) {
+	output << "  " << name << ": " << (passed ? "passed" : "FAILED");
+	if (!passed && !detail.isEmpty()) output << ", " << detail;
+	output << "\n";
+	return passed;
+}
+
+/*
+Description:
+	This function is used to make an OpenGL 4.3 context current on an offscreen surface for the tests that draw, and to point the state cache at it;
+Input:
+	@ QOpenGLContext& context: the context to create;
+	@ QOffscreenSurface& surface: the surface to create;
+Output:
+	@ bool returnValue: true if the context is current, false without a GUI application or an OpenGL 4.3 driver, then the test is skipped;
+*/
+static bool makeContext(QOpenGLContext& context, QOffscreenSurface& surface) {
+	if (qobject_cast<QGuiApplication*>(QCoreApplication::instance()) == 0) return false;
+
+	surface.setFormat(QSurfaceFormat::defaultFormat());
+	surface.create();
+	if (!surface.isValid() || !context.create() || !context.makeCurrent(&surface)) return false;
+	if (context.versionFunctions<QOpenGLFunctions_4_3_Compatibility>() == 0) return false;
+
+	GLStateCache::getDefault()->init();
+	return true;
+}
+
+/*
+Description:
+	This function is used to build a command without any OpenGL resource, the texture is only compared by address and never bound;
+Input:
+	@ int order: the order of the command, unique within a test;
+	@ const QVector<ResourceCache::Geometry*>& geometries: the geometries to choose from;
+Output:
+	@ DrawCommand returnValue: the command;
+*/
+static DrawCommand makeCommand(int order, const QVector<ResourceCache::Geometry*>& geometries) {
+	DrawCommand command;
+	command.pass = order % 3 == 0 ? DrawCommand::DepthPass : DrawCommand::ColorPass;
+	command.geometry = geometries[(order * 7) % geometries.size()];
+	command.texture = reinterpret_cast<QOpenGLTexture*>((quintptr)(order % 4) * 64);
+	command.order = order;
+	return command;
+}
+
+/*
+Description:
+	This function is used to record a range of commands in parallel on a job system;
+Input:
+	@ CommandBuffer& commands: the command buffer;
+	@ int begin: the order of the first command;
+	@ int end: one past the order of the last command;
+	@ const QVector<ResourceCache::Geometry*>& geometries: the geometries to choose from;
+Output:
+	@ void returnValue: void;
+*/
+static void recordRange(CommandBuffer& commands, int begin, int end, const QVector<ResourceCache::Geometry*>& geometries) {
+	commands.getJobSystem()->parallelFor(begin, end, 16, [&commands, &geometries](int first, int last) {
+		for (int i = first; i < last; i++)
+			commands.record(makeCommand(i, geometries));
+	});
+}
+
+/*
+Description:
+	This function is used to check that the order captured from a store lists every parent in an earlier level than its children;
+Input:
+	@ const TransformNodes& nodes: the captured nodes;
+Output:
+	@ bool returnValue: true if the levels resolve every parent first;
+*/
+static bool isLevelOrder(const TransformNodes& nodes) {
+	if (nodes.levelOffsets.isEmpty() || nodes.levelOffsets.last() != nodes.order.size()) return false;
+
+	QVector<int> levels(nodes.nodes.size(), -1);
+	for (int level = 0; level + 1 < nodes.levelOffsets.size(); level++) {
+		for (int i = nodes.levelOffsets[level]; i < nodes.levelOffsets[level + 1]; i++)
+			levels[nodes.order[i]] = level;
+	}
+	for (int i = 0; i < nodes.order.size(); i++) {
+		int handle = nodes.order[i];
+		int parent = nodes.nodes[handle].parent[0];
+		if (parent >= 0 && (levels[parent] < 0 || levels[parent] >= levels[handle])) return false;
+	}
+	return true;
+}
+
+/*
+Description:
+	This function is used to run all the tests, which is selected by the --test command line argument;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ int returnValue: the amount of tests failed;
+*/
+int Tests::run(QTextStream& output) {
+	output << "tests\n";
+	int failed = 0;
+	if (!testThreadIndices(output)) failed++;
+	if (!testConcurrentRecording(output)) failed++;
+	if (!testMergeOrder(output)) failed++;
+	if (!testTransformNodes(output)) failed++;
+	if (!testTransformAppend(output)) failed++;
+	if (!testGraphCulling(output)) failed++;
+	if (!testGraphOrder(output)) failed++;
+	if (!testGraphCycle(output)) failed++;
+	if (!testGraphAliasing(output)) failed++;
+	if (!testIndirectCulling(output)) failed++;
+	output << failed << " failed\n";
+	output.flush();
+	return failed;
+}
+
+/*
+Description:
+	This function is used to check that the threads that are not workers of a job system get thread indices of their own, which no worker or other running thread uses;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testThreadIndices(QTextStream& output) {
+	JobSystem system(3);
+	const int threadCount = 4;
+
+	// a finished thread hands its index back, so the threads keep running until all of them have one
+	QMutex mutex;
+	QSemaphore registered, released;
+	QVector<int> indices;
+	QVector<QThread*> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.append(QThread::create([&system, &mutex, &indices, &registered, &released]() {
+			int index = system.getThreadIndex();
+			// the index does not change when the thread asks again
+			if (system.getThreadIndex() != index) index = -1;
+			mutex.lock();
+			indices.append(index);
+			mutex.unlock();
+			registered.release();
+			released.acquire();
+		}));
+		threads.last()->start();
+	}
+	registered.acquire(threadCount);
+	released.release(threadCount);
+	for (int t = 0; t < threadCount; t++) {
+		threads[t]->wait();
+		delete threads[t];
+	}
+	indices.append(system.getThreadIndex());
+
+	std::sort(indices.begin(), indices.end());
+	bool passed = indices.size() == threadCount + 1 && indices.first() >= system.getWorkerCount() && indices.last() < system.getThreadCount();
+	for (int i = 1; i < indices.size() && passed; i++)
+		passed = indices[i] != indices[i - 1];
+	return report(output, "thread indices", passed, QString("%1 threads, indices from %2 to %3").arg(indices.size()).arg(indices.first()).arg(indices.last()));
+}
+
+/*
+Description:
+	This function is used to check that two threads recording into one command buffer at once, such as the render thread and the simulation thread helping with its jobs, lose or repeat no command;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testConcurrentRecording(QTextStream& output) {
+	const int commandCount = 20000;
+	QVector<ResourceCache::Geometry> storage(8);
+	QVector<ResourceCache::Geometry*> geometries;
+	for (int i = 0; i < storage.size(); i++) {
+		storage[i].allocation.block = i % 2;
+		geometries.append(&storage[i]);
+	}
+
+	JobSystem system(3);
+	CommandBuffer commands(&system);
+	bool passed = true;
+	for (int round = 0; round < 20 && passed; round++) {
+		commands.reset(true);
+
+		// the other thread records the upper half while this thread records the lower half
+		QThread* thread = QThread::create([&commands, &geometries]() { recordRange(commands, commandCount / 2, commandCount, geometries); });
+		thread->start();
+		recordRange(commands, 0, commandCount / 2, geometries);
+		thread->wait();
+		delete thread;
+
+		commands.merge();
+		QVector<int> seen(commandCount, 0);
+		const QVector<DrawCommand>& merged = commands.getCommands();
+		passed = merged.size() == commandCount;
+		for (int i = 0; i < merged.size() && passed; i++)
+			passed = ++seen[merged[i].order] == 1;
+	}
+	return report(output, "concurrent recording", passed, QString("%1 commands merged, %2 expected").arg(commands.getCommands().size()).arg(commandCount));
+}
+
+/*
+Description:
+	This function is used to check that the merged list is sorted by the state to bind, and does not depend on how many threads recorded it;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testMergeOrder(QTextStream& output) {
+	const int commandCount = 5000;
+	QVector<ResourceCache::Geometry> storage(8);
+	QVector<ResourceCache::Geometry*> geometries;
+	for (int i = 0; i < storage.size(); i++) {
+		storage[i].allocation.block = i % 3;
+		geometries.append(&storage[i]);
+	}
+
+	JobSystem serialSystem(0);
+	CommandBuffer serialCommands(&serialSystem);
+	serialCommands.reset(true);
+	recordRange(serialCommands, 0, commandCount, geometries);
+	serialCommands.merge();
+
+	JobSystem parallelSystem(3);
+	CommandBuffer parallelCommands(&parallelSystem);
+	parallelCommands.reset(true);
+	recordRange(parallelCommands, 0, commandCount, geometries);
+	parallelCommands.merge();
+
+	const QVector<DrawCommand>& serial = serialCommands.getCommands();
+	const QVector<DrawCommand>& parallel = parallelCommands.getCommands();
+	bool passed = serial.size() == commandCount && parallel.size() == commandCount;
+	for (int i = 1; i < serial.size() && passed; i++)
+		passed = !CommandBuffer::lessThan(serial[i], serial[i - 1]);
+	for (int i = 0; i < serial.size() && passed; i++)
+		passed = serial[i].order == parallel[i].order;
+	return report(output, "merge order", passed);
+}
+
+/*
+Description:
+	This function is used to check that the nodes captured for the GPU refer to their parents by handle, and list every parent before its children, after the store is sorted again;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testTransformNodes(QTextStream& output) {
+	TransformStore store;
+	QVector<int> handles;
+	for (int i = 0; i < 6; i++)
+		handles.append(store.create());
+
+	// a chain created in reverse, so the sort moves every slot, and a released transform in the middle
+	for (int i = 4; i > 0; i--)
+		store.setParent(handles[i], handles[i - 1]);
+	store.translate(handles[5], QVector3D(1.0f, 2.0f, 3.0f));
+	store.release(handles[2]);
+
+	TransformNodes nodes;
+	store.captureNodes(nodes);
+
+	QVector<int> position(nodes.nodes.size(), -1);
+	for (int i = 0; i < nodes.order.size(); i++)
+		position[nodes.order[i]] = i;
+
+	bool passed = nodes.nodes.size() == handles.size() && nodes.order.size() == handles.size() - 1 && position[handles[2]] < 0;
+	for (int i = 0; i < nodes.order.size() && passed; i++) {
+		int parent = nodes.nodes[nodes.order[i]].parent[0];
+		passed = parent < 0 || (parent == store.getParent(nodes.order[i]) && position[parent] >= 0 && position[parent] < i);
+	}
+	passed = passed && nodes.nodes[handles[5]].translationScale[2] == 3.0f && nodes.nodes[handles[3]].parent[0] < 0;
+	return report(output, "transform nodes", passed);
+}
+
+/*
+Description:
+	This function is used to check that roots and leaves appended to a sorted store keep a valid level order without a sort, and that an attachment breaking the order is sorted again;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testTransformAppend(QTextStream& output) {
+	TransformStore store;
+	int root = store.create();
+	int child = store.create();
+	store.setParent(child, root);
+
+	TransformNodes nodes;
+	store.captureNodes(nodes);
+	bool passed = isLevelOrder(nodes) && nodes.levelOffsets.size() == 3;
+
+	// a root joins the last level, a leaf of the last level opens a new one, a leaf of an earlier level joins the last one
+	int second = store.create();
+	int grandchild = store.create();
+	store.setParent(grandchild, child);
+	int leaf = store.create();
+	store.setParent(leaf, root);
+	store.captureNodes(nodes);
+	passed = passed && isLevelOrder(nodes) && nodes.order.size() == 5 && nodes.levelOffsets.size() == 4;
+
+	// the root of the chain moves below a leaf, which the levels cannot hold without a sort
+	store.setParent(root, second);
+	store.captureNodes(nodes);
+	passed = passed && isLevelOrder(nodes) && nodes.levelOffsets.size() == 5 && store.getParent(root) == second;
+	return report(output, "transform append", passed);
+}
+
+/*
+Description:
+	This function is used to check that a frame graph culls a pass nothing uses, and keeps the pass producing what a kept pass reads, the graph only has buffers, so no OpenGL call is made;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testGraphCulling(QTextStream& output) {
+	FrameGraph graph;
+	QVector<int> executed;
+	int unused = graph.createBuffer("Unused");
+	int produced = graph.createBuffer("Produced");
+
+	int unusedPass = graph.addPass("Unused", [&executed]() { executed.append(0); });
+	graph.write(unusedPass, unused);
+	int producerPass = graph.addPass("Producer", [&executed]() { executed.append(1); });
+	graph.write(producerPass, produced);
+	int consumerPass = graph.addPass("Consumer", [&executed]() { executed.append(2); });
+	graph.read(consumerPass, produced);
+	graph.setSideEffect(consumerPass);
+
+	bool passed = graph.compile();
+	if (passed) graph.execute();
+	passed = passed && graph.getPassCount() == 2 && graph.getCulledPassCount() == 1 && executed == QVector<int>({ 1, 2 });
+	return report(output, "graph culling", passed, QString("%1 passes kept, %2 culled").arg(graph.getPassCount()).arg(graph.getCulledPassCount()));
+}
+
+/*
+Description:
+	This function is used to check that a frame graph runs the producer of a resource before a reader declared ahead of it, and a pass overwriting the resource after that reader;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testGraphOrder(QTextStream& output) {
+	FrameGraph graph;
+	QVector<int> executed;
+	int resource = graph.createBuffer("Resource");
+
+	int readerPass = graph.addPass("Reader", [&executed]() { executed.append(0); });
+	graph.read(readerPass, resource);
+	graph.setSideEffect(readerPass);
+	int producerPass = graph.addPass("Producer", [&executed]() { executed.append(1); });
+	graph.write(producerPass, resource);
+	int overwritePass = graph.addPass("Overwrite", [&executed]() { executed.append(2); });
+	graph.write(overwritePass, resource);
+	graph.setSideEffect(overwritePass);
+
+	bool passed = graph.compile();
+	if (passed) graph.execute();
+	passed = passed && executed == QVector<int>({ 1, 0, 2 });
+	return report(output, "graph order", passed);
+}
+
+/*
+Description:
+	This function is used to check that a frame graph whose passes read what each other write, so neither can run first, fails to compile and keeps no pass;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed;
+*/
+bool Tests::testGraphCycle(QTextStream& output) {
+	FrameGraph graph;
+	int first = graph.createBuffer("First");
+	int second = graph.createBuffer("Second");
+
+	int firstPass = graph.addPass("First", []() {});
+	graph.read(firstPass, second);
+	graph.write(firstPass, first);
+	graph.setSideEffect(firstPass);
+	int secondPass = graph.addPass("Second", []() {});
+	graph.read(secondPass, first);
+	graph.write(secondPass, second);
+	graph.setSideEffect(secondPass);
+
+	bool passed = !graph.compile() && graph.getPassCount() == 0;
+	return report(output, "graph cycle", passed);
+}
+
+/*
+Description:
+	This function is used to check that two transient textures of one description, whose passes run one after the other, are placed in one texture, which needs an OpenGL context;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed or was skipped;
+*/
+bool Tests::testGraphAliasing(QTextStream& output) {
+	QOpenGLContext context;
+	QOffscreenSurface surface;
+	if (!makeContext(context, surface)) {
+		output << "  graph aliasing: skipped, no OpenGL 4.3 context\n";
+		return true;
+	}
+
+	bool passed;
+	{
+		FrameGraph graph;
+		FrameGraph::TextureDesc desc(64, 64, GL_RGBA8);
+		int result = graph.createBuffer("Result");
+		int first = graph.createTexture("First", desc);
+		int second = graph.createTexture("Second", desc);
+
+		int pass = graph.addPass("WriteFirst", []() {});
+		graph.write(pass, first);
+		pass = graph.addPass("ReadFirst", []() {});
+		graph.read(pass, first);
+		graph.write(pass, result);
+		pass = graph.addPass("WriteSecond", []() {});
+		graph.write(pass, second);
+		pass = graph.addPass("ReadSecond", []() {});
+		graph.read(pass, second);
+		graph.read(pass, result);
+		graph.setSideEffect(pass);
+
+		passed = graph.compile() && graph.getPassCount() == 4 && graph.getTextureCount() == 1 && graph.getTexture(first) == graph.getTexture(second) &&
+			graph.getRequestedBytes() == 2 * graph.getTextureBytes();
+	}
+	context.doneCurrent();
+	return report(output, "graph aliasing", passed);
+}
+
+/*
+Description:
+	This function is used to check the objects the culling shader leaves visible for a known frustum, and that geometry blocks and texture arrays too large for the packed bucket key still get buckets of their own, which needs an OpenGL context;
+Input:
+	@ QTextStream& output: the stream the results are written to;
+Output:
+	@ bool returnValue: true if the test passed or was skipped;
+*/
+bool Tests::testIndirectCulling(QTextStream& output) {
+	QOpenGLContext context;
+	QOffscreenSurface surface;
+	if (!makeContext(context, surface)) {
+		output << "  indirect culling: skipped, no OpenGL 4.3 context\n";
+		return true;
+	}
+
+	ShaderLibrary shaders;
+	shaders.init();
+	shaders.addProgram("Cull");
+	shaders.addProgram("DepthPyramid");
+	if (!shaders.build()) {
+		context.doneCurrent();
+		return report(output, "indirect culling", false, shaders.log());
+	}
+
+	// the blocks 0 and 0x10000, and the texture arrays -1 and 255, share the bits of the packed key
+	QVector<ResourceCache::Geometry> geometries(2);
+	geometries[0].allocation.block = 0;
+	geometries[1].allocation.block = 0x10000;
+	for (int i = 0; i < geometries.size(); i++) {
+		geometries[i].allocation.indexCount = 36;
+		geometries[i].radius = 1.0f;
+	}
+
+	// the camera looks down -z from the origin, the box spans [-10, 10] on x and y and [0.1, 100] on z
+	static const struct {
+		QVector3D position;
+		bool visible;
+	} spheres[] = {
+		{ QVector3D(0.0f, 0.0f, -5.0f), true },
+		{ QVector3D(5.0f, -5.0f, -50.0f), true },
+		{ QVector3D(10.5f, 0.0f, -5.0f), true },
+		{ QVector3D(30.0f, 0.0f, -5.0f), false },
+		{ QVector3D(0.0f, 0.0f, 10.0f), false },
+		{ QVector3D(0.0f, 0.0f, -200.0f), false }
+	};
+	const int sphereCount = sizeof(spheres) / sizeof(spheres[0]);
+
+	Material material;
+	JobSystem serialSystem(0);
+	CommandBuffer commands(&serialSystem);
+	commands.reset(false);
+	int expected = 0;
+	for (int i = 0; i < sphereCount; i++) {
+		DrawCommand command;
+		command.geometry = &geometries[i % 2];
+		command.textureArray = i % 3 == 2 ? 255 : -1;
+		command.material = &material;
+		command.modelMatrix.translate(spheres[i].position);
+		command.order = i;
+		commands.record(command);
+		if (spheres[i].visible) expected++;
+	}
+	commands.merge();
+
+	QMatrix4x4 viewProjectionMatrix;
+	viewProjectionMatrix.ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
+
+	int bucketCount, visibleCount;
+	{
+		TransformBuffer transformBuffer;
+		IndirectRenderer indirect;
+		indirect.init(shaders.getProgram("Cull"), shaders.getProgram("DepthPyramid"));
+		indirect.update(&commands);
+		indirect.cull(viewProjectionMatrix, &transformBuffer);
+		bucketCount = indirect.getBucketCount();
+		visibleCount = indirect.getVisibleCount();
+	}
+	context.doneCurrent();
+
+	// the commands 0 and 4, and 1 and 3, share a block and a texture array, the commands 2 and 5 get a bucket each
+	bool passed = bucketCount == 4 && visibleCount == expected;
+	return report(output, "indirect culling", passed, QString("%1 buckets, %2 of %3 visible").arg(bucketCount).arg(visibleCount).arg(expected));
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <qtextstream.h>
+
+// the checks that need no window, such as the draw lists recorded by the threads of a job system, run by the --test command line argument,
+// the checks that need an OpenGL context draw to an offscreen surface and are skipped when no context can be created
+class Tests {
+public:
+	static int run(QTextStream& output);
+
+private:
+	static bool testThreadIndices(QTextStream& output);
+	static bool testConcurrentRecording(QTextStream& output);
+	static bool testMergeOrder(QTextStream& output);
+	static bool testTransformNodes(QTextStream& output);
+	static bool testTransformAppend(QTextStream& output);
+	static bool testGraphCulling(QTextStream& output);
+	static bool testGraphOrder(QTextStream& output);
+	static bool testGraphCycle(QTextStream& output);
+	static bool testGraphAliasing(QTextStream& output);
+	static bool testIndirectCulling(QTextStream& output);
+};
@@ -0,0 +1,226 @@
+#include "TextureArrayPool.h"
+#include "GLStateCache.h"
+
+/*
+Description:
+	This function is a constructor, no texture is created before the first insert;
+Input:
+	@ int initialLayers: the amount of layers of a new array;
+*/
+TextureArrayPool::TextureArrayPool(int initialLayers) :
+	functions(0), initialLayers(qMax(initialLayers, 1)), resizeCount(0) {
+}
+
+/*
+Description:
+	This function is a destructor, the textures are expected to be destroyed with their last layer;
+Input:
+	@ void patameter: void;
+*/
+TextureArrayPool::~TextureArrayPool() {
+}
+
+/*
+Description:
+	This function is used to place an image into the array of its size, a free layer is reused first, a full array doubles its layers, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ const QImage& image: the image, flipped for OpenGL already;
+Output:
+	@ Layer returnValue: the array and the layer of the image, the array is -1 for an image that could not be placed;
+*/
+TextureArrayPool::Layer TextureArrayPool::insert(const QImage& image) {
+	Layer result;
+	if (image.isNull()) return result;
+
+	if (functions == 0) {
+		functions = GLStateCache::getDefault()->getFunctions();
+		if (functions == 0) return result;
+	}
+
+	// every image is converted to one format, so the images of one size are always compatible
+	QImage pixels = image.convertToFormat(QImage::Format_RGBA8888);
+
+	int index = -1;
+	for (int i = 0; i < arrays.size() && index < 0; i++) {
+		if (arrays[i].texture != 0 && arrays[i].size == pixels.size()) index = i;
+	}
+	if (index < 0) index = addArray(pixels.size());
+
+	Array& array = arrays[index];
+	int layer;
+	if (!array.freeLayers.isEmpty()) {
+		layer = array.freeLayers.last();
+		array.freeLayers.removeLast();
+	}
+	else {
+		if (array.used == array.capacity) resize(array, 2 * array.capacity);
+		layer = array.used++;
+	}
+	array.layerCount++;
+
+	GLStateCache::getDefault()->bindTexture(0, GL_TEXTURE_2D_ARRAY, array.texture);
+	functions->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	functions->glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, pixels.width(), pixels.height(), 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels.constBits());
+
+	result.array = index;
+	result.layer = layer;
+	return result;
+}
+
+/*
+Description:
+	This function is used to give a layer back for the next image of its size, an array left without layers is destroyed, an OpenGL context is supposed to be current;
+Input:
+	@ const Layer& layer: the layer;
+Output:
+	@ void returnValue: void;
+*/
+void TextureArrayPool::remove(const Layer& layer) {
+	if (layer.array < 0 || layer.array >= arrays.size() || arrays[layer.array].texture == 0) return;
+
+	Array& array = arrays[layer.array];
+	array.freeLayers.append(layer.layer);
+	if (--array.layerCount > 0) return;
+
+	// the name of the texture may be reused, so the cache must not think it is still bound
+	functions->glDeleteTextures(1, &array.texture);
+	GLStateCache::getDefault()->invalidate();
+	array = Array();
+}
+
+/*
+Description:
+	This function is used to bind an array to a texture unit through the state cache;
+Input:
+	@ int array: the array index of a layer;
+	@ int unit: the texture unit;
+Output:
+	@ void returnValue: void;
+*/
+void TextureArrayPool::bind(int array, int unit) {
+	if (functions == 0) return;
+
+	GLStateCache::getDefault()->bindTexture(unit, GL_TEXTURE_2D_ARRAY, getTexture(array));
+}
+
+/*
+Description:
+	This function is used to get the texture of an array, which changes when the array is resized;
+Input:
+	@ int array: the array index of a layer;
+Output:
+	@ GLuint returnValue: the texture, 0 for an index without an array;
+*/
+GLuint TextureArrayPool::getTexture(int array) const {
+	if (array < 0 || array >= arrays.size()) return 0;
+	return arrays[array].texture;
+}
+
+/*
+Description:
+	This function is used to get the size of the images of an array;
+Input:
+	@ int array: the array index of a layer;
+Output:
+	@ QSize returnValue: the size in pixels;
+*/
+QSize TextureArrayPool::getSize(int array) const {
+	if (array < 0 || array >= arrays.size()) return QSize();
+	return arrays[array].size;
+}
+
+/*
+Description:
+	This function is used to get the amount of arrays, which is the amount of texture binds a frame needs at most;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of arrays;
+*/
+int TextureArrayPool::getArrayCount() const {
+	int count = 0;
+	for (int i = 0; i < arrays.size(); i++) {
+		if (arrays[i].texture != 0) count++;
+	}
+	return count;
+}
+
+/*
+Description:
+	This function is used to get the amount of layers in use over all the arrays;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of layers;
+*/
+int TextureArrayPool::getLayerCount() const {
+	int count = 0;
+	for (int i = 0; i < arrays.size(); i++)
+		count += arrays[i].layerCount;
+	return count;
+}
+
+/*
+Description:
+	This function is used to get the amount of times an array was grown so far;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of resizes;
+*/
+int TextureArrayPool::getResizeCount() const {
+	return resizeCount;
+}
+
+/*
+Description:
+	This function is used to create the array of an image size, an empty slot left by a destroyed array is reused;
+Input:
+	@ const QSize& size: the size of the images;
+Output:
+	@ int returnValue: the array index;
+*/
+int TextureArrayPool::addArray(const QSize& size) {
+	int index = 0;
+	while (index < arrays.size() && arrays[index].texture != 0)
+		index++;
+	if (index == arrays.size()) arrays.append(Array());
+
+	Array& array = arrays[index];
+	array.size = size;
+	resize(array, initialLayers);
+	return index;
+}
+
+/*
+Description:
+	This function is used to move an array into a texture with more layers, the layers handed out are copied on the GPU, so the layer indices stay valid;
+Input:
+	@ Array& array: the array;
+	@ int capacity: the new amount of layers;
+Output:
+	@ void returnValue: void;
+*/
+void TextureArrayPool::resize(Array& array, int capacity) {
+	GLuint texture = 0;
+	functions->glGenTextures(1, &texture);
+	GLStateCache::getDefault()->bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+	functions->glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, array.size.width(), array.size.height(), capacity);
+
+	// the same sampling as the textures of ResourceCache
+	functions->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	functions->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	functions->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	functions->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	if (array.texture != 0) {
+		if (array.used > 0)
+			functions->glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, array.size.width(), array.size.height(), array.used);
+		functions->glDeleteTextures(1, &array.texture);
+		GLStateCache::getDefault()->invalidate();
+		resizeCount++;
+	}
+
+	array.texture = texture;
+	array.capacity = capacity;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <qvector.h>
+#include <qsize.h>
+#include <qimage.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+
+// packs images of equal size into the layers of GL_TEXTURE_2D_ARRAY textures, so that draws with different images of one size need no texture change,
+// the images are converted to RGBA8, a full array doubles its layers on insert, and a removed layer is reused by the next image of its size
+class TextureArrayPool {
+public:
+	// the place of an image, the layer is passed to the shader per material or per object
+	struct Layer {
+		Layer() : array(-1), layer(0) {};
+		int array;
+		int layer;
+	};
+
+	TextureArrayPool(int initialLayers = 4);
+	~TextureArrayPool();
+	Layer insert(const QImage& image);
+	void remove(const Layer& layer);
+	void bind(int array, int unit);
+	GLuint getTexture(int array) const;
+	QSize getSize(int array) const;
+	int getArrayCount() const;
+	int getLayerCount() const;
+	int getResizeCount() const;
+
+private:
+	Q_DISABLE_COPY(TextureArrayPool)
+
+	struct Array {
+		Array() : texture(0), capacity(0), used(0), layerCount(0) {};
+		GLuint texture;
+		QSize size;
+		int capacity;
+		// the layers below used were handed out once, the free ones among them are reused first
+		int used;
+		int layerCount;
+		QVector<int> freeLayers;
+	};
+
+	int addArray(const QSize& size);
+	void resize(Array& array, int capacity);
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+
+	// a destroyed array leaves an empty slot, so the array index of the other layers stays valid
+	QVector<Array> arrays;
+	int initialLayers;
+	int resizeCount;
+};
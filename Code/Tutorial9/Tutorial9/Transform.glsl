@@ -0,0 +1,24 @@
+// the model matrix of an object, either set by the CPU or fetched from the world matrices resolved on the GPU by TransformBuffer
+uniform highp mat4 u_modelMatrix;
+uniform highp samplerBuffer u_worldMatrices;
+uniform int u_transformIndex;
+
+// the placements of a prefab drawn with instanced draws, the matrix of each instance is applied on top of the model matrix, see Prefab3D
+uniform highp samplerBuffer u_instanceMatrices;
+uniform int u_instanceCount;
+
+mat4 fetchMatrix(samplerBuffer matrices, int index) {
+	int texel = 4 * index;
+	return mat4(
+		texelFetch(matrices, texel),
+		texelFetch(matrices, texel + 1),
+		texelFetch(matrices, texel + 2),
+		texelFetch(matrices, texel + 3));
+}
+
+mat4 modelMatrix() {
+	mat4 model = u_transformIndex < 0 ? u_modelMatrix : fetchMatrix(u_worldMatrices, u_transformIndex);
+	if (u_instanceCount > 0)
+		model = fetchMatrix(u_instanceMatrices, gl_InstanceID) * model;
+	return model;
+}
@@ -0,0 +1,169 @@
+#include "Transform3D.h"
+
+/*
+Description:
+	This function is a constructor, which creates a root transform in the store;
+Input:
+	@ TransformStore* store: the store holding the transform data;
+*/
+Transform3D::Transform3D(TransformStore* store) :
+	store(store) {
+	handle = store->create();
+}
+
+/*
+Description:
+	This function is a destructor, the children become root transforms and the transform is released from the store;
+Input:
+	@ void patameter: void;
+*/
+Transform3D::~Transform3D() {
+	store->release(handle);
+}
+
+/*
+Description:
+	This function is used to rotate the transform;
+Input:
+	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
+Output:
+	@ void returnValue: void;
+*/
+void Transform3D::rotate(const QQuaternion& r) {
+	store->rotate(handle, r);
+}
+
+/*
+Description:
+	This function is used to translate the transform;
+Input:
+	@ const QVector3D& t: a translation vector;
+Output:
+	@ void returnValue: void;
+*/
+void Transform3D::translate(const QVector3D& t) {
+	store->translate(handle, t);
+}
+
+/*
+Description:
+	This function is used to scale the transform;
+Input:
+	@ const float& s: a scalar;
+Output:
+	@ void returnValue: void;
+*/
+void Transform3D::scale(const float& s) {
+	store->scale(handle, s);
+}
+
+/*
+Description:
+	This function is used to set the global transform, which is used as the parent matrix while the transform has no parent;
+Input:
+	@ const QMatrix4x4& g: a global transformation;
+Output:
+	@ void returnValue: void;
+*/
+void Transform3D::setGlobalTransform(const QMatrix4x4& g) {
+	store->setGlobalTransform(handle, g);
+}
+
+/*
+Description:
+	This function is used to attach the transform to a parent in the same store, detaching a transform keeps the current world matrix of its parent as the global transform;
+Input:
+	@ Transform3D* parent: the new parent, 0 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void Transform3D::setParent(Transform3D* parent) {
+	store->setParent(handle, parent != 0 ? parent->handle : -1);
+}
+
+/*
+Description:
+	This function is used to get the matrix the local matrix is applied to, which is the world matrix of the parent or the global transform of a root transform;
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the parent matrix;
+*/
+QMatrix4x4 Transform3D::getParentMatrix() {
+	return store->getParentMatrix(handle);
+}
+
+/*
+Description:
+	This function is used to get the local matrix (translation * rotation * scale);
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the local matrix;
+*/
+QMatrix4x4 Transform3D::getLocalMatrix() {
+	return store->getLocalMatrix(handle);
+}
+
+/*
+Description:
+	This function is used to get the world matrix, the store brings all its world matrices up to date in one sweep when something is changed;
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 Transform3D::getWorldMatrix() {
+	return store->getWorldMatrix(handle);
+}
+
+/*
+Description:
+	This function is used to get the world matrix the transform is drawn with, which comes from the snapshot of the frame when the store has one;
+Input:
+	@ void parameter: void;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 Transform3D::getRenderMatrix() {
+	return store->getRenderMatrix(handle);
+}
+
+/*
+Description:
+	This function is used to get the handle of the transform in its store;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the handle;
+*/
+int Transform3D::getHandle() const {
+	return handle;
+}
+
+/*
+Description:
+	This function is used to check whether the transform is drawn with the world matrix resolved on the GPU, which is then fetched by the handle of the transform;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the world matrix is resolved on the GPU;
+*/
+bool Transform3D::isRenderedOnDevice() const {
+	return store->isRenderedOnDevice();
+}
+
+/*
+Description:
+	This function is used to invert an affine matrix, the upper 3x3 block is inverted by its cofactors and the translation is rotated back, which is cheaper than a general 4x4 inverse, see SimdMath::inverseAffine;
+Input:
+	@ const QMatrix4x4& m: an affine matrix, whose last row is (0, 0, 0, 1);
+Output:
+	@ QMatrix4x4 returnValue: the inverse matrix;
+*/
+QMatrix4x4 Transform3D::affineInverse(const QMatrix4x4& m) {
+	Matrix4 matrix = SimdMath::fromQMatrix(m);
+	Matrix4 inverse;
+	SimdMath::inverseAffine(&matrix, &inverse, 1);
+	return SimdMath::toQMatrix(inverse);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <qglobal.h>
+#include <qquaternion.h>
+#include <qvector3d.h>
+#include <qmatrix4x4.h>
+#include "TransformStore.h"
+
+class Transform3D {
+public:
+	Transform3D(TransformStore* store = TransformStore::getDefault());
+	~Transform3D();
+	void rotate(const QQuaternion& r);
+	void translate(const QVector3D& t);
+	void scale(const float& s);
+	void setGlobalTransform(const QMatrix4x4& g);
+	void setParent(Transform3D* parent);
+	QMatrix4x4 getParentMatrix();
+	QMatrix4x4 getLocalMatrix();
+	QMatrix4x4 getWorldMatrix();
+	QMatrix4x4 getRenderMatrix();
+	int getHandle() const;
+	bool isRenderedOnDevice() const;
+
+	static QMatrix4x4 affineInverse(const QMatrix4x4& m);
+
+private:
+	Q_DISABLE_COPY(Transform3D)
+
+	// the transform data lives in the store, the transform only keeps its handle
+	TransformStore* store;
+	int handle;
+};
+
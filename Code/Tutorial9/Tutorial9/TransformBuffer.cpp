@@ -0,0 +1,231 @@
+#include "TransformBuffer.h"
+#include "GLStateCache.h"
+#include <string.h>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ void parameter: void;
+*/
+TransformBuffer::TransformBuffer() :
+	hierarchyShader(0), capacity(0), resolvedAlpha(-1.0f), uploadedCount(0), uploadedBytes(0), functions(0), worldTexture(0) {
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+TransformBuffer::~TransformBuffer() {
+	if (functions != 0)
+		functions->glDeleteTextures(1, &worldTexture);
+	if (nodeBuffer.isCreated())
+		nodeBuffer.destroy();
+	if (previousNodeBuffer.isCreated())
+		previousNodeBuffer.destroy();
+	if (globalBuffer.isCreated())
+		globalBuffer.destroy();
+	if (orderBuffer.isCreated())
+		orderBuffer.destroy();
+	if (worldBuffer.isCreated())
+		worldBuffer.destroy();
+	GLStateCache::getDefault()->invalidate();
+}
+
+/*
+Description:
+	This function is used to create the node, global, order and world buffers, an OpenGL 4.3 context is supposed to be current;
+Input:
+	@ QOpenGLShaderProgram* hierarchyShader: the compute program built from Hierarchy.csh;
+Output:
+	@ void returnValue: void;
+*/
+void TransformBuffer::init(QOpenGLShaderProgram* hierarchyShader) {
+	this->hierarchyShader = hierarchyShader;
+
+	functions = GLStateCache::getDefault()->getFunctions();
+	if (functions == 0) return;
+
+	nodeBuffer.create();
+	nodeBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	previousNodeBuffer.create();
+	previousNodeBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	globalBuffer.create();
+	globalBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	orderBuffer.create();
+	orderBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	worldBuffer.create();
+	worldBuffer.setUsagePattern(QOpenGLBuffer::DynamicCopy);
+
+	functions->glGenTextures(1, &worldTexture);
+}
+
+/*
+Description:
+	This function is used to upload the nodes of a snapshot that differ from the last update and resolve the world matrices level by level with the compute program, which is called by the thread drawing;
+	the local values are blended between the two steps before the hierarchy is applied, so the world matrices are resolved again for every frame drawn between the steps;
+Input:
+	@ const TransformNodes* previousNodes: the nodes of the step before, 0 to draw the latest step as it is;
+	@ const TransformNodes& nodes: the nodes of the latest step captured by TransformStore::captureNodes(TransformNodes&);
+	@ float alpha: the position of the frame between the two steps, 0 at the step before and 1 at the latest step;
+Output:
+	@ void returnValue: void;
+*/
+void TransformBuffer::update(const TransformNodes* previousNodes, const TransformNodes& nodes, float alpha) {
+	uploadedCount = 0;
+	uploadedBytes = 0;
+	if (functions == 0 || hierarchyShader == 0) return;
+
+	int handleCount = nodes.nodes.size();
+	if (handleCount == 0) return;
+	if (handleCount > capacity) resize(handleCount);
+
+	// a handle created after the step before has no previous node, and is drawn at the latest step
+	int previousCount = previousNodes == 0 ? 0 : qMin(previousNodes->nodes.size(), capacity);
+	upload(nodeBuffer, nodeCopy, nodes.nodes.constData(), handleCount, sizeof(TransformNodes::Node));
+	if (previousCount > 0)
+		upload(previousNodeBuffer, previousNodeCopy, previousNodes->nodes.constData(), previousCount, sizeof(TransformNodes::Node));
+	upload(globalBuffer, globalCopy, nodes.globals.constData(), handleCount, sizeof(Matrix4));
+	upload(orderBuffer, orderCopy, nodes.order.constData(), nodes.order.size(), sizeof(int));
+
+	alpha = previousCount > 0 ? qBound(0.0f, alpha, 1.0f) : 1.0f;
+	if (uploadedCount == 0 && alpha == resolvedAlpha) return;
+	resolvedAlpha = alpha;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, nodeBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, previousNodeBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, globalBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, orderBuffer.bufferId());
+	cache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, worldBuffer.bufferId());
+
+	// every level reads the world matrices written by the previous one
+	cache->useProgram(hierarchyShader);
+	hierarchyShader->setUniformValue("u_alpha", alpha);
+	hierarchyShader->setUniformValue("u_previousCount", previousCount);
+	const QVector<int>& levelOffsets = nodes.levelOffsets;
+	for (int level = 0; level + 1 < levelOffsets.size(); level++) {
+		int count = levelOffsets[level + 1] - levelOffsets[level];
+		if (count == 0) continue;
+		hierarchyShader->setUniformValue("u_levelBegin", levelOffsets[level]);
+		hierarchyShader->setUniformValue("u_levelEnd", levelOffsets[level + 1]);
+		functions->glDispatchCompute((count + 63) / 64, 1, 1);
+		functions->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	functions->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+/*
+Description:
+	This function is used to bind the world matrices for the vertex shader, the sampler is always assigned, so it never shares a unit with a sampler of another type;
+Input:
+	@ QOpenGLShaderProgram* shaderProgram: the shader program including Transform.glsl;
+Output:
+	@ void returnValue: void;
+*/
+void TransformBuffer::bind(QOpenGLShaderProgram* shaderProgram) {
+	if (functions != 0) GLStateCache::getDefault()->bindTexture(textureUnit, GL_TEXTURE_BUFFER, worldTexture);
+	shaderProgram->setUniformValue("u_worldMatrices", textureUnit);
+}
+
+/*
+Description:
+	This function is used to get the amount of nodes, global matrices and order entries uploaded by the last update;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of entries;
+*/
+int TransformBuffer::getUploadedCount() const {
+	return uploadedCount;
+}
+
+/*
+Description:
+	This function is used to get the amount of bytes uploaded by the last update, including the unchanged entries inside the uploaded runs;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the amount of bytes;
+*/
+int TransformBuffer::getUploadedBytes() const {
+	return uploadedBytes;
+}
+
+/*
+Description:
+	This function is used to grow the buffers to hold a number of handles, with some headroom so that a growing store does not reallocate every frame;
+Input:
+	@ int handleCount: the amount of handles;
+Output:
+	@ void returnValue: void;
+*/
+void TransformBuffer::resize(int handleCount) {
+	capacity = qMax(handleCount, capacity + capacity / 2);
+
+	// the reallocated buffers are empty, so everything is uploaded again
+	nodeCopy.clear();
+	previousNodeCopy.clear();
+	globalCopy.clear();
+	orderCopy.clear();
+	resolvedAlpha = -1.0f;
+
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->bindBuffer(nodeBuffer);
+	nodeBuffer.allocate(capacity * sizeof(TransformNodes::Node));
+	cache->bindBuffer(previousNodeBuffer);
+	previousNodeBuffer.allocate(capacity * sizeof(TransformNodes::Node));
+	cache->bindBuffer(globalBuffer);
+	globalBuffer.allocate(capacity * sizeof(Matrix4));
+	cache->bindBuffer(orderBuffer);
+	orderBuffer.allocate(capacity * sizeof(int));
+	cache->bindBuffer(worldBuffer);
+	worldBuffer.allocate(capacity * sizeof(Matrix4));
+
+	cache->bindTexture(textureUnit, GL_TEXTURE_BUFFER, worldTexture);
+	functions->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, worldBuffer.bufferId());
+}
+
+/*
+Description:
+	This function is used to upload the runs of entries that differ from the CPU copy of a buffer, and keep the copy in step with the buffer;
+Input:
+	@ QOpenGLBuffer& buffer: the buffer;
+	@ QByteArray& copy: the CPU copy of the buffer, empty to upload every entry;
+	@ const void* source: the entries of the snapshot;
+	@ int count: the amount of entries;
+	@ int stride: the size of an entry in bytes;
+Output:
+	@ void returnValue: void;
+*/
+void TransformBuffer::upload(QOpenGLBuffer& buffer, QByteArray& copy, const void* source, int count, int stride) {
+	bool all = copy.isEmpty();
+	if (all) copy.resize(capacity * stride);
+	char* target = copy.data();
+	const char* entries = static_cast<const char*>(source);
+
+	// a short gap is cheaper to upload again than to issue another call
+	const int maxGap = 16;
+	int runBegin = -1;
+	int runEnd = -1;
+	GLStateCache::getDefault()->bindBuffer(buffer);
+	for (int i = 0; i <= count; i++) {
+		bool changed = i < count && (all || memcmp(target + i * stride, entries + i * stride, stride) != 0);
+		if (runBegin >= 0 && (i == count || (changed && i - runEnd > maxGap))) {
+			int size = (runEnd - runBegin) * stride;
+			memcpy(target + runBegin * stride, entries + runBegin * stride, size);
+			buffer.write(runBegin * stride, target + runBegin * stride, size);
+			uploadedBytes += size;
+			runBegin = -1;
+		}
+		if (!changed) continue;
+
+		uploadedCount++;
+		if (runBegin < 0)
+			runBegin = i;
+		runEnd = i + 1;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <qvector.h>
+#include <qbytearray.h>
+#include <qopenglbuffer.h>
+#include <qopenglshaderprogram.h>
+#include <qopenglfunctions_4_3_compatibility.h>
+#include "TransformStore.h"
+
+class TransformBuffer {
+public:
+	TransformBuffer();
+	~TransformBuffer();
+	void init(QOpenGLShaderProgram* hierarchyShader);
+	void update(const TransformNodes* previousNodes, const TransformNodes& nodes, float alpha);
+	void bind(QOpenGLShaderProgram* shaderProgram);
+	int getUploadedCount() const;
+	int getUploadedBytes() const;
+
+	static const int textureUnit = 4;
+
+private:
+	void resize(int handleCount);
+	void upload(QOpenGLBuffer& buffer, QByteArray& copy, const void* source, int count, int stride);
+
+	QOpenGLShaderProgram* hierarchyShader;
+
+	// CPU copies of what the buffers hold, only the runs that differ from the snapshot are uploaded, an empty copy is uploaded in full
+	QByteArray nodeCopy;
+	QByteArray previousNodeCopy;
+	QByteArray globalCopy;
+	QByteArray orderCopy;
+	int capacity;
+
+	// the world matrices are resolved again when the nodes or the position of the frame between the steps change
+	float resolvedAlpha;
+
+	int uploadedCount;
+	int uploadedBytes;
+
+	QOpenGLFunctions_4_3_Compatibility* functions;
+	QOpenGLBuffer nodeBuffer;
+	QOpenGLBuffer previousNodeBuffer;
+	QOpenGLBuffer globalBuffer;
+	QOpenGLBuffer orderBuffer;
+	QOpenGLBuffer worldBuffer;
+	GLuint worldTexture;
+};
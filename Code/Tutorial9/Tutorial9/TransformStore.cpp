@@ -0,0 +1,626 @@
+#include "TransformStore.h"
+#include <string.h>
+#include <algorithm>
+
+/*
+Description:
+	This function is a constructor;
+Input:
+	@ JobSystem* jobSystem: the job system used to update the levels in parallel, 0 to update serially;
+*/
+TransformStore::TransformStore(JobSystem* jobSystem) :
+	jobSystem(jobSystem), orderDirty(false), dirty(false), revision(0), deviceEvaluation(false), previousRenderSnapshot(0), renderSnapshot(0), renderAlpha(1.0f), renderDeviceEvaluation(false) {
+}
+
+/*
+Description:
+	This function is a destructor;
+Input:
+	@ void patameter: void;
+*/
+TransformStore::~TransformStore() {
+}
+
+/*
+Description:
+	This function is used to create a root transform at the end of the store;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the handle of the transform;
+*/
+int TransformStore::create() {
+	int handle;
+	if (!freeHandles.isEmpty()) {
+		handle = freeHandles.last();
+		freeHandles.removeLast();
+	}
+	else {
+		handle = handleSlots.size();
+		handleSlots.append(-1);
+	}
+
+	QMatrix4x4 identity;
+	identity.setToIdentity();
+
+	handleSlots[handle] = translations.size();
+	translations.append(QVector3D());
+	rotations.append(QQuaternion());
+	scales.append(1.0f);
+	globals.append(identity);
+	localMatrices.append(SimdMath::identity());
+	worldMatrices.append(SimdMath::identity());
+	parents.append(-1);
+	flags.append(LocalDirty | WorldDirty);
+	slotHandles.append(handle);
+
+	// a root depends on no other slot, so the last level takes it and the order stays valid
+	if (!orderDirty) {
+		if (levelOffsets.size() < 2)
+			levelOffsets.fill(0, 2);
+		levelOffsets.last() = slotHandles.size();
+	}
+	dirty = true;
+	revision++;
+	return handle;
+}
+
+/*
+Description:
+	This function is used to release a transform, its children become root transforms, and its slot is reclaimed by the next sort;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::release(int handle) {
+	int slot = handleSlots[handle];
+
+	for (int i = 0; i < parents.size(); i++) {
+		if (parents[i] == slot) {
+			parents[i] = -1;
+			flags[i] |= WorldDirty;
+		}
+	}
+
+	flags[slot] = Dead;
+	parents[slot] = -1;
+	handleSlots[handle] = -1;
+	freeHandles.append(handle);
+
+	orderDirty = true;
+	dirty = true;
+	revision++;
+}
+
+/*
+Description:
+	This function is used to rotate a transform;
+Input:
+	@ int handle: the handle of the transform;
+	@ const QQuaternion& r: a quaternion (scalar, x position, y position, and z position) for rotation;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::rotate(int handle, const QQuaternion& r) {
+	int slot = handleSlots[handle];
+	rotations[slot] = r * rotations[slot];
+	flags[slot] |= LocalDirty | WorldDirty;
+	dirty = true;
+	revision++;
+}
+
+/*
+Description:
+	This function is used to translate a transform;
+Input:
+	@ int handle: the handle of the transform;
+	@ const QVector3D& t: a translation vector;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::translate(int handle, const QVector3D& t) {
+	int slot = handleSlots[handle];
+	translations[slot] += t;
+	flags[slot] |= LocalDirty | WorldDirty;
+	dirty = true;
+	revision++;
+}
+
+/*
+Description:
+	This function is used to scale a transform;
+Input:
+	@ int handle: the handle of the transform;
+	@ const float& s: a scalar;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::scale(int handle, const float& s) {
+	int slot = handleSlots[handle];
+	scales[slot] *= s;
+	flags[slot] |= LocalDirty | WorldDirty;
+	dirty = true;
+	revision++;
+}
+
+/*
+Description:
+	This function is used to set the global transform of a transform, which is used as the parent matrix while the transform has no parent;
+Input:
+	@ int handle: the handle of the transform;
+	@ const QMatrix4x4& g: a global transformation;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::setGlobalTransform(int handle, const QMatrix4x4& g) {
+	int slot = handleSlots[handle];
+	globals[slot] = g;
+	if (parents[slot] < 0) {
+		flags[slot] |= WorldDirty;
+		dirty = true;
+		revision++;
+	}
+}
+
+/*
+Description:
+	This function is used to attach a transform to a parent, detaching a transform keeps the current world matrix of its parent as the global transform;
+Input:
+	@ int handle: the handle of the transform;
+	@ int parentHandle: the handle of the new parent, -1 to detach;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::setParent(int handle, int parentHandle) {
+	if (getParent(handle) == parentHandle) return;
+
+	// a detached transform depends on no other slot, so the order stays valid,
+	// an attached one keeps the order while its parent is in an earlier level, the last slot has no children, so it may move into a level of its own
+	if (parentHandle < 0) {
+		update();
+		int slot = handleSlots[handle];
+		globals[slot] = SimdMath::toQMatrix(worldMatrices[parents[slot]]);
+		parents[slot] = -1;
+	}
+	else {
+		int slot = handleSlots[handle];
+		int parentSlot = handleSlots[parentHandle];
+		parents[slot] = parentSlot;
+		if (!orderDirty) {
+			int level = getLevel(slot);
+			int parentLevel = getLevel(parentSlot);
+			if (parentLevel == level && slot == slotHandles.size() - 1 && parentSlot < slot) {
+				levelOffsets.last() = slot;
+				levelOffsets.append(slot + 1);
+			}
+			else if (parentLevel >= level)
+				orderDirty = true;
+		}
+	}
+
+	flags[handleSlots[handle]] |= WorldDirty;
+	dirty = true;
+	revision++;
+}
+
+/*
+Description:
+	This function is used to get the parent of a transform;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ int returnValue: the handle of the parent, -1 for a root transform;
+*/
+int TransformStore::getParent(int handle) const {
+	int parent = parents[handleSlots[handle]];
+	return parent < 0 ? -1 : slotHandles[parent];
+}
+
+/*
+Description:
+	This function is used to get the matrix the local matrix of a transform is applied to, which is the world matrix of the parent or the global transform of a root transform;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ QMatrix4x4 returnValue: the parent matrix;
+*/
+QMatrix4x4 TransformStore::getParentMatrix(int handle) {
+	update();
+	int slot = handleSlots[handle];
+	return parents[slot] < 0 ? globals[slot] : SimdMath::toQMatrix(worldMatrices[parents[slot]]);
+}
+
+/*
+Description:
+	This function is used to get the local matrix (translation * rotation * scale) of a transform;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ QMatrix4x4 returnValue: the local matrix;
+*/
+QMatrix4x4 TransformStore::getLocalMatrix(int handle) {
+	update();
+	return SimdMath::toQMatrix(localMatrices[handleSlots[handle]]);
+}
+
+/*
+Description:
+	This function is used to get the world matrix of a transform;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 TransformStore::getWorldMatrix(int handle) {
+	update();
+	return SimdMath::toQMatrix(worldMatrices[handleSlots[handle]]);
+}
+
+/*
+Description:
+	This function is used to find the level of a slot while the order is valid;
+Input:
+	@ int slot: the slot;
+Output:
+	@ int returnValue: the index of the level holding the slot;
+*/
+int TransformStore::getLevel(int slot) const {
+	return int(std::upper_bound(levelOffsets.constBegin(), levelOffsets.constEnd(), slot) - levelOffsets.constBegin()) - 1;
+}
+
+/*
+Description:
+	This function is used to bring all the matrices up to date, the levels are swept in depth order, and the slots of a level are split across the job system;
+	a world matrix is only rebuilt when the transform or one of its ancestors is changed since the last sweep, every slot is computed the same way on any thread, so the result does not depend on the thread count;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::update() {
+	if (orderDirty) sort();
+	if (!dirty) return;
+
+	const int grainSize = 1024;
+	for (int level = 0; level + 1 < levelOffsets.size(); level++) {
+		if (jobSystem != 0)
+			jobSystem->parallelFor(levelOffsets[level], levelOffsets[level + 1], grainSize, [this](int begin, int end) { updateRange(begin, end); });
+		else
+			updateRange(levelOffsets[level], levelOffsets[level + 1]);
+	}
+
+	int count = flags.size();
+	quint8* flag = flags.data();
+	for (int i = 0; i < count; i++)
+		flag[i] &= ~Changed;
+
+	dirty = false;
+}
+
+/*
+Description:
+	This function is used to update the matrices of a range of slots in the same depth level;
+Input:
+	@ int begin: the first slot;
+	@ int end: one past the last slot;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::updateRange(int begin, int end) {
+	// raw pointers, the arrays are not resized during a sweep and QVector::operator[] would check for detaching on every access
+	quint8* flag = flags.data();
+	const int* parent = parents.constData();
+	const QVector3D* translation = translations.constData();
+	const QQuaternion* rotation = rotations.constData();
+	const float* scale = scales.constData();
+	const QMatrix4x4* global = globals.constData();
+	Matrix4* local = localMatrices.data();
+	Matrix4* world = worldMatrices.data();
+
+	// rebuild the local matrices in runs of dirty slots, so that the kernel can build several matrices at once
+	for (int i = begin; i < end;) {
+		if (!(flag[i] & LocalDirty)) {
+			i++;
+			continue;
+		}
+		int run = i + 1;
+		while (run < end && (flag[run] & LocalDirty))
+			run++;
+		SimdMath::composeAffine(translation + i, rotation + i, scale + i, local + i, run - i);
+		i = run;
+	}
+
+	for (int i = begin; i < end; i++) {
+		quint8 f = flag[i];
+		int p = parent[i];
+		if ((f & WorldDirty) || (p >= 0 && (flag[p] & Changed))) {
+			// a global transform may be any matrix, only the products of the hierarchy are known to be affine
+			if (p < 0)
+				world[i] = SimdMath::fromQMatrix(global[i] * SimdMath::toQMatrix(local[i]));
+			else
+				SimdMath::multiplyAffine(world[p], local[i], world[i]);
+			f |= Changed;
+		}
+		flag[i] = f & ~(LocalDirty | WorldDirty);
+	}
+}
+
+/*
+Description:
+	This function is used to copy the world matrices of all the transforms into a snapshot indexed by handle, which is called by the thread updating the store;
+	the snapshot can be read by another thread while the store goes on changing, the matrices of released handles are left as identity;
+Input:
+	@ QVector<Matrix4>& worldMatrices: the snapshot, whose storage is reused from frame to frame;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::capture(QVector<Matrix4>& worldMatrices) {
+	update();
+
+	int count = handleSlots.size();
+	worldMatrices.resize(count);
+	Matrix4* target = worldMatrices.data();
+	const Matrix4* source = this->worldMatrices.constData();
+	for (int handle = 0; handle < count; handle++) {
+		int slot = handleSlots[handle];
+		target[handle] = slot < 0 ? SimdMath::identity() : source[slot];
+	}
+}
+
+/*
+Description:
+	This function is used to copy the local values of all the transforms into a snapshot for a TransformBuffer, which is called by the thread updating the store;
+	the nodes are indexed by handle and refer to their parents by handle, so the snapshot stays valid while the store is sorted again, the handles of released transforms are left out of the order;
+Input:
+	@ TransformNodes& nodes: the snapshot, whose storage is reused from frame to frame;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::captureNodes(TransformNodes& nodes) {
+	if (orderDirty) sort();
+
+	int count = handleSlots.size();
+	nodes.nodes.resize(count);
+	nodes.globals.resize(count);
+	for (int handle = 0; handle < count; handle++) {
+		TransformNodes::Node& node = nodes.nodes[handle];
+		int slot = handleSlots[handle];
+		if (slot < 0) {
+			memset(&node, 0, sizeof(node));
+			node.parent[0] = -1;
+			nodes.globals[handle] = SimdMath::identity();
+			continue;
+		}
+
+		const QVector3D& t = translations[slot];
+		const QQuaternion& r = rotations[slot];
+		node.translationScale[0] = t.x();
+		node.translationScale[1] = t.y();
+		node.translationScale[2] = t.z();
+		node.translationScale[3] = scales[slot];
+		node.rotation[0] = r.x();
+		node.rotation[1] = r.y();
+		node.rotation[2] = r.z();
+		node.rotation[3] = r.scalar();
+		node.parent[0] = parents[slot] < 0 ? -1 : slotHandles[parents[slot]];
+		node.parent[1] = node.parent[2] = node.parent[3] = 0;
+		nodes.globals[handle] = SimdMath::fromQMatrix(globals[slot]);
+	}
+
+	// the slots are in level order, so the handles in slot order resolve every parent before its children
+	nodes.order = slotHandles;
+	nodes.levelOffsets = levelOffsets;
+}
+
+/*
+Description:
+	This function is used to set the snapshots the transforms are drawn from, the thread drawing sets them before a frame, the transforms are drawn between the two steps;
+Input:
+	@ const QVector<Matrix4>* previousWorldMatrices: the snapshot of the step before, 0 to draw the latest step as it is;
+	@ const QVector<Matrix4>* worldMatrices: the snapshot of the latest step captured by TransformStore::capture(QVector<Matrix4>&), 0 to draw the live matrices;
+	@ float alpha: the position of the frame between the two steps, 0 at the step before and 1 at the latest step;
+	@ bool deviceEvaluated: whether the store was evaluated on the GPU when the snapshot was captured, the draws then fetch the world matrices of a TransformBuffer;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::setRenderSnapshot(const QVector<Matrix4>* previousWorldMatrices, const QVector<Matrix4>* worldMatrices, float alpha, bool deviceEvaluated) {
+	previousRenderSnapshot = previousWorldMatrices;
+	renderSnapshot = worldMatrices;
+	renderAlpha = qBound(0.0f, alpha, 1.0f);
+	renderDeviceEvaluation = deviceEvaluated;
+}
+
+/*
+Description:
+	This function is used to get the world matrix a transform is drawn with, which is blended between the snapshots of the last two steps if they are set;
+Input:
+	@ int handle: the handle of the transform;
+Output:
+	@ QMatrix4x4 returnValue: the world matrix;
+*/
+QMatrix4x4 TransformStore::getRenderMatrix(int handle) {
+	if (renderSnapshot == 0) return getWorldMatrix(handle);
+
+	// a transform created after the snapshot is drawn at the origin until the next snapshot
+	if (handle >= renderSnapshot->size()) return QMatrix4x4();
+	const Matrix4& current = renderSnapshot->at(handle);
+
+	// a transform that did not move, or did not exist a step before, needs no blending
+	if (previousRenderSnapshot == 0 || handle >= previousRenderSnapshot->size() || renderAlpha >= 1.0f) return SimdMath::toQMatrix(current);
+	const Matrix4& previous = previousRenderSnapshot->at(handle);
+	if (memcmp(&previous, &current, sizeof(Matrix4)) == 0) return SimdMath::toQMatrix(current);
+
+	Matrix4 result;
+	SimdMath::interpolateAffine(previous, current, renderAlpha, result);
+	return SimdMath::toQMatrix(result);
+}
+
+/*
+Description:
+	This function is used to get total amount of transforms in the store;
+Input:
+	@ void parameter: void;
+Output:
+	@ int returnValue: the total amount of transforms;
+*/
+int TransformStore::getCount() const {
+	return translations.size();
+}
+
+/*
+Description:
+	This function is used to get the revision of the store, which is advanced by every change that can move a world matrix, so a snapshot with the same revision shows the same transforms;
+Input:
+	@ void parameter: void;
+Output:
+	@ quint64 returnValue: the revision;
+*/
+quint64 TransformStore::getRevision() const {
+	return revision;
+}
+
+/*
+Description:
+	This function is used to set the job system used to update the levels in parallel;
+Input:
+	@ JobSystem* jobSystem: the job system, 0 to update serially;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::setJobSystem(JobSystem* jobSystem) {
+	this->jobSystem = jobSystem;
+}
+
+/*
+Description:
+	This function is used to choose where the world matrices used for drawing are resolved, which is called by the thread updating the store, the CPU matrices are still computed on demand by the getters;
+Input:
+	@ bool enabled: true to capture the nodes of the transforms for a TransformBuffer, which resolves the world matrices on the GPU;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::setDeviceEvaluation(bool enabled) {
+	deviceEvaluation = enabled;
+}
+
+/*
+Description:
+	This function is used to check whether the world matrices used for drawing are resolved on the GPU, which is called by the thread updating the store;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the nodes of the transforms are captured for a TransformBuffer;
+*/
+bool TransformStore::isDeviceEvaluated() const {
+	return deviceEvaluation;
+}
+
+/*
+Description:
+	This function is used to check whether the transforms are drawn with the world matrices resolved on the GPU, which is called by the thread drawing, and follows the snapshot of the frame when the store has one;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the draws fetch their world matrices from a TransformBuffer by handle;
+*/
+bool TransformStore::isRenderedOnDevice() const {
+	return renderSnapshot != 0 ? renderDeviceEvaluation : deviceEvaluation;
+}
+
+/*
+Description:
+	This function is used to get the store shared by all the transforms created without a store, which is updated on the default job system;
+Input:
+	@ void parameter: void;
+Output:
+	@ TransformStore* returnValue: the default store;
+*/
+TransformStore* TransformStore::getDefault() {
+	static TransformStore store(JobSystem::getDefault());
+	return &store;
+}
+
+/*
+Description:
+	This function is used to reorder the slots by hierarchy depth with a stable counting sort, released slots are dropped;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void TransformStore::sort() {
+	int count = flags.size();
+
+	// the depth of each slot, parents are not sorted yet, so the chain is walked upwards
+	QVector<int> depths(count, 0);
+	int maxDepth = 0;
+	for (int i = 0; i < count; i++) {
+		if (flags[i] & Dead) continue;
+		int depth = 0;
+		for (int p = parents[i]; p >= 0; p = parents[p])
+			depth++;
+		depths[i] = depth;
+		maxDepth = qMax(maxDepth, depth);
+	}
+
+	QVector<int> offsets(maxDepth + 2, 0);
+	for (int i = 0; i < count; i++) {
+		if (!(flags[i] & Dead))
+			offsets[depths[i] + 1]++;
+	}
+	for (int d = 1; d < offsets.size(); d++)
+		offsets[d] += offsets[d - 1];
+
+	QVector<int> newSlots(count, -1);
+	for (int i = 0; i < count; i++) {
+		if (!(flags[i] & Dead))
+			newSlots[i] = offsets[depths[i]]++;
+	}
+	int liveCount = offsets[maxDepth];
+
+	// after the placement above, offsets[d] is the end of level d, which is the start of level d + 1
+	levelOffsets.resize(maxDepth + 2);
+	levelOffsets[0] = 0;
+	for (int d = 0; d <= maxDepth; d++)
+		levelOffsets[d + 1] = offsets[d];
+	if (liveCount == 0)
+		levelOffsets.resize(1);
+
+	QVector<QVector3D> sortedTranslations(liveCount);
+	QVector<QQuaternion> sortedRotations(liveCount);
+	QVector<float> sortedScales(liveCount);
+	QVector<QMatrix4x4> sortedGlobals(liveCount);
+	QVector<Matrix4> sortedLocalMatrices(liveCount);
+	QVector<Matrix4> sortedWorldMatrices(liveCount);
+	QVector<int> sortedParents(liveCount);
+	QVector<quint8> sortedFlags(liveCount);
+	QVector<int> sortedSlotHandles(liveCount);
+
+	for (int i = 0; i < count; i++) {
+		int slot = newSlots[i];
+		if (slot < 0) continue;
+		sortedTranslations[slot] = translations[i];
+		sortedRotations[slot] = rotations[i];
+		sortedScales[slot] = scales[i];
+		sortedGlobals[slot] = globals[i];
+		sortedLocalMatrices[slot] = localMatrices[i];
+		sortedWorldMatrices[slot] = worldMatrices[i];
+		sortedParents[slot] = parents[i] < 0 ? -1 : newSlots[parents[i]];
+		sortedFlags[slot] = flags[i];
+		sortedSlotHandles[slot] = slotHandles[i];
+		handleSlots[slotHandles[i]] = slot;
+	}
+
+	translations.swap(sortedTranslations);
+	rotations.swap(sortedRotations);
+	scales.swap(sortedScales);
+	globals.swap(sortedGlobals);
+	localMatrices.swap(sortedLocalMatrices);
+	worldMatrices.swap(sortedWorldMatrices);
+	parents.swap(sortedParents);
+	flags.swap(sortedFlags);
+	slotHandles.swap(sortedSlotHandles);
+
+	orderDirty = false;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <qquaternion.h>
+#include <qvector3d.h>
+#include <qmatrix4x4.h>
+#include <qvector.h>
+#include "JobSystem.h"
+#include "SimdMath.h"
+
+// the local values of the transforms of a store, indexed by handle, captured by the thread updating the store and uploaded by a TransformBuffer on the thread drawing
+struct TransformNodes {
+	// one node per handle, the parent is a handle as well, matches struct Node in Hierarchy.csh (std430)
+	struct Node {
+		float translationScale[4];
+		float rotation[4];
+		qint32 parent[4];
+	};
+
+	QVector<Node> nodes;
+	QVector<Matrix4> globals;
+
+	// the live handles in level order, which lists every parent before its children, and the first entry of each level
+	QVector<int> order;
+	QVector<int> levelOffsets;
+};
+
+class TransformStore {
+public:
+	TransformStore(JobSystem* jobSystem = 0);
+	~TransformStore();
+	int create();
+	void release(int handle);
+	void rotate(int handle, const QQuaternion& r);
+	void translate(int handle, const QVector3D& t);
+	void scale(int handle, const float& s);
+	void setGlobalTransform(int handle, const QMatrix4x4& g);
+	void setParent(int handle, int parentHandle);
+	int getParent(int handle) const;
+	QMatrix4x4 getParentMatrix(int handle);
+	QMatrix4x4 getLocalMatrix(int handle);
+	QMatrix4x4 getWorldMatrix(int handle);
+	void update();
+	void capture(QVector<Matrix4>& worldMatrices);
+	void captureNodes(TransformNodes& nodes);
+	void setRenderSnapshot(const QVector<Matrix4>* previousWorldMatrices, const QVector<Matrix4>* worldMatrices, float alpha, bool deviceEvaluated);
+	QMatrix4x4 getRenderMatrix(int handle);
+	int getCount() const;
+	quint64 getRevision() const;
+	void setJobSystem(JobSystem* jobSystem);
+	void setDeviceEvaluation(bool enabled);
+	bool isDeviceEvaluated() const;
+	bool isRenderedOnDevice() const;
+
+	static TransformStore* getDefault();
+
+private:
+	enum Flag {
+		LocalDirty = 1,
+		WorldDirty = 2,
+		Changed = 4,
+		Dead = 8
+	};
+
+	void sort();
+	int getLevel(int slot) const;
+	void updateRange(int begin, int end);
+
+	// per slot, sorted by hierarchy depth so that every parent is stored before its children, the transforms created or attached since the last sort are appended to the last levels
+	QVector<QVector3D> translations;
+	QVector<QQuaternion> rotations;
+	QVector<float> scales;
+	QVector<QMatrix4x4> globals;
+	QVector<Matrix4> localMatrices;
+	QVector<Matrix4> worldMatrices;
+	QVector<int> parents;
+	QVector<quint8> flags;
+	QVector<int> slotHandles;
+
+	// per handle, handles stay valid while the slots are reordered
+	QVector<int> handleSlots;
+	QVector<int> freeHandles;
+
+	// the first slot of each depth level, the slots of a level only depend on the previous levels
+	QVector<int> levelOffsets;
+	JobSystem* jobSystem;
+
+	bool orderDirty;
+	bool dirty;
+
+	// advanced by every change that can move a world matrix, a frame is only requested for a snapshot with a new revision
+	quint64 revision;
+
+	// the world matrices are resolved by a TransformBuffer on the GPU from the nodes captured with the snapshots
+	bool deviceEvaluation;
+
+	// the world matrices of the last two simulation steps for the frame being drawn, indexed by handle, 0 to draw the live matrices
+	const QVector<Matrix4>* previousRenderSnapshot;
+	const QVector<Matrix4>* renderSnapshot;
+	float renderAlpha;
+	bool renderDeviceEvaluation;
+};
+
@@ -3,6 +3,10 @@
 #include <qvector3d.h>
 #include <qopenglshaderprogram.h>
 #include <qopenglfunctions.h>
+#include "Transform3D.h"
+
+class CommandBuffer;
+class Prefab3D;
 
 class Transformational {
 public:
@@ -11,5 +15,15 @@ public:
 	virtual void translate(const QVector3D& t) = 0;
 	virtual void scale(const float& s) = 0;
 	virtual void setGlobalTransform(const QMatrix4x4& g) = 0;
+	virtual void setParentTransform(Transform3D* parent) = 0;
 	virtual void draw(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) = 0;
+	virtual void drawDepth(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions) = 0;
+
+	// draws a number of instances at once, whose matrices are bound by a Prefab3D, objects that cannot be instanced draw a single copy
+	virtual void drawInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) { Q_UNUSED(instanceCount); draw(shaderProgram, functions); };
+	virtual void drawDepthInstanced(QOpenGLShaderProgram* shaderProgram, QOpenGLFunctions* functions, int instanceCount) { Q_UNUSED(instanceCount); drawDepth(shaderProgram, functions); };
+
+	// records the draws of every pass into a command buffer instead of drawing, which needs no OpenGL context, so the scene is recorded by many threads at once
+	virtual void record(CommandBuffer* commands) = 0;
+	virtual void recordInstanced(CommandBuffer* commands, Prefab3D* prefab) { Q_UNUSED(prefab); record(commands); };
 };
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "Widget.h"
+#include "JobSystem.h"
+#include "GLStateCache.h"
+#include "ResolutionScaler.h"
 
 /*
 Description:
@@ -10,6 +13,29 @@ Widget::Widget(QWidget* parent) :
 	QOpenGLWidget(parent) {
 	camera = new Camera3D;
 	camera->translate(QVector3D(0.0, 0.0, -5.0));
+
+	lights = new LightEngine3D;
+	transformBuffer = new TransformBuffer;
+	clusterPrefab = 0;
+	drawCommands = new CommandBuffer;
+	indirect = new IndirectRenderer;
+	frameGraph = new FrameGraph;
+
+	depthPrepass = true;
+	indirectDraw = false;
+
+	simulation = 0;
+	renderThread = 0;
+	frameIndex = 0;
+	publishedRevision = 0;
+	publishedTime = 0.0f;
+	viewportWidth = 0;
+	viewportHeight = 0;
+
+	pendingZoom = 0.0f;
+	inputPending = false;
+	onDemand = 1;
+	frameSettled = 0;
 }
 
 /*
@@ -19,13 +45,30 @@ Input:
 	@ void patameter: void;
 */
 Widget::~Widget() {
+	// the simulation requests frames from the render thread, so it is stopped first, after both the scene belongs to the GUI thread again
+	delete simulation;
+	delete renderThread;
+	TransformStore::getDefault()->setRenderSnapshot(0, 0, 1.0f, false);
+
+	// the object engines destroy their objects, whose buffers need the context
+	makeCurrent();
+
 	delete camera;
+	delete lights;
+	delete transformBuffer;
+	delete clusterPrefab;
+	delete drawCommands;
+	delete indirect;
+	delete frameGraph;
+	ResolutionScaler::getDefault()->destroy();
 
 	for (int i = 0; i < objects.size(); i++)
 		delete objects[i];
 
 	for (int i = 0; i < groups.size(); i++)
 		delete groups[i];
+
+	doneCurrent();
 }
 
 /*
@@ -39,41 +82,66 @@ Output:
 void Widget::initializeGL() {
 	setFocusPolicy(Qt::StrongFocus);
 
+	// every class drawing with the context binds its state through the cache
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->init();
+
 	// clear the screen with black
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
+	cache->enable(GL_DEPTH_TEST);
+	cache->enable(GL_CULL_FACE);
 
 	// initialize shaders
 	initShaders();
-
-	skybox = new Skybox(40, QImage("./skybox.jpg").mirrored());
+	transformBuffer->init(shaders.getProgram("Hierarchy"));
+	indirect->init(shaders.getProgram("Cull"), shaders.getProgram("DepthPyramid"));
+	ResolutionScaler::getDefault()->init(shaders.getProgram("Upscale"));
+
+	skybox = new Skybox(QImage("./skybox.jpg"));
+
+	// the first light follows the camera, the others are placed on a ring around the scene
+	lights->init();
+	lights->addLight(PointLight(QVector3D(0.0, 0.0, 0.0), QVector3D(1.0, 1.0, 1.0), 3.0f, 500.0f));
+	for (int i = 0; i < 8; i++) {
+		float angle = 2.0f * M_PI * i / 8.0f;
+		QVector3D color = QVector3D(qMax(0.0, qCos(angle)), qMax(0.0, qSin(angle)), qMax(0.0, -qCos(angle)));
+		lights->addLight(PointLight(QVector3D(6.0f * qCos(angle), 0.0f, 6.0f * qSin(angle)), color, 1.0f, 4.0f));
+	}
 
 	float step = 1.0f;
 
-	groups.append(new Group3D);
+	// the cluster of 8 cubes is defined once, both clusters are instances of it drawn with one instanced draw per cube
+	Group3D* cluster = new Group3D;
 	for (float x = -step; x <= step; x += 2 * step) {
 		for (float y = -step; y <= step; y += 2 * step) {
 			for (float z = -step; z <= step; z += 2 * step) {
 				initCube(0.5f);
 				objects[objects.size() - 1]->translate(QVector3D(x, y, z));
-				groups[groups.size() - 1]->addObject(objects[objects.size() - 1]);
+				cluster->addObject(objects[objects.size() - 1]);
 			}
 		}
 	}
+
+	// the cubes spin on the GPU, alternating between two axes, the odd cubes also bob up and down
+	for (int i = 0; i < objects.size(); i++) {
+		Animation3D animation;
+		animation.setRotation(i % 2 == 0 ? QVector3D(1.0, 1.0, 0.0) : QVector3D(0.0, 1.0, 1.0), 1.2f);
+		if (i % 2 == 1)
+			animation.setOscillation(QVector3D(0.0, 1.0, 0.0), 0.1f, 2.0f);
+		animation.setPhase(0.5f * i);
+		objects[i]->setAnimation(animation);
+	}
+
+	clusterPrefab = new Prefab3D(cluster);
+	clusterPrefab->init();
+
+	groups.append(new Group3D);
+	groups[0]->addObject(clusterPrefab->createInstance());
 	groups[0]->translate(QVector3D(-4.0, 0.0, 0.0));
 
 	groups.append(new Group3D);
-	for (float x = -step; x <= step; x += 2 * step) {
-		for (float y = -step; y <= step; y += 2 * step) {
-			for (float z = -step; z <= step; z += 2 * step) {
-				initCube(0.5f);
-				objects[objects.size() - 1]->translate(QVector3D(x, y, z));
-				groups[groups.size() - 1]->addObject(objects[objects.size() - 1]);
-			}
-		}
-	}
+	groups[1]->addObject(clusterPrefab->createInstance());
 	groups[1]->translate(QVector3D(4.0, 0.0, 0.0));
 
 	groups.append(new Group3D);
@@ -81,6 +149,7 @@ void Widget::initializeGL() {
 	groups[2]->addObject(groups[1]);
 
 	transformObjects.append(groups[2]);
+	transformObjects.append(clusterPrefab);
 
 	groups.append(new Group3D);
 	objects.append(new ObjectEngine3D);
@@ -90,7 +159,42 @@ void Widget::initializeGL() {
 
 	groups[0]->addObject(camera);
 
-	timer.start(10, this);
+	// the definition of the prefab is only kept with the groups to be deleted with them, it is drawn by the prefab
+	groups.append(cluster);
+
+	// the scene is advanced in steps of 10 ms, however long the frames take
+	simulation = new SimulationThread([this]() { simulate(); }, [this]() { capturePreviousFrame(); }, [this]() { publishFrame(); }, 10);
+
+	// without threaded OpenGL the snapshots are drawn by paintGL on the GUI thread
+	if (QOpenGLContext::supportsThreadedOpenGL()) {
+		renderThread = new RenderThread(this, [this]() {
+			glViewport(0, 0, viewportWidth, viewportHeight);
+			frameSettled.storeRelease(renderFrame());
+		});
+
+		// the GUI thread needs the context to resize the widget, so the render thread is held back until the resize is done
+		connect(this, &QOpenGLWidget::aboutToResize, [this]() { renderThread->lock(); });
+		connect(this, &QOpenGLWidget::resized, [this]() {
+			renderThread->unlock();
+			renderThread->requestFrame();
+		});
+
+		// the GUI thread composes the last frame with the context as well, the render thread is held back until the frame is swapped
+		connect(this, &QOpenGLWidget::aboutToCompose, [this]() { renderThread->lock(); });
+		renderThread->start();
+		renderThread->requestFrame();
+	}
+
+	// the frames are paced by the display, the next frame is started as soon as the last one is on screen,
+	// on demand only while the frame on screen is still blended towards the latest step
+	connect(this, &QOpenGLWidget::frameSwapped, [this]() {
+		if (renderThread != 0)
+			renderThread->unlock();
+		if (!onDemand.loadAcquire() || !frameSettled.loadAcquire())
+			requestRender();
+	});
+
+	simulation->start();
 }
 
 /*
@@ -107,36 +211,231 @@ void Widget::resizeGL(int width, int height) {
 
 	pMatrix.setToIdentity();
 	pMatrix.perspective(45, aspect, 0.01f, 500.0f);
+
+	viewportWidth = width * devicePixelRatioF();
+	viewportHeight = height * devicePixelRatioF();
+	lights->setProjection(45, aspect, 0.01f, 500.0f, viewportWidth, viewportHeight);
 }
 
 /*
 Description:
-	This function is used to set parameters for the vertex shader, fragment shader and etc. and draw other objects;
+	This function is used to draw the scene on the GUI thread, which is only called when there is no render thread;
 Input:
 	@ void parameter: void;
 Output:
 	@ void returnValue: void;
 */
 void Widget::paintGL() {
+	frameSettled.storeRelease(renderFrame());
+}
+
+/*
+Description:
+	This function is used to process paint events, which is a Qt event function, a frame drawn by the render thread is only composed, the widget is not drawn again;
+Input:
+	@ QPaintEvent* event: a paint event;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::paintEvent(QPaintEvent* event) {
+	if (renderThread == 0)
+		QOpenGLWidget::paintEvent(event);
+}
+
+/*
+Description:
+	This function is used to set parameters for the vertex shader, fragment shader and etc. and draw other objects, the scene is drawn as captured by the latest snapshot;
+Input:
+	@ void parameter: void;
+Output:
+	@ bool returnValue: true if the frame shows the latest step, false if it is blended between the steps or nothing is published yet;
+*/
+bool Widget::renderFrame() {
+	// the state bound by the last frame is forgotten, the binds dropped by the cache are counted from here
+	GLStateCache* cache = GLStateCache::getDefault();
+	cache->beginFrame();
+
+	// the geometry blocks left in pieces by released meshes are compacted, before the draws of the frame read their ranges
+	ResourceCache::getDefault()->getGeometryArena()->defragment();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	skyboxShader.bind();
-	skyboxShader.setUniformValue("u_projectionMatrix", pMatrix);
+	// the latest snapshot published by the simulation, without a new one the last snapshot is drawn again
+	frames.acquire();
+	const FrameSnapshot& frame = frames.getReadBuffer();
+	if (frame.frame == 0) return false;
+
+	// the frame is timed from here, the scale of the scene follows the GPU time, the CPU time is only measured
+	ResolutionScaler* scaler = ResolutionScaler::getDefault();
+	scaler->beginFrame();
+
+	// the frame is drawn one step behind the simulation, blended between the last two steps by the time passed since the latest one,
+	// so the motion is smooth at any display rate
+	float interval = simulation->getInterval() / 1000.0f;
+	float alpha = qBound(0.0f, (simulation->getClockTime() - frame.stateTime) / (interval * 1.0e9f), 1.0f);
+
+	QMutexLocker locker(&sceneMutex);
+	TransformStore::getDefault()->setRenderSnapshot(&frame.previousWorldMatrices, &frame.worldMatrices, alpha, frame.deviceEvaluation);
+
+	Matrix4 blendedViewMatrix;
+	SimdMath::interpolateAffine(SimdMath::fromQMatrix(frame.previousViewMatrix), SimdMath::fromQMatrix(frame.viewMatrix), alpha, blendedViewMatrix);
+	QMatrix4x4 viewMatrix = SimdMath::toQMatrix(blendedViewMatrix);
+
+	// one time for both passes, so that the animated positions of the prepass and the object pass are identical
+	float animationTime = frame.previousTime + (frame.time - frame.previousTime) * alpha;
+
+	// upload the nodes changed since the last frame and resolve the world matrices on the GPU, if the store was evaluated there when the snapshot was captured
+	if (frame.deviceEvaluation)
+		transformBuffer->update(&frame.previousNodes, frame.nodes, alpha);
+
+	// the scene is traversed on all the threads, the drawables record their draws of both passes, which are merged and replayed here, where the context is current
+	drawCommands->reset(frame.depthPrepass);
+	drawCommands->getJobSystem()->parallelFor(0, transformObjects.size(), 1, [this](int first, int last) {
+		for (int i = first; i < last; i++)
+			transformObjects[i]->record(drawCommands);
+	});
+	drawCommands->merge();
+
+	// the passes of the frame are declared with what they read and write, the frame graph orders them and binds their targets
+	QMatrix4x4 viewProjectionMatrix = pMatrix * viewMatrix;
+	QOpenGLShaderProgram* prepassShader = frame.indirectDraw ? indirectDepthShader : depthShader;
+	const QVector<QOpenGLShaderProgram*>& colorShaders = frame.indirectDraw ? indirectShaders : objectShaders;
+
+	frameGraph->reset();
+	int backbuffer = frameGraph->importFramebuffer("Backbuffer", defaultFramebufferObject(), viewportWidth, viewportHeight);
+	int culledObjects = frameGraph->createBuffer("CulledObjects");
+
+	// with dynamic resolution the scene is drawn to the lower left region of transient textures sized for the largest scale, otherwise straight to the framebuffer of the widget,
+	// so the textures and the depth pyramid are kept while the scale changes
+	QSize sceneSize = scaler->getSceneSize(QSize(viewportWidth, viewportHeight));
+	QSize targetSize = scaler->getTargetSize(QSize(viewportWidth, viewportHeight));
+
+	// the clusters are looked up by the pixel position in the scene target, so their tiles follow its size, not the size of the widget
+	lights->setTargetSize(sceneSize.width(), sceneSize.height());
+	int sceneColor = backbuffer, sceneDepth = backbuffer;
+	if (scaler->isEnabled()) {
+		sceneColor = frameGraph->createTexture("SceneColor", FrameGraph::TextureDesc(targetSize.width(), targetSize.height(), GL_RGBA8));
+		sceneDepth = frameGraph->createTexture("SceneDepth", FrameGraph::TextureDesc(targetSize.width(), targetSize.height(), GL_DEPTH24_STENCIL8));
+
+		int pass = frameGraph->addPass("ClearScene", [&]() {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		});
+		frameGraph->write(pass, sceneColor);
+		frameGraph->write(pass, sceneDepth);
+	}
 
-	camera->draw(&skyboxShader);
-	skybox->draw(&skyboxShader, context()->functions());
-	skyboxShader.release();
+	// on the GPU-driven path the recorded draws become objects in a storage buffer, which are culled against the frustum and the depth of the last frame
+	if (frame.indirectDraw) {
+		int pass = frameGraph->addPass("Cull", [&]() {
+			indirect->update(drawCommands);
+			indirect->cull(viewProjectionMatrix, transformBuffer);
+		});
+		frameGraph->write(pass, culledObjects);
+	}
 
-	objectShader.bind();
-	objectShader.setUniformValue("u_projectionMatrix", pMatrix);
-	objectShader.setUniformValue("u_lightPosition", QVector4D(0.0, 0.0, 0.0, 1.0));
-	objectShader.setUniformValue("u_lightPower", 3.0f);
+	// depth prepass, lay down the depth of opaque geometry with a trivial shader so that the lighting runs at most once per pixel
+	if (frame.depthPrepass) {
+		int pass = frameGraph->addPass("DepthPrepass", [&]() {
+			cache->colorMask(false);
+
+			cache->useProgram(prepassShader);
+			prepassShader->setUniformValue("u_projectionMatrix", pMatrix);
+			prepassShader->setUniformValue("u_time", animationTime);
+			transformBuffer->bind(prepassShader);
+			prepassShader->setUniformValue("u_viewMatrix", viewMatrix);
+
+			if (frame.indirectDraw) indirect->draw(DrawCommand::DepthPass, prepassShader);
+			else drawCommands->replay(DrawCommand::DepthPass, prepassShader);
+
+			cache->colorMask(true);
+			cache->depthMask(false);
+			cache->depthFunc(GL_EQUAL);
+		});
+		if (frame.indirectDraw) frameGraph->read(pass, culledObjects);
+		frameGraph->read(pass, sceneDepth);
+		frameGraph->write(pass, sceneColor);
+		frameGraph->write(pass, sceneDepth);
+		frameGraph->setViewport(pass, sceneSize.width(), sceneSize.height());
+	}
+
+	// one pass per object shader variant, each object is only drawn by the variant matching its material
+	int colorPass = frameGraph->addPass("Objects", [&]() {
+		for (int v = 0; v < colorShaders.size(); v++) {
+			QOpenGLShaderProgram* objectShader = colorShaders[v];
+			cache->useProgram(objectShader);
+			objectShader->setUniformValue("u_projectionMatrix", pMatrix);
+			objectShader->setUniformValue("u_time", animationTime);
+			transformBuffer->bind(objectShader);
+			objectShader->setUniformValue("u_viewMatrix", viewMatrix);
+
+			// assign the lights to the clusters of the current view
+			if (v == 0) {
+				PointLight headlight = lights->getLight(0);
+				headlight.position = Transform3D::affineInverse(viewMatrix).map(QVector3D(0.0, 0.0, 0.0));
+				lights->setLight(0, headlight);
+				lights->update(viewMatrix);
+			}
+			lights->bind(objectShader);
 
-	camera->draw(&objectShader);
-	for (int i = 0; i < transformObjects.size(); i++) {
-		transformObjects[i]->draw(&objectShader, context()->functions());
+			if (frame.indirectDraw) indirect->draw(DrawCommand::ColorPass, objectShader);
+			else drawCommands->replay(DrawCommand::ColorPass, objectShader);
+		}
+	});
+	if (frame.indirectDraw) frameGraph->read(colorPass, culledObjects);
+	frameGraph->read(colorPass, sceneColor);
+	frameGraph->read(colorPass, sceneDepth);
+	frameGraph->write(colorPass, sceneColor);
+	frameGraph->write(colorPass, sceneDepth);
+	frameGraph->setViewport(colorPass, sceneSize.width(), sceneSize.height());
+
+	// the depth of the opaque geometry is kept for the occlusion culling of the next frame, which nothing in this frame reads
+	if (frame.indirectDraw) {
+		int pass = frameGraph->addPass("CaptureDepth", [&]() {
+			indirect->captureDepth(frameGraph->getTargetFramebuffer(colorPass), sceneSize.width(), sceneSize.height(), targetSize.width(), targetSize.height(), viewProjectionMatrix);
+		});
+		frameGraph->read(pass, sceneDepth);
+		frameGraph->setSideEffect(pass);
 	}
-	objectShader.release();
+
+	// the skybox is drawn last at the maximum depth, so its pixels run only where no geometry is visible
+	int skyboxPass = frameGraph->addPass("Skybox", [&]() {
+		cache->depthFunc(GL_LEQUAL);
+		cache->depthMask(false);
+
+		QMatrix4x4 skyboxViewMatrix = viewMatrix;
+		skyboxViewMatrix.setColumn(3, QVector4D(0.0, 0.0, 0.0, 1.0));
+
+		cache->useProgram(skyboxShader);
+		skyboxShader->setUniformValue("u_inverseViewProjectionMatrix", (pMatrix * skyboxViewMatrix).inverted());
+		skybox->draw(skyboxShader, context()->functions());
+
+		// restore the default depth state, the depth buffer can only be cleared with depth writes enabled
+		cache->depthFunc(GL_LESS);
+		cache->depthMask(true);
+	});
+	frameGraph->read(skyboxPass, sceneColor);
+	frameGraph->write(skyboxPass, sceneColor);
+
+	// the depth is only tested with the writes off, it is attached to the target without the pass becoming a writer of it
+	frameGraph->attach(skyboxPass, sceneDepth);
+	frameGraph->setViewport(skyboxPass, sceneSize.width(), sceneSize.height());
+
+	// the scaled scene is stretched over the framebuffer of the widget and sharpened, the depth test is off so the cleared depth does not hide it
+	if (scaler->isEnabled()) {
+		int pass = frameGraph->addPass("Upscale", [&]() {
+			cache->disable(GL_DEPTH_TEST);
+			scaler->upscale(frameGraph->getTexture(sceneColor), sceneSize, targetSize);
+			cache->enable(GL_DEPTH_TEST);
+		});
+		frameGraph->read(pass, sceneColor);
+		frameGraph->write(pass, backbuffer);
+	}
+
+	if (frameGraph->compile()) frameGraph->execute();
+
+	scaler->endFrame();
+
+	return alpha >= 1.0f;
 }
 
 /*
@@ -151,7 +450,6 @@ void Widget::mousePressEvent(QMouseEvent* event) {
 	if (event->buttons() == Qt::LeftButton)
 		mousePosition = QVector2D(event->localPos());
 	event->accept();
-	update();
 }
 
 /*
@@ -172,9 +470,7 @@ void Widget::mouseMoveEvent(QMouseEvent* event) {
 
 	QVector3D axis = QVector3D(diff.y(), diff.x(), 0.0);
 
-	camera->rotate(QQuaternion::fromAxisAndAngle(axis, angle));
-
-	update();
+	queueCameraInput(QQuaternion::fromAxisAndAngle(axis, angle), 0.0f);
 }
 
 /*
@@ -187,34 +483,23 @@ Output:
 */
 void Widget::wheelEvent(QWheelEvent* event) {
 	if (event->delta() > 0) {
-		camera->translate(QVector3D(0.0, 0.0, 0.25));
+		queueCameraInput(QQuaternion(), 0.25f);
 	}
 	else if (event->delta() < 0) {
-		camera->translate(QVector3D(0.0, 0.0, -0.25));
+		queueCameraInput(QQuaternion(), -0.25f);
 	}
-	update();
 }
 
 /*
 Description:
-	This function is used to process timer events, which is a Qt event function;
-Intput:
-	@ QKeyEvent* event: a timer event;
+	This function is used to advance the scene by one step, which is called on the simulation thread;
+Input:
+	@ void parameter: void;
 Output:
 	@ void returnValue: void;
 */
-void Widget::timerEvent(QTimerEvent* event) {
-	for (int i = 0; i < objects.size() - 1; i++) {
-		if (i % 2 == 0) {
-			objects[i]->rotate(QQuaternion::fromAxisAndAngle(1.0, 0.0, 0.0, qSin(angleObject)));
-			objects[i]->rotate(QQuaternion::fromAxisAndAngle(0.0, 1.0, 0.0, qCos(angleObject)));
-		}
-		else {
-			objects[i]->rotate(QQuaternion::fromAxisAndAngle(0.0, 1.0, 0.0, qSin(angleObject)));
-			objects[i]->rotate(QQuaternion::fromAxisAndAngle(1.0, 0.0, 0.0, qCos(angleObject)));
-		}
-	}
-
+void Widget::simulate() {
+	// the cubes are animated in the vertex shader, only the groups, which carry the camera, are updated here
 	groups[0]->rotate(QQuaternion::fromAxisAndAngle(0.0, 0.0, 1.0, qSin(angleGroup1)));
 	groups[0]->rotate(QQuaternion::fromAxisAndAngle(0.0, 1.0, 0.0, -qSin(angleGroup1)));
 
@@ -224,12 +509,137 @@ void Widget::timerEvent(QTimerEvent* event) {
 	groups[2]->rotate(QQuaternion::fromAxisAndAngle(1.0, 0.0, 0.0, qSin(angleMain)));
 	groups[2]->rotate(QQuaternion::fromAxisAndAngle(0.0, 1.0, 0.0, qCos(angleMain)));
 
-	angleObject += M_PI / 180.0f;
 	angleGroup1 += M_PI / 360.0f;
 	angleGroup2 -= M_PI / 360.0f;
 	angleMain += M_PI / 720.0f;
+}
+
+/*
+Description:
+	This function is used to capture the state the next snapshot is blended from into the write buffer, which is called on the simulation thread before the last step of a pass;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::capturePreviousFrame() {
+	camera->updateViewMatrix();
+
+	// the write buffer is only published by publishFrame(), so its storage is reused without a copy
+	FrameSnapshot& frame = frames.getWriteBuffer();
+	frame.previousTime = simulation->getSimulationTime();
+	frame.previousViewMatrix = camera->getViewMatrix();
+
+	TransformStore* store = TransformStore::getDefault();
+	store->capture(frame.previousWorldMatrices);
+	if (store->isDeviceEvaluated())
+		store->captureNodes(frame.previousNodes);
+	else
+		frame.previousNodes = TransformNodes();
+}
+
+/*
+Description:
+	This function is used to publish a snapshot of the latest step together with the state before that step, which is called on the simulation thread after the steps due;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::publishFrame() {
+	camera->updateViewMatrix();
+
+	// every field is written here or by capturePreviousFrame(), the write buffer may hold a snapshot of an older step
+	FrameSnapshot& frame = frames.getWriteBuffer();
+	frame.frame = ++frameIndex;
+	frame.time = simulation->getSimulationTime();
+	frame.stateTime = simulation->getStateTime();
+	frame.viewMatrix = camera->getViewMatrix();
+	frame.depthPrepass = depthPrepass;
+	frame.indirectDraw = indirectDraw;
+	TransformStore* store = TransformStore::getDefault();
+	store->capture(frame.worldMatrices);
+
+	// the render thread never reads the live store, the nodes resolved on the GPU are captured with the snapshot as well
+	frame.deviceEvaluation = store->isDeviceEvaluated();
+	if (frame.deviceEvaluation)
+		store->captureNodes(frame.nodes);
+	else
+		frame.nodes = TransformNodes();
+
+	// a store switched to the GPU by the last command has no nodes from before, the latest step is drawn as it is
+	if (frame.previousNodes.nodes.isEmpty())
+		frame.previousNodes = frame.nodes;
+	frames.publish();
+
+	// on demand, a frame is only requested when the picture can differ from the snapshot published last,
+	// that is when the time moves an animation, the camera moved, or a transform changed
+	bool animated = false;
+	for (int i = 0; i < objects.size() && !animated; i++)
+		animated = objects[i]->getAnimation().isActive();
+	bool changed = frameIndex == 1 || (animated && frame.time != publishedTime) || frame.viewMatrix != publishedViewMatrix || store->getRevision() != publishedRevision;
+	publishedRevision = store->getRevision();
+	publishedTime = frame.time;
+	publishedViewMatrix = frame.viewMatrix;
+
+	if (changed && onDemand.loadAcquire())
+		requestRender();
+}
 
-	update();
+/*
+Description:
+	This function is used to ask for a frame, from the render thread if there is one, otherwise from the GUI thread, which can be called on any thread;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::requestRender() {
+	if (renderThread != 0)
+		renderThread->requestFrame();
+	else
+		QMetaObject::invokeMethod(this, [this]() { update(); }, Qt::QueuedConnection);
+}
+
+/*
+Description:
+	This function is used to add camera input to the input not yet applied by the simulation, all the input arriving between two simulation passes is applied at once;
+Input:
+	@ const QQuaternion& rotation: the rotation of the camera;
+	@ float zoom: the distance the camera is moved along the view direction;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::queueCameraInput(const QQuaternion& rotation, float zoom) {
+	QMutexLocker locker(&inputMutex);
+	pendingRotation = rotation * pendingRotation;
+	pendingZoom += zoom;
+	if (inputPending) return;
+
+	inputPending = true;
+	simulation->post([this]() { applyCameraInput(); });
+}
+
+/*
+Description:
+	This function is used to apply the queued camera input, which is called on the simulation thread;
+Input:
+	@ void parameter: void;
+Output:
+	@ void returnValue: void;
+*/
+void Widget::applyCameraInput() {
+	inputMutex.lock();
+	QQuaternion rotation = pendingRotation;
+	float zoom = pendingZoom;
+	pendingRotation = QQuaternion();
+	pendingZoom = 0.0f;
+	inputPending = false;
+	inputMutex.unlock();
+
+	camera->rotate(rotation);
+	if (zoom != 0.0f)
+		camera->translate(QVector3D(0.0, 0.0, zoom));
 }
 
 /*
@@ -241,29 +651,53 @@ Output:
 	@ void returnValue: void;
 */
 void Widget::keyPressEvent(QKeyEvent* event) {
-
-	switch (event->key()) {
-	case Qt::Key_Left:
-		groups[0]->delObject(camera);
-		groups[1]->addObject(camera);
-		break;
-	case Qt::Key_Right:
-		groups[1]->delObject(camera);
-		groups[0]->addObject(camera);
-		break;
-	case Qt::Key_Down:
-		groups[0]->delObject(camera);
-		groups[1]->delObject(camera);
-break;
-	case Qt::Key_Up:
-		groups[0]->delObject(camera);
-		groups[1]->delObject(camera);
-		QMatrix4x4 temp;
-		temp.setToIdentity();
-		camera->setGlobalTransform(temp);
-		break;
+	int key = event->key();
+
+	switch (key) {
+	case Qt::Key_Space:
+		// a paused simulation sleeps until the next input, so an on-demand view costs nothing while nobody touches it
+		simulation->setPaused(!simulation->isPaused());
+		return;
+	case Qt::Key_O:
+		onDemand.storeRelease(!onDemand.loadAcquire());
+		requestRender();
+		return;
 	}
-	update();
+
+	// the hierarchy is changed by the simulation thread, while the render thread is not drawing it
+	simulation->post([this, key]() {
+		QMutexLocker locker(&sceneMutex);
+		switch (key) {
+		case Qt::Key_Left:
+			groups[0]->delObject(camera);
+			groups[1]->addObject(camera);
+			break;
+		case Qt::Key_Right:
+			groups[1]->delObject(camera);
+			groups[0]->addObject(camera);
+			break;
+		case Qt::Key_Down:
+			groups[0]->delObject(camera);
+			groups[1]->delObject(camera);
+			break;
+		case Qt::Key_P:
+			depthPrepass = !depthPrepass;
+			break;
+		case Qt::Key_I:
+			indirectDraw = !indirectDraw;
+			break;
+		case Qt::Key_G:
+			TransformStore::getDefault()->setDeviceEvaluation(!TransformStore::getDefault()->isDeviceEvaluated());
+			break;
+		case Qt::Key_Up:
+			groups[0]->delObject(camera);
+			groups[1]->delObject(camera);
+			QMatrix4x4 temp;
+			temp.setToIdentity();
+			camera->setGlobalTransform(temp);
+			break;
+		}
+	});
 }
 
 /*
@@ -275,31 +709,32 @@ Output:
 	@ void returnValue: void;
 */
 void Widget::initShaders() {
-	if (!objectShader.addShaderFromSourceFile(QOpenGLShader::Vertex, "./Object.vsh")) {
-		QString log = objectShader.log();
-		close();
-	}
-	if (!objectShader.addShaderFromSourceFile(QOpenGLShader::Fragment, "./Object.fsh")) {
-		QString log = objectShader.log();
-		close();
-	}
-	if (!objectShader.link()) {
-		QString log = objectShader.log();
+	// every material feature becomes a compile-time variant of the object shader, so the fragment shader has no feature branches
+	shaders.init();
+	QStringList defines = QStringList() << QString("MAX_CLUSTER_LIGHTS %1").arg(LightEngine3D::maxLightsPerCluster);
+	if (ResourceCache::getDefault()->isUsingTextureArrays()) defines << "DIFFUSE_ARRAY";
+	shaders.setGlobalDefines(defines);
+	shaders.addProgram("Object");
+	shaders.addProgram("Object", QStringList() << "DIFFUSE_MAP");
+	shaders.addProgram("Skybox");
+	shaders.addProgram("Depth");
+	shaders.addProgram("Hierarchy");
+	shaders.addProgram("Indirect");
+	shaders.addProgram("Indirect", QStringList() << "DIFFUSE_MAP");
+	shaders.addProgram("Indirect", QStringList() << "DEPTH_ONLY");
+	shaders.addProgram("Cull");
+	shaders.addProgram("DepthPyramid");
+	shaders.addProgram("Upscale");
+	if (!shaders.build()) {
+		QString log = shaders.log();
 		close();
 	}
 
-	if (!skyboxShader.addShaderFromSourceFile(QOpenGLShader::Vertex, "./Skybox.vsh")) {
-		QString log = skyboxShader.log();
-		close();
-	}
-	if (!skyboxShader.addShaderFromSourceFile(QOpenGLShader::Fragment, "./Skybox.fsh")) {
-		QString log = skyboxShader.log();
-		close();
-	}
-	if (!skyboxShader.link()) {
-		QString log = skyboxShader.log();
-		close();
-	}
+	objectShaders = shaders.getPrograms("Object");
+	skyboxShader = shaders.getProgram("Skybox");
+	depthShader = shaders.getProgram("Depth");
+	indirectShaders = QVector<QOpenGLShaderProgram*>() << shaders.getProgram("Indirect") << shaders.getProgram("Indirect", QStringList() << "DIFFUSE_MAP");
+	indirectDepthShader = shaders.getProgram("Indirect", QStringList() << "DEPTH_ONLY");
 }
 
 /*
@@ -356,6 +791,9 @@ void Widget::initCube(float width) {
 	material->setSpecularColor(QVector3D(1.0, 1.0, 1.0));
 
 	ObjectEngine3D* objectEngine = new ObjectEngine3D;
+	// the material library of the object engine owns the material, identical materials of the other cubes resolve to the same one
+	MaterialLibrary* materials = objectEngine->getMaterialLibrary();
+	material = materials->getMaterial(materials->addMaterial(material));
 	objectEngine->addObject(new SimpleObject3D(vertices, indices, material));
 
 	objects << objectEngine;
@@ -9,7 +9,6 @@
 #include "ObjectEngine3D.h"
 #include "Group3D.h"
 #include <qopenglcontext.h>
-#include <qbasictimer.h>
 #include <QtMath>
 #include "Camera3D.h"
 #include <QKeyEvent>
@@ -17,7 +16,46 @@
 #include <qstringlist.h>
 #include <qstring.h>
 #include "Material.h"
+#include "LightEngine3D.h"
+#include "ShaderLibrary.h"
+#include "Animation3D.h"
+#include "TransformBuffer.h"
+#include "Prefab3D.h"
 #include "ObjectEngine3D.h"
+#include <qmutex.h>
+#include "SimdMath.h"
+#include "SnapshotExchange.h"
+#include "SimulationThread.h"
+#include "RenderThread.h"
+#include "CommandBuffer.h"
+#include "IndirectRenderer.h"
+#include "FrameGraph.h"
+
+// everything a frame is drawn with, captured by the simulation thread and only read by the thread drawing
+struct FrameSnapshot {
+	FrameSnapshot() : frame(0), time(0.0f), previousTime(0.0f), stateTime(0), depthPrepass(true), indirectDraw(false), deviceEvaluation(false) {}
+
+	quint64 frame;
+
+	// the simulated time in seconds, and the clock time of the simulation thread in nanoseconds the latest step belongs to
+	float time;
+	float previousTime;
+	qint64 stateTime;
+
+	QMatrix4x4 viewMatrix;
+	QMatrix4x4 previousViewMatrix;
+	bool depthPrepass;
+	bool indirectDraw;
+
+	// indexed by the handles of the default transform store, for the latest step and the state before it, see Widget::capturePreviousFrame()
+	QVector<Matrix4> worldMatrices;
+	QVector<Matrix4> previousWorldMatrices;
+
+	// the nodes of the same steps, only captured while the world matrices are resolved on the GPU
+	bool deviceEvaluation;
+	TransformNodes nodes;
+	TransformNodes previousNodes;
+};
 
 class Widget :
 	public QOpenGLWidget {
@@ -29,34 +67,84 @@ protected:
 	void initializeGL();
 	void resizeGL(int width, int height);
 	void paintGL();
+	void paintEvent(QPaintEvent* event);
 
 	void mousePressEvent(QMouseEvent* event);
 	void mouseMoveEvent(QMouseEvent* event);
 	void wheelEvent(QWheelEvent* event);
-	void timerEvent(QTimerEvent* event);
 	void keyPressEvent(QKeyEvent* event);
 
+	void simulate();
+	void capturePreviousFrame();
+	void publishFrame();
+	bool renderFrame();
+	void requestRender();
+	void queueCameraInput(const QQuaternion& rotation, float zoom);
+	void applyCameraInput();
+
 	void initShaders();
 	void initCube(float width);
 
 private:
 	QMatrix4x4 pMatrix;
-	QOpenGLShaderProgram objectShader;
-	QOpenGLShaderProgram skyboxShader;
+	ShaderLibrary shaders;
+	QVector<QOpenGLShaderProgram*> objectShaders;
+	QOpenGLShaderProgram* skyboxShader;
+	QOpenGLShaderProgram* depthShader;
+	QVector<QOpenGLShaderProgram*> indirectShaders;
+	QOpenGLShaderProgram* indirectDepthShader;
 	QVector2D mousePosition;
 
 	QVector<ObjectEngine3D*> objects;
 	QVector<Group3D*> groups;
 	QVector<Transformational*> transformObjects;
 
-	QBasicTimer timer;
-
-	float angleObject;
 	float angleGroup1;
 	float angleGroup2;
 	float angleMain;
 
 	Camera3D* camera;
 	Skybox* skybox;
+	LightEngine3D* lights;
+	TransformBuffer* transformBuffer;
+	Prefab3D* clusterPrefab;
+
+	// the draws of the scene, recorded by all the threads of the job system and replayed by the thread drawing
+	CommandBuffer* drawCommands;
+
+	// the GPU-driven path, the recorded draws are culled by a compute shader and drawn with one multi draw per material bucket
+	IndirectRenderer* indirect;
+
+	// the passes of a frame, declared again every frame with the resources they read and write
+	FrameGraph* frameGraph;
+
+	bool depthPrepass;
+	bool indirectDraw;
+
+	// the simulation publishes a snapshot after its steps, the render thread draws the latest one while the next is simulated
+	SimulationThread* simulation;
+	RenderThread* renderThread;
+	SnapshotExchange<FrameSnapshot> frames;
+	quint64 frameIndex;
+
+	// what the snapshot published last showed, only used by the simulation thread
+	quint64 publishedRevision;
+	float publishedTime;
+	QMatrix4x4 publishedViewMatrix;
+	int viewportWidth;
+	int viewportHeight;
+
+	// the hierarchy of the groups is drawn by the render thread, the simulation holds it only while the hierarchy is changed
+	QMutex sceneMutex;
+
+	// the camera input of the GUI thread not yet applied by the simulation, a burst of events is applied as one
+	QMutex inputMutex;
+	QQuaternion pendingRotation;
+	float pendingZoom;
+	bool inputPending;
+
+	// on demand, a frame is only drawn for a snapshot that shows something new, a resize, or to finish blending towards the latest step
+	QAtomicInt onDemand;
+	QAtomicInt frameSettled;
 };
 
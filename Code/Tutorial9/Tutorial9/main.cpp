@@ -1,8 +1,71 @@
 #include "Tutorial9.h"
 #include <QtWidgets/QApplication>
+#include <qsurfaceformat.h>
+#include <qtextstream.h>
+#include "Benchmark.h"
+#include "Tests.h"
+#include "ResourceCache.h"
+#include "ResolutionScaler.h"
 
 int main(int argc, char *argv[])
 {
+	// clustered lighting reads its light lists from buffer textures, which needs an OpenGL 4.3 compatibility context
+	QSurfaceFormat format;
+	format.setVersion(4, 3);
+	format.setProfile(QSurfaceFormat::CompatibilityProfile);
+	format.setDepthBufferSize(24);
+	QSurfaceFormat::setDefaultFormat(format);
+
+	ResolutionScaler* scaler = ResolutionScaler::getDefault();
+	float minimumScale = scaler->getMinimumScale();
+	float maximumScale = scaler->getMaximumScale();
+
+	// run the benchmarks instead of the application, e.g. Tutorial9.exe --benchmark > report.txt
+	for (int i = 1; i < argc; i++) {
+		if (QString(argv[i]) == "--benchmark") {
+			QTextStream output(stdout);
+			Benchmark::run(output);
+			return 0;
+		}
+
+		// run the tests, the ones drawing use an offscreen surface, e.g. with QT_QPA_PLATFORM=offscreen without a display, the exit code is the amount of failed tests
+		if (QString(argv[i]) == "--test") {
+			QApplication a(argc, argv);
+			QTextStream output(stdout);
+			return Tests::run(output);
+		}
+
+		// pack the diffuse maps of one size into texture arrays, so draws with different maps need no texture change
+		if (QString(argv[i]) == "--texture-arrays")
+			ResourceCache::getDefault()->setUsingTextureArrays(true);
+
+		// draw the scene offscreen at a scale held to a frame time and upscale it, e.g. --dynamic-resolution --target-frame-time 8.3 --min-scale 0.6,
+		// a missing value or one that is not a number stops the application
+		QString argument(argv[i]);
+		bool valid = true;
+		if (argument == "--dynamic-resolution")
+			scaler->setEnabled(true);
+		if ((argument == "--target-frame-time" || argument == "--min-scale" || argument == "--max-scale") && i + 1 >= argc) {
+			qWarning("%s expects a number", argv[i]);
+			return 1;
+		}
+		if (argument == "--target-frame-time" && i + 1 < argc) {
+			float milliseconds = QString(argv[++i]).toFloat(&valid);
+			if (valid) scaler->setTargetFrameTime(milliseconds);
+		}
+		if (argument == "--min-scale" && i + 1 < argc)
+			minimumScale = QString(argv[++i]).toFloat(&valid);
+		if (argument == "--max-scale" && i + 1 < argc)
+			maximumScale = QString(argv[++i]).toFloat(&valid);
+		if (!valid) {
+			qWarning("%s expects a number, not \"%s\"", argv[i - 1], argv[i]);
+			return 1;
+		}
+	}
+
+	// the range is set once both ends are known, so the order of --min-scale and --max-scale does not matter
+	scaler->setScaleRange(minimumScale, maximumScale);
+
 	QApplication a(argc, argv);
 	Tutorial9 w;
 	w.show();